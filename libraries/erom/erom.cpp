@@ -1,5 +1,16 @@
 #include "erom.h"
 
+#if defined(__AVR__)
+#include <util/atomic.h>
+#elif defined(EROM_HOST)
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 namespace erom {
@@ -10,13 +21,123 @@ erom::Access &access = Access::instance();
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
-Access::Access(size_t aBase) : _base(aBase), _memory_size(device_memory_size()) { /* Do Nothing */ }
+uint16_t crc16(uint16_t aCrc, const void *aData, size_t aSize) {
+  static const uint16_t __table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+  const uint8_t *__p = static_cast<const uint8_t*>(aData);
+
+  while (aSize--) {
+    aCrc = (aCrc << 4) ^ __table[(aCrc >> 12) ^ (*__p >> 4)];
+    aCrc = (aCrc << 4) ^ __table[(aCrc >> 12) ^ (*__p++ & 0x0F)];
+  }
+  return aCrc;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+BitWriter::BitWriter(uint8_t *aData, size_t aSize) : _data(aData), _size(aSize), _bit(0) { memset(aData, 0, aSize); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool BitWriter::write(uint32_t aValue, uint8_t aBits) {
+  if (aBits > 32 || _bit + aBits > _size * 8) return false;
+  for (uint8_t __i = 0; __i < aBits; __i++, _bit++)
+    if (aValue >> __i & 1) _data[_bit / 8] |= 1 << (_bit % 8);
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint32_t BitReader::read(uint8_t aBits) {
+  uint32_t __value = 0;
+  for (uint8_t __i = 0; __i < aBits && __i < 32; __i++, _bit++)
+    if (_bit < _size * 8 && _data[_bit / 8] >> (_bit % 8) & 1) __value |= (uint32_t)1 << __i;
+  return __value;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+int32_t BitReader::read_signed(uint8_t aBits) {
+  uint32_t __value = read(aBits);
+  if (aBits > 0 && aBits < 32 && (__value >> (aBits - 1) & 1)) __value |= ~(uint32_t)0 << aBits;
+  return (int32_t)__value;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool BatchBase::add(size_t aAddress, const void *aData, size_t aSize, Mode aMode) {
+  if (_count >= _capacity) return false;
+  if (!aSize) return true;
+  Op &__op = _ops[_count];
+  __op.address = aAddress, __op.size = aSize, __op.data = aData;
+  __op.mode = aMode, __op.order = _count;
+  if (_count && aAddress < _ops[_count - 1].address) _sorted = false;
+  _count++;
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void BatchBase::_sort() {
+  // Insertion sort: batches are short and mostly added in order
+  for (uint8_t __i = 1; __i < _count; __i++) {
+    Op __op = _ops[__i];
+    uint8_t __j = __i;
+    for (; __j > 0 && (_ops[__j - 1].address > __op.address ||
+                       (_ops[__j - 1].address == __op.address && _ops[__j - 1].order > __op.order)); __j--) _ops[__j] = _ops[__j - 1];
+    _ops[__j] = __op;
+  }
+  _sorted = true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool BatchBase::_segment(size_t &aAddress, size_t &aEnd, const Op *&aOp, uint8_t &aFirst) const {
+  while (aFirst < _count && _ops[aFirst].address + _ops[aFirst].size <= aAddress) aFirst++;
+  if (aFirst >= _count) return false;
+  // Nothing before 'aFirst' reaches 'aAddress', nothing after it starts sooner
+  if (_ops[aFirst].address > aAddress) aAddress = _ops[aFirst].address;
+
+  aOp = NULL;
+  for (uint8_t __i = aFirst; __i < _count && _ops[__i].address <= aAddress; __i++)
+    if (_ops[__i].address + _ops[__i].size > aAddress && (!aOp || _ops[__i].order > aOp->order)) aOp = &_ops[__i];
+  aEnd = aOp->address + aOp->size;
+  for (uint8_t __i = aFirst; __i < _count && _ops[__i].address < aEnd; __i++)
+    if (_ops[__i].address > aAddress && _ops[__i].order > aOp->order) aEnd = _ops[__i].address;
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#ifndef EROM_NATIVE_ONLY
+Access::Access(size_t aBase) :
+  _device(NULL), _base(aBase), _memory_size(device_memory_size()),
+  _async(false), _queue_policy(WriteQueue::WaitOnFull), _bytes_written(0)
+{
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+Access::Access(Device &aDevice, size_t aBase) :
+  _device(&aDevice), _base(aBase), _memory_size(aDevice.size()),
+  _async(false), _queue_policy(WriteQueue::WaitOnFull), _bytes_written(0)
+{
+}
+#else // EROM_NATIVE_ONLY
+Access::Access(size_t aBase) :
+  _base(aBase), _memory_size(device_memory_size()),
+  _async(false), _queue_policy(WriteQueue::WaitOnFull), _bytes_written(0)
+{
+}
+#endif // EROM_NATIVE_ONLY
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 bool Access::read_bit(size_t aAddress, byte aBit) const {
   if (aBit > 7 || !in_range(aAddress + sizeof(uint8_t))) return false; 
-  byte byteVal = eeprom_read_byte(reinterpret_cast<unsigned char*>(aAddress + base()));
+  byte byteVal = read_byte(aAddress);
   return (byteVal & (1 << aBit));
 }
 
@@ -45,168 +166,2042 @@ bool Access::update_bit(size_t aAddress, uint8_t aBit, bool aValue) const {
     if (aValue) __output |= (1 << aBit);
     else __output &= ~(1 << aBit);
 
-    return __output != __input ? write_byte(aAddress, __output) : true;
+    // Clearing a bit needs no erase
+    if (__output == __input) { EROM_STATS_SKIP(1); return true; }
+    return _program(aAddress, __output, program_mode(__input, __output));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t Access::_changed(size_t aAddress, const uint8_t *aData, size_t aSize, const uint8_t *aStored) const {
+  uint8_t __stored[16];
+  size_t __changed = 0;
+
+  for (size_t __offset = 0; __offset < aSize; ) {
+    size_t __chunk = aSize - __offset < sizeof(__stored) ? aSize - __offset : sizeof(__stored);
+    if (!aStored) _read(aAddress + __offset, __stored, __chunk);
+    for (size_t __i = __offset; __i < __offset + __chunk; __i++)
+      if ((aStored ? aStored[__i] : __stored[__i - __offset]) != aData[__i]) __changed++;
+    __offset += __chunk;
+  }
+  return __changed;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t Access::_update(size_t aAddress, const void *aData, size_t aSize, unsigned long *aTime, const uint8_t *aStored) const {
+  const uint8_t *__data = static_cast<const uint8_t*>(aData);
+  size_t __page = _dev() ? _dev()->page_size() : 1;
+  uint8_t __stored[16];
+  size_t __written = 0;
+  size_t __span = 0, __span_end = 0;  // Changed bytes of a page not written yet
+  size_t __changed = 0;
+  bool __pending = false;
+  EROM_TRACE_MUTE(!aTime);            // Recorded as a single update below
+
+  for (size_t __offset = 0; __offset < aSize; ) {
+    size_t __chunk = aSize - __offset < sizeof(__stored) ? aSize - __offset : sizeof(__stored);
+    if (!aStored) _read(aAddress + __offset, __stored, __chunk);
+
+    for (size_t __i = __offset; __i < __offset + __chunk; __i++) {
+      uint8_t __old = aStored ? aStored[__i] : __stored[__i - __offset];
+      if (__old == __data[__i]) { EROM_STATS_SKIP(aTime ? 0 : 1); continue; }
+      __changed++;
+      if (__page <= 1) {
+        if (aTime) *aTime += _cycle_time(program_mode(__old, __data[__i]));
+        else if (_program(aAddress + __i, __data[__i], program_mode(__old, __data[__i]))) __written++;
+        continue;
+      }
+
+      // Paged devices program a whole page in one cycle: changed bytes of a
+      // page are written at once, along with unchanged ones between them
+      if (__pending && (base() + aAddress + __i) / __page != (base() + aAddress + __span) / __page) {
+        if (aTime) *aTime += _cycle_time(EraseWrite);
+        else if (_write(aAddress + __span, __data + __span, __span_end - __span)) __written += __span_end - __span;
+        __pending = false;
+      }
+      if (!__pending) __span = __i, __pending = true;
+      __span_end = __i + 1;
+    }
+    __offset += __chunk;
+  }
+
+  if (__pending) {
+    if (aTime) *aTime += _cycle_time(EraseWrite);
+    else if (_write(aAddress + __span, __data + __span, __span_end - __span)) __written += __span_end - __span;
+  }
+#ifdef EROM_TRACE
+  if (!aTime) EROM_TRACE_UPDATE(base() + aAddress, aData, aSize, __changed);
+#endif
+  return __written;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t Access::commit(BatchBase &aBatch) const {
+  for (uint8_t __i = 0; __i < aBatch._count; __i++)
+    if (!in_range(aBatch._ops[__i].address + aBatch._ops[__i].size)) return 0;
+  if (!aBatch._sorted) aBatch._sort();
+
+  size_t __written = 0;
+  size_t __address = 0, __end = 0;
+  const BatchBase::Op *__op = NULL;
+  uint8_t __first = 0;
+  bool __more = aBatch._segment(__address, __end, __op, __first);
+
+  // Paged devices program a page in one cycle: runs go to the usual write
+  // and update, which gather the changed bytes of a page
+  if (_dev() && _dev()->page_size() > 1) {
+    while (__more) {
+      const uint8_t *__data = static_cast<const uint8_t*>(__op->data) + (__address - __op->address);
+      if (__op->mode == BatchBase::Update) __written += _update(__address, __data, __end - __address);
+      else if (_write(__address, __data, __end - __address)) __written += __end - __address;
+      __address = __end;
+      __more = aBatch._segment(__address, __end, __op, __first);
+    }
+    return __written;
+  }
+
+  // Bytes one by one: values of up to 16 consecutive bytes are gathered,
+  // the stored ones read and compared into the modes to program them with.
+  // The next chunk is read before the last byte of the current one starts
+  // programming (reading waits for the previous one anyway), and gathered
+  // and compared while it programs
+  struct Chunk {
+    size_t address;
+    uint8_t size;
+    uint16_t write;           // Bytes written whole
+    uint8_t value[16], mode[16];
+  } __chunks[2], *__current = &__chunks[0], *__next = &__chunks[1];
+  static const uint8_t __skip = 0xFF;
+  __current->size = 0;
+
+  // As updates (see '_fits()'), a batch is queued whole or not at all
+  if (_rejecting()) {
+    size_t __bytes = 0, __at = 0, __to = 0;
+    const BatchBase::Op *__at_op = NULL;
+    uint8_t __at_first = 0;
+    while (aBatch._segment(__at, __to, __at_op, __at_first)) {
+      const uint8_t *__data = static_cast<const uint8_t*>(__at_op->data) + (__at - __at_op->address);
+      __bytes += __at_op->mode == BatchBase::Update ? _changed(__at, __data, __to - __at) : __to - __at;
+      __at = __to;
+    }
+    if (__bytes > WriteQueue::available()) return 0;
+  }
+
+  do {
+    __next->address = __address, __next->size = 0, __next->write = 0;
+    while (__more && __address == __next->address + __next->size && __next->size < sizeof(__next->value)) {
+      size_t __size = __end - __address;
+      if (__size > sizeof(__next->value) - __next->size) __size = sizeof(__next->value) - __next->size;
+      memcpy(__next->value + __next->size, static_cast<const uint8_t*>(__op->data) + (__address - __op->address), __size);
+      if (__op->mode == BatchBase::Write) __next->write |= (uint16_t)(((1UL << __size) - 1) << __next->size);
+      __next->size += __size, __address += __size;
+      if (__address == __end) __more = aBatch._segment(__address, __end, __op, __first);
+    }
+
+    int __last = -1;
+    for (uint8_t __i = 0; __i < __current->size; __i++) {
+      if (__current->mode[__i] == __skip) continue;
+      if (__last >= 0 && _program(__current->address + __last, __current->value[__last], (ProgramMode)__current->mode[__last])) __written++;
+      __last = __i;
+    }
+    if (__next->size && __next->write != (uint16_t)((1UL << __next->size) - 1)) _read(__next->address, __next->mode, __next->size);
+    if (__last >= 0 && _program(__current->address + __last, __current->value[__last], (ProgramMode)__current->mode[__last])) __written++;
+
+    for (uint8_t __i = 0; __i < __next->size; __i++) {
+      if (__next->write >> __i & 1) __next->mode[__i] = EraseWrite;
+      else if (__next->mode[__i] == __next->value[__i]) { EROM_STATS_SKIP(1); __next->mode[__i] = __skip; }
+      else __next->mode[__i] = program_mode(__next->mode[__i], __next->value[__i]);
+    }
+
+    Chunk *__swap = __current;
+    __current = __next, __next = __swap;
+  } while (__current->size);
+
+  return __written;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long Access::write_time(size_t aAddress, size_t aSize) const {
+  if (!aSize || !in_range(aAddress + aSize)) return 0;
+  size_t __page = _dev() ? _dev()->page_size() : 1;
+  size_t __cycles = (base() + aAddress + aSize - 1) / __page - (base() + aAddress) / __page + 1;
+  return __cycles * _cycle_time(EraseWrite);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint16_t Access::crc16(size_t aAddress, size_t aSize, uint16_t aCrc) const {
+  if (!in_range(aAddress + aSize)) return aCrc;
+  uint8_t __buffer[16];
+
+  while (aSize) {
+    size_t __chunk = aSize < sizeof(__buffer) ? aSize : sizeof(__buffer);
+    _read(aAddress, __buffer, __chunk);
+    aCrc = erom::crc16(aCrc, __buffer, __chunk);
+    aAddress += __chunk, aSize -= __chunk;
+  }
+  return aCrc;
 }
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 size_t Access::device_memory_size() {
-  return
-#if   defined (__AVR_AT94K__)         \
-   || defined (__AVR_AT76C711__)      \
-   || defined (__AVR_AT43USB320__)    \
-   || defined (__AVR_AT43USB355__)
-                                            0         // No EEPROM Memory
-#elif defined (__AVR_ATtiny13__)      \
-   || defined (__AVR_ATtiny13A__)     \
-   || defined (__AVR_ATtiny43U__)     \
-   || defined (__AVR_ATtiny48__)      \
-   || defined (__AVR_ATtiny88__)
-                                            64        // 64 bytes
-#elif defined (__AVR_ATtiny22__)      \
-   || defined (__AVR_ATtiny26__)      \
-   || defined (__AVR_AT90S2343__)     \
-   || defined (__AVR_AT90S2333__)     \
-   || defined (__AVR_AT90S2323__)     \
-   || defined (__AVR_AT90S2313__)     \
-   || defined (__AVR_ATtiny2313__)    \
-   || defined (__AVR_ATtiny24__)      \
-   || defined (__AVR_ATtiny25__)      \
-   || defined (__AVR_ATtiny261__)
-                                            128       // 128 bytes
-#elif defined (__AVR_ATmega48__)      \
-   || defined (__AVR_ATmega48P__)     \
-   || defined (__AVR_ATmega8HVA__)    \
-   || defined (__AVR_AT90S4414__)     \
-   || defined (__AVR_AT90S4434__)     \
-   || defined (__AVR_AT90S4433__)     \
-   || defined (__AVR_ATtiny44__)      \
-   || defined (__AVR_ATtiny45__)      \
-   || defined (__AVR_ATtiny461__)
-                                            256       // 256 bytes
-#elif defined (__AVR_ATmega164P__)    \
-   || defined (__AVR_ATmega16__)      \
-   || defined (__AVR_ATmega161__)     \
-   || defined (__AVR_ATmega162__)     \
-   || defined (__AVR_ATmega163__)     \
-   || defined (__AVR_ATmega165__)     \
-   || defined (__AVR_ATmega165P__)    \
-   || defined (__AVR_ATmega168__)     \
-   || defined (__AVR_ATmega168P__)    \
-   || defined (__AVR_ATmega169__)     \
-   || defined (__AVR_ATmega169P__)    \
-   || defined (__AVR_ATmega16HVA__)   \
-   || defined (__AVR_ATmega406__)     \
-   || defined (__AVR_ATmega8__)       \
-   || defined (__AVR_ATmega8U2__)     \
-   || defined (__AVR_ATmega88__)      \
-   || defined (__AVR_ATmega88P__)     \
-   || defined (__AVR_ATmega8515__)    \
-   || defined (__AVR_ATmega8535__)    \
-                                      \
-   || defined (__AVR_ATtiny167__)     \
-   || defined (__AVR_ATtiny84__)      \
-   || defined (__AVR_ATtiny85__)      \
-   || defined (__AVR_ATtiny861__)     \
-                                      \
-   || defined (__AVR_AT90S8515__)     \
-   || defined (__AVR_AT90C8534__)     \
-   || defined (__AVR_AT90S8535__)     \
-   || defined (__AVR_AT90PWM1__)      \
-   || defined (__AVR_AT90PWM2__)      \
-   || defined (__AVR_AT90PWM2B__)     \
-   || defined (__AVR_AT90PWM2B__)     \
-   || defined (__AVR_AT90PWM3__)      \
-   || defined (__AVR_AT90PWM3B__)     \
-   || defined (__AVR_AT90PWM216__)    \
-   || defined (__AVR_AT90PWM316__)    \
-   || defined (__AVR_AT90USB82__)     \
-   || defined (__AVR_AT90USB162__)
-                                            512       // 512 bytes
-#elif defined (__AVR_ATmega32C1__)    \
-   || defined (__AVR_ATmega32M1__)    \
-   || defined (__AVR_ATmega32U4__)    \
-   || defined (__AVR_ATmega32U6__)    \
-   || defined (__AVR_AT90CAN32__)     \
-   || defined (__AVR_ATmega32__)      \
-   || defined (__AVR_ATmega323__)     \
-   || defined (__AVR_ATmega325__)     \
-   || defined (__AVR_ATmega325P__)    \
-   || defined (__AVR_ATmega3250__)    \
-   || defined (__AVR_ATmega3250P__)   \
-   || defined (__AVR_ATmega329__)     \
-   || defined (__AVR_ATmega329P__)    \
-   || defined (__AVR_ATmega3290__)    \
-   || defined (__AVR_ATmega3290P__)   \
-   || defined (__AVR_ATmega324P__)    \
-   || defined (__AVR_ATmega328P__)    \
-   || defined (__AVR_ATmega32HVB__)
-                                            1024      // 1 KB
-#elif defined (__AVR_AT90CAN64__)     \
-   || defined (__AVR_AT90USB646__)    \
-   || defined (__AVR_AT90USB647__)    \
-   || defined (__AVR_ATmega64__)      \
-   || defined (__AVR_ATmega644__)     \
-   || defined (__AVR_ATmega644P__)    \
-   || defined (__AVR_ATmega645__)     \
-   || defined (__AVR_ATmega6450__)    \
-   || defined (__AVR_ATmega649__)     \
-   || defined (__AVR_ATmega6490__)
-                                            2048      // 2 KB
-#elif defined (__AVR_ATmega128__)     \
-   || defined (__AVR_ATmega1280__)    \
-   || defined (__AVR_ATmega1281__)    \
-   || defined (__AVR_ATmega1284P__)   \
-   || defined (__AVR_ATmega128RFA1__) \
-   || defined (__AVR_ATmega2560__)    \
-   || defined (__AVR_ATmega2561__)    \
-   || defined (__AVR_AT90CAN128__)    \
-   || defined (__AVR_AT90USB1286__)   \
-   || defined (__AVR_AT90USB1287__)   \
-   || defined (__AVR_ATmega640__)     \
-   || defined (__AVR_ATmega103__)
-                                            4096      // 4 KB
-#elif defined (__AVR_AT86RF401__)
-                                            131072    // 128 KB
+#if defined(EROM_HOST)
+  return ImageDevice::native().size(); // Host image, sized at run time
 #else
-                                            0         // Memory unknown, specify manually
-#endif 
-  ;
+  return EROM_DEVICE_MEMORY_SIZE;
+#endif
 }
 
+#ifdef EROM_STATS
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
-VerifiedStorage::VerifiedStorage(uint16_t aAppID, uint16_t aVersion) :
-  Storage(),
-  _app_id(aAppID), _version(aVersion),
-  _header(issue<uint32_t>()),
-  _stored_app_id(issue<uint16_t>()),
-  _stored_version(issue<uint16_t>())
+uint32_t Stats::_writes[Stats::buckets];
+unsigned long Stats::_bytes_read    = 0;
+unsigned long Stats::_bytes_written = 0;
+unsigned long Stats::_bytes_skipped = 0;
+unsigned long Stats::_blocked_time  = 0;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long Stats::clock() { return micros(); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Stats::write(size_t aAddress, size_t aSize) {
+  _bytes_written += aSize;
+  while (aSize--) _writes[bucket(aAddress++)]++;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t Stats::hottest_bucket() {
+  size_t __hottest = 0;
+  for (size_t __i = 1; __i < buckets; __i++) if (_writes[__i] > _writes[__hottest]) __hottest = __i;
+  return __hottest;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Stats::reset() {
+  for (size_t __i = 0; __i < buckets; __i++) _writes[__i] = 0;
+  _bytes_read = _bytes_written = _bytes_skipped = _blocked_time = 0;
+}
+
+#endif // EROM_STATS
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void TraceRingBase::_put(const uint8_t *aData, size_t aSize) {
+  for (size_t __i = 0; __i < aSize; __i++) _data[(_tail + _used++) % _size] = aData[__i];
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void TraceRingBase::record(const uint8_t *aHead, size_t aHeadSize, const uint8_t *aData, size_t aDataSize) {
+  size_t __size = aHeadSize + aDataSize;
+  if (__size + 2 > _size || __size > 0xFFFF) { _dropped++; return; }
+
+  // Oldest records make room
+  while (_size - _used < __size + 2) {
+    size_t __oldest = 2 + (_at(0) | (size_t)_at(1) << 8);
+    _tail = (_tail + __oldest) % _size, _used -= __oldest;
+    _dropped++;
+  }
+
+  uint8_t __length[2] = { (uint8_t)__size, (uint8_t)(__size >> 8) };
+  _put(__length, sizeof(__length));
+  _put(aHead, aHeadSize);
+  _put(aData, aDataSize);
+}
+
+#ifdef EROM_TRACE
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+TraceOutput *Trace::_output = NULL;
+uint8_t Trace::_tag = 0;
+uint8_t Trace::_muted = 0;
+unsigned long Trace::_last = 0;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long Trace::clock() { return micros(); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Appends 'aValue' as a varint, returns the new end
+static uint8_t *_trace_varint(uint8_t *aHead, unsigned long aValue) {
+  for (; aValue >= 0x80; aValue >>= 7) *aHead++ = (uint8_t)(aValue | 0x80);
+  *aHead++ = (uint8_t)aValue;
+  return aHead;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Trace::_record(Kind aKind, size_t aAddress, size_t aSize, const void *aData, size_t aChanged) {
+  uint8_t __head[1 + 4 * 5], *__end = __head;
+  unsigned long __now = clock();
+
+  *__end++ = (uint8_t)(aKind << 6 | _tag);
+  __end = _trace_varint(__end, __now - _last);
+  __end = _trace_varint(__end, aAddress);
+  __end = _trace_varint(__end, aSize);
+  if (aKind != Read) __end = _trace_varint(__end, aChanged);
+  _last = __now;
+
+  // The output may write EEPROM itself (e.g. a device on the same bus); it
+  // is not recorded
+  Mute __mute(true);
+  _output->record(__head, __end - __head, aKind == Read ? NULL : static_cast<const uint8_t*>(aData), aKind == Read ? 0 : aSize);
+}
+
+#endif // EROM_TRACE
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// The queue is drained by the EE_READY interrupt where available. Elsewhere
+// (or with interrupts disabled) bytes are programmed synchronously whenever
+// room is needed and on 'flush()'.
+#if defined(EE_READY_vect) && defined(EERIE)
+#define EROM_WRITE_QUEUE_INTERRUPT
+#define EROM_WRITE_QUEUE_SUSPEND()  uint8_t __eerie = EECR & _BV(EERIE); EECR &= ~_BV(EERIE)
+#define EROM_WRITE_QUEUE_RESUME()   EECR |= __eerie
+#else
+#define EROM_WRITE_QUEUE_SUSPEND()
+#define EROM_WRITE_QUEUE_RESUME()
+#endif
+
+#if defined(__AVR__)
+#define EROM_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#define EROM_ATOMIC
+#endif
+
+volatile size_t  WriteQueue::_address[WriteQueue::capacity];
+volatile uint8_t WriteQueue::_value[WriteQueue::capacity];
+volatile uint8_t WriteQueue::_head  = 0;
+volatile uint8_t WriteQueue::_count = 0;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+int WriteQueue::_find(size_t aAddress) {
+  for (uint8_t __i = 0, __slot = _head; __i < _count; __i++, __slot = (__slot + 1) % capacity)
+    if (_address[__slot] == aAddress) return __slot;
+  return -1;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool WriteQueue::_put(size_t aAddress, uint8_t aValue) {
+  int __slot = _find(aAddress);
+  if (__slot < 0) {
+    if (_count >= capacity) return false;
+    __slot = (_head + _count++) % capacity;
+    _address[__slot] = aAddress;
+  }
+  _value[__slot] = aValue;
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void WriteQueue::_drain() {
+#ifdef EROM_WRITE_QUEUE_INTERRUPT
+  // Let the interrupt do the job, unless it cannot fire
+  EECR |= _BV(EERIE);
+  if (SREG & _BV(SREG_I)) return;
+  EECR &= ~_BV(EERIE);
+#endif
+  while (!NativeDevice::is_ready());
+  service();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool WriteQueue::push(size_t aAddress, const void *aData, size_t aSize, Policy aPolicy) {
+  const uint8_t *__p = static_cast<const uint8_t*>(aData);
+
+  if (aPolicy == RejectOnFull) {
+    bool __ok = true;
+    EROM_ATOMIC {
+      size_t __needed = 0;
+      for (size_t __i = 0; __i < aSize; __i++) if (_find(aAddress + __i) < 0) __needed++;
+      if (__needed > (size_t)(capacity - _count)) __ok = false;
+      else for (size_t __i = 0; __i < aSize; __i++) _put(aAddress + __i, __p[__i]);
+    }
+    if (!__ok) return false;
+  }
+  else {
+    for (size_t __i = 0; __i < aSize; __i++) {
+      bool __done = false;
+      while (!__done) {
+        EROM_ATOMIC { __done = _put(aAddress + __i, __p[__i]); }
+        if (!__done) _drain();
+      }
+    }
+  }
+
+#ifdef EROM_WRITE_QUEUE_INTERRUPT
+  EECR |= _BV(EERIE);
+#endif
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void WriteQueue::read(size_t aAddress, void *aData, size_t aSize) {
+  EROM_WRITE_QUEUE_SUSPEND();
+  NativeDevice::read(aAddress, aData, aSize);
+
+  uint8_t *__p = static_cast<uint8_t*>(aData);
+  for (uint8_t __i = 0, __slot = _head; __i < _count; __i++, __slot = (__slot + 1) % capacity)
+    if (_address[__slot] >= aAddress && _address[__slot] < aAddress + aSize)
+      __p[_address[__slot] - aAddress] = _value[__slot];
+  EROM_WRITE_QUEUE_RESUME();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void WriteQueue::service() {
+  if (!_count) {
+#ifdef EROM_WRITE_QUEUE_INTERRUPT
+    EECR &= ~_BV(EERIE);
+#endif
+    return;
+  }
+
+  size_t  __address = _address[_head];
+  uint8_t __value   = _value[_head], __stored;
+  _head = (_head + 1) % capacity, _count--;
+
+  // Bytes are queued whole, the programming mode is picked against the cell
+  NativeDevice::read(__address, &__stored, sizeof(__stored));
+  if (__stored != __value) NativeDevice::program(__address, __value, program_mode(__stored, __value));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void WriteQueue::flush() { while (_count) _drain(); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t WriteQueue::pending() { return _count; }
+
+#if defined(__AVR__)
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void NativeDevice::program(size_t aAddress, uint8_t aValue, ProgramMode aMode) {
+#if defined(EEPM0) && defined(EEPM1) && defined(EEPE) && defined(EEMPE)
+  while (EECR & _BV(EEPE));
+  EEAR = aAddress;
+  EEDR = aValue;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    // EEMPE must be followed by EEPE within four cycles
+    EECR = (EECR & _BV(EERIE)) | (aMode == EraseOnly ? _BV(EEPM0) : aMode == WriteOnly ? _BV(EEPM1) : 0) | _BV(EEMPE);
+    EECR |= _BV(EEPE);
+  }
+#else
+  eeprom_write_byte(reinterpret_cast<uint8_t*>(aAddress), aValue); // No split programming
+#endif
+}
+#endif
+
+#if !defined(__AVR__) && !defined(EROM_HOST)
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void NativeDevice::read(size_t /* aAddress */, void *aData, size_t aSize) { memset(aData, 0xFF, aSize); }
+void NativeDevice::write(size_t /* aAddress */, const void * /* aData */, size_t /* aSize */) { /* No EEPROM */ }
+void NativeDevice::program(size_t /* aAddress */, uint8_t /* aValue */, ProgramMode /* aMode */) { /* No EEPROM */ }
+bool NativeDevice::is_ready() { return true; }
+unsigned long NativeDevice::cycle_time(ProgramMode /* aMode */) { return 0; }
+#endif
+
+#if defined(EROM_HOST)
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void NativeDevice::read(size_t aAddress, void *aData, size_t aSize) { ImageDevice::native().read(aAddress, aData, aSize); }
+void NativeDevice::write(size_t aAddress, const void *aData, size_t aSize) { ImageDevice::native().write(aAddress, aData, aSize); }
+void NativeDevice::program(size_t aAddress, uint8_t aValue, ProgramMode aMode) { ImageDevice::native().program(aAddress, aValue, aMode); }
+bool NativeDevice::is_ready() { return ImageDevice::native().is_ready(); }
+unsigned long NativeDevice::cycle_time(ProgramMode aMode) { return ImageDevice::native().cycle_time(aMode); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static unsigned long _image_clock() {
+  timespec __ts;
+  clock_gettime(CLOCK_MONOTONIC, &__ts);
+  return __ts.tv_sec * 1000000UL + __ts.tv_nsec / 1000;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+ImageDevice::ImageDevice() :
+  _image(NULL), _wear(NULL), _erases(NULL), _size(0),
+  _write_latency(DefaultWriteLatency), _phase_latency(DefaultPhaseLatency), _realtime(false),
+  _powered(true), _power_left(0), _lost_writes(0)
 {
+  reset_stats();
 }
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
-VerifiedStorage::VerifiedStorage(Access &aAccess, uint16_t aAppID, uint16_t aVersion) :
-  Storage(aAccess),
-  _app_id(aAppID), _version(aVersion),
-  _header(issue<uint32_t>()),
-  _stored_app_id(issue<uint16_t>()),
-  _stored_version(issue<uint16_t>())
+ImageDevice::ImageDevice(const char *aPath, size_t aSize, unsigned long aWriteLatency) :
+  _image(NULL), _wear(NULL), _erases(NULL), _size(0),
+  _write_latency(aWriteLatency), _phase_latency(DefaultPhaseLatency), _realtime(false),
+  _powered(true), _power_left(0), _lost_writes(0)
 {
+  open(aPath, aSize, aWriteLatency);
 }
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
-bool VerifiedStorage::verify(bool aAutoClear) {
-  _load_header();
-  bool __ok = _header == storage_header_value && OnVerify(stored_app_id(), stored_version());
-  if (!__ok && aAutoClear) { clear(); return verify(false); }
-  return __ok;
+ImageDevice::~ImageDevice() { close(); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool ImageDevice::open(const char *aPath, size_t aSize, unsigned long aWriteLatency) {
+  close();
+  if (!aSize) return false;
+
+  void *__image = MAP_FAILED;
+  if (aPath) {
+    int __fd = ::open(aPath, O_RDWR | O_CREAT, 0644);
+    if (__fd < 0) return false;
+
+    // Grow the file, new bytes are erased EEPROM cells
+    off_t __length = lseek(__fd, 0, SEEK_END);
+    if (__length >= 0 && ((size_t)__length >= aSize || ftruncate(__fd, aSize) == 0))
+      __image = mmap(NULL, aSize, PROT_READ | PROT_WRITE, MAP_SHARED, __fd, 0);
+    ::close(__fd);
+    if (__image == MAP_FAILED) return false;
+    if ((size_t)__length < aSize) memset(static_cast<uint8_t*>(__image) + __length, 0xFF, aSize - __length);
+  }
+  else {
+    __image = mmap(NULL, aSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (__image == MAP_FAILED) return false;
+    memset(__image, 0xFF, aSize);
+  }
+
+  _image = static_cast<uint8_t*>(__image);
+  _size  = aSize;
+  _wear  = static_cast<uint32_t*>(calloc(aSize, sizeof(uint32_t)));
+  _erases = static_cast<uint32_t*>(calloc(aSize, sizeof(uint32_t)));
+  _write_latency = aWriteLatency;
+  reset_stats();
+  return true;
 }
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
-} // namespace erom
+void ImageDevice::close() {
+  if (_image) munmap(_image, _size);
+  free(_wear);
+  free(_erases);
+  _image = NULL, _wear = NULL, _erases = NULL, _size = 0;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageDevice::read(size_t aAddress, void *aData, size_t aSize) {
+  if (_realtime) while (!is_ready());
+  if (aAddress + aSize > _size) return;
+  memcpy(aData, _image + aAddress, aSize);
+  _bytes_read += aSize;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageDevice::_program(size_t aAddress, uint8_t aValue, ProgramMode aMode) {
+  unsigned long __latency = cycle_time(aMode);
+  if (!_powered) {
+    if (_power_left < __latency) {
+      // Erased, not written. A write-only cycle only ever clears bits
+      if (_power_left && aMode != WriteOnly) _image[aAddress] = 0xFF;
+      _power_left = 0;
+      _lost_writes++;
+      return;
+    }
+    _power_left -= __latency;
+  }
+  if (_realtime) {
+    while (!is_ready());
+    _busy_until = _image_clock() + __latency;
+  }
+  _image[aAddress] = aValue;
+  _wear[aAddress]++;
+  if (aMode != WriteOnly) _erases[aAddress]++;
+  _bytes_written++;
+  _programming_time += __latency;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageDevice::write(size_t aAddress, const void *aData, size_t aSize) {
+  if (aAddress + aSize > _size) return;
+  const uint8_t *__p = static_cast<const uint8_t*>(aData);
+  for (size_t __i = 0; __i < aSize; __i++) _program(aAddress + __i, __p[__i], EraseWrite);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageDevice::program(size_t aAddress, uint8_t aValue, ProgramMode aMode) {
+  if (aAddress >= _size) return;
+  switch (aMode) {
+    case EraseOnly: _program(aAddress, 0xFF, aMode); break;
+    case WriteOnly: _program(aAddress, _image[aAddress] & aValue, aMode); break;
+    default:        _program(aAddress, aValue, aMode); break;
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool ImageDevice::is_ready() const { return !_realtime || (long)(_image_clock() - _busy_until) >= 0; }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long ImageDevice::max_wear() const {
+  unsigned long __max = 0;
+  for (size_t __i = 0; __i < _size; __i++) if (_wear[__i] > __max) __max = _wear[__i];
+  return __max;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long ImageDevice::max_erases() const {
+  unsigned long __max = 0;
+  for (size_t __i = 0; __i < _size; __i++) if (_erases[__i] > __max) __max = _erases[__i];
+  return __max;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageDevice::reset_stats() {
+  _busy_until = 0;
+  _programming_time = _bytes_read = _bytes_written = 0;
+  if (_wear) memset(_wear, 0, _size * sizeof(uint32_t));
+  if (_erases) memset(_erases, 0, _size * sizeof(uint32_t));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+ImageDevice& ImageDevice::native() {
+  static ImageDevice __native;
+  if (!__native.is_open()) {
+    const char *__size = getenv("EROM_IMAGE_SIZE");
+    __native.open(getenv("EROM_IMAGE"), __size ? strtoul(__size, NULL, 0) : 1024);
+    __native.realtime(getenv("EROM_REALTIME") != NULL);
+  }
+  return __native;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+#endif // EROM_HOST
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::_register(EntryBase &aEntry) {
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next)
+    if (__entry == &aEntry) return; // Reissued
+
+  aEntry._next = NULL;
+  if (_last_entry) _last_entry->_next = &aEntry;
+  else _first_entry = &aEntry;
+  _last_entry = &aEntry;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::load_entries() {
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next) __entry->load();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::touch_entries() {
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next) __entry->touch();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::save_entry(EntryBase &aEntry) {
+  _current = &aEntry;
+  aEntry.save();
+  _current = NULL;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::save_entries(bool aDirtyOnly) {
+  for (EntryBase *__entry = _first_entry; __entry && !_preempted; __entry = __entry->_next)
+    if (__entry->dirty() || !aDirtyOnly) save_entry(*__entry);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::load_entries(const uint8_t *aShadow, size_t aSize) {
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next) {
+    size_t __address = __entry->address();
+    if (__address >= aSize || !__entry->load_shadowed(aShadow + __address, aSize - __address)) __entry->load();
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::save_entries(uint8_t *aShadow, size_t aSize, bool aDirtyOnly) {
+  for (EntryBase *__entry = _first_entry; __entry && !_preempted; __entry = __entry->_next) {
+    if (!__entry->dirty() && aDirtyOnly) continue;
+    size_t __address = __entry->address();
+    _current = __entry;
+    if (__address >= aSize || !__entry->save_shadowed(aShadow + __address, aSize - __address)) __entry->save();
+    _current = NULL;
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long Storage::flush(unsigned long aBudget) {
+  // A save preempted in the middle of an entry may have left it torn, and
+  // clean already (see 'WearLeveledEntry'): it is saved again
+  EntryBase *__current = _current;
+  if (__current) __current->touch();
+
+  _preempted = false; // Not to stop saves of the overrides
+  unsigned long __spent = OnFlush(aBudget);
+  _current = __current, _preempted = true;
+  return __spent;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long Storage::flush_entries(unsigned long aBudget) {
+  unsigned long __spent = _access.flush_time();
+  _access.flush(); // Older queued bytes go first
+
+  // So does the entry a preempted save was writing, whatever its priority
+  if (_current && _current->dirty() && __spent + _current->save_time() <= aBudget) {
+    __spent += _current->save_time();
+    _current->save();
+  }
+
+  // Priority levels from the highest down, entries of a level in issue order
+  for (int __level = EntryBase::max_priority; __level >= 0; ) {
+    int __next = -1;
+    for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next) {
+      if (!__entry->dirty()) continue;
+      if (__entry->priority() < __level) { if (__entry->priority() > __next) __next = __entry->priority(); continue; }
+      if (__entry->priority() > __level) continue;
+
+      unsigned long __time = __entry->save_time();
+      if (__spent + __time > aBudget) continue;
+      __entry->save();
+      __spent += __time;
+    }
+    __level = __next;
+  }
+  _access.flush(); // Asynchronous bytes must not wait for an interrupt
+  return __spent;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long Storage::entries_save_time(bool aDirtyOnly) const {
+  unsigned long __time = 0;
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next)
+    if (__entry->dirty() || !aDirtyOnly) __time += __entry->save_time();
+  return __time;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint16_t Storage::entries_crc(const EntryBase *aExcept, bool aStoredDirty) const {
+  uint16_t __crc = crc16_init;
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next)
+    if (__entry != aExcept) __crc = aStoredDirty && __entry->dirty() ? __entry->stored_crc16(__crc) : __entry->crc16(__crc);
+  return __crc;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool Storage::dirty(bool aCriticalOnly) const {
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next)
+    if (__entry->dirty() && (__entry->critical() || !aCriticalOnly)) return true;
+  return false;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t Storage::mark_entries(bool aDirtyOnly) {
+  size_t __marked = 0;
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next)
+    if (__entry->dirty() || !aDirtyOnly) __entry->_pending = true, __marked++;
+  return __marked;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::_begin(Pass aPass) {
+  finish();
+  _pass = aPass, _phase = _Begin;
+  _pass_entries = 0, _pass_done = 0, _preempted = false;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::_step() {
+  if (_preempted && _pass == Saving) {
+    cancel();
+    return;
+  }
+
+  switch (_phase) {
+    case _Begin:
+      if (!(_pass == Loading ? OnBeginLoad() : OnBeginSave()) || _pass == Idle) return;
+      for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next)
+        if (__entry->_pending) _pass_entries++;
+      _phase = _Entries, _cursor = _first_entry;
+      return;
+
+    case _Entries:
+      while (_cursor && !_cursor->_pending) _cursor = _cursor->_next;
+      if (_cursor) {
+        if (_pass == Loading) _cursor->load();
+        else save_entry(*_cursor);
+        _cursor->_pending = false;
+        _cursor = _cursor->_next;
+        _pass_done++;
+        return;
+      }
+      _phase = _End;
+      // Falls through
+
+    default:
+      if (_pass == Loading ? OnEndLoad() : OnEndSave()) _pass = Idle;
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long Storage::tick(unsigned long aBudget) {
+  unsigned long __start = micros();
+  _access.tick();
+  if (_pass == Idle && _save_requested && (long)(millis() - _save_time) >= 0) _save_requested = false, begin_save();
+
+  // A device still programming the last step would stall the first one.
+  // Hook steps have no estimate and get a call of their own
+  for (bool __first = true; _pass != Idle; __first = false) {
+    if (__first) {
+      if (!_access.is_ready()) break;
+    } else {
+      if (_phase != _Entries) break;
+      while (_cursor && !_cursor->_pending) _cursor = _cursor->_next;
+      if (!_cursor) break;
+      unsigned long __elapsed = micros() - __start;
+      unsigned long __time = _pass == Saving ? _cursor->save_time() : 0;
+      if (__elapsed >= aBudget || __time > aBudget - __elapsed) break;
+    }
+    _step();
+  }
+  return micros() - __start;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::finish() {
+  while (_pass != Idle) _step();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void Storage::cancel() {
+  if (_pass == Idle) return;
+  for (EntryBase *__entry = _first_entry; __entry; __entry = __entry->_next) __entry->_pending = false;
+  _pass = Idle;
+  OnCancel();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Longest the budget runs ahead of now, keeping 'millis()' differences signed
+static const unsigned long _max_debt = 0x3FFFFFFFUL;
+
+SaveScheduler::SaveScheduler(Storage &aStorage, unsigned int aLifetimeYears, unsigned long aEndurance, uint8_t aLeveling) :
+  _storage(aStorage), _cycles(aEndurance * (aLeveling ? aLeveling : 1)), _min_delay(DefaultMinDelay),
+  _due(millis()), _since(0), _pending(false), _last_tick(millis()), _uptime(0), _uptime_ms(0),
+  _saves(0), _bytes_written(0), _max_window(0)
+{
+  unsigned long long __interval = aLifetimeYears * 365ULL * 24 * 3600 * 1000 / (_cycles ? _cycles : 1);
+  _interval = __interval < _max_debt ? (unsigned long)__interval : _max_debt;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void SaveScheduler::tick() {
+  unsigned long __now = millis();
+  _uptime_ms += __now - _last_tick, _last_tick = __now;
+  _uptime += _uptime_ms / 1000, _uptime_ms %= 1000;
+  if ((long)(__now - _due) > 0) _due = __now; // Unused budget does not pile up
+
+  _storage.tick();
+  if (!_storage.dirty()) { _pending = false; return; }
+  if (!_pending) _pending = true, _since = __now;
+
+  if (_storage.dirty(true) || (__now - _since >= _min_delay && (long)(__now - _due) >= 0)) save();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void SaveScheduler::save() {
+  unsigned long __now = millis(), __written = _storage.access().bytes_written();
+  if (_pending && __now - _since > _max_window) _max_window = __now - _since;
+  _storage.save();
+  _pending = false;
+
+  __written = _storage.access().bytes_written() - __written;
+  if (!__written) return;
+  _saves++, _bytes_written += __written;
+
+  if ((long)(__now - _due) > 0) _due = __now;
+  _due += _interval;
+  if (_due - __now > _max_debt) _due = __now + _max_debt;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long SaveScheduler::window() const {
+  unsigned long __now = millis();
+  unsigned long __budget = (long)(_due - __now) > 0 ? _due - __now : 0;
+  return __budget > _min_delay ? __budget : _min_delay;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long SaveScheduler::projected_lifetime() const {
+  if (!_saves) return 0xFFFFFFFFUL;
+  unsigned long long __days = (unsigned long long)_uptime * _cycles / _saves / (24 * 3600UL);
+  return __days < 0xFFFFFFFFULL ? (unsigned long)__days : 0xFFFFFFFFUL;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+const uint32_t VerifiedStorage::storage_header_value;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+VerifiedStorage::VerifiedStorage(uint16_t aAppID, uint16_t aVersion, bool aChecksum) :
+  Storage(),
+  _app_id(aAppID), _version(aVersion), _checksum(aChecksum)
+{
+  issue(_header); issue(_stored_app_id); issue(_stored_version);
+  if (_checksum) issue(_stored_crc);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+VerifiedStorage::VerifiedStorage(Access &aAccess, uint16_t aAppID, uint16_t aVersion, bool aChecksum) :
+  Storage(aAccess),
+  _app_id(aAppID), _version(aVersion), _checksum(aChecksum)
+{
+  issue(_header); issue(_stored_app_id); issue(_stored_version);
+  if (_checksum) issue(_stored_crc);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void VerifiedStorage::OnSave() {
+  bool __changed = _checksum && dirty();
+  Storage::OnSave();
+  if (!__changed) return;
+
+  // Written last, so a save cut short leaves a mismatching checksum
+  // Updated whether or not it seems to match: the RAM copy is not loaded
+  // after a 'clear()'. After a preempting 'flush()', taken over the stored
+  // values of the entries it left out
+  _stored_crc = entries_crc(&_stored_crc, preempted());
+  save_entry(_stored_crc);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long VerifiedStorage::OnFlush(unsigned long aBudget) {
+  if (!_checksum || !dirty()) return Storage::OnFlush(aBudget);
+
+  // Room is kept for the checksum, computed over stored values of the
+  // entries left out, so a partial flush still loads as valid. Without that
+  // room nothing is saved: entries saved without their checksum would not
+  unsigned long __reserve = access().write_time(_stored_crc.address(), sizeof(uint16_t));
+  if (aBudget < __reserve) return 0;
+  unsigned long __spent = Storage::OnFlush(aBudget - __reserve);
+  uint16_t __crc = entries_crc(&_stored_crc, true);
+  __spent += access().update_time(_stored_crc.address(), __crc);
+  _stored_crc = __crc;
+  _stored_crc.save();
+  return __spent;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool VerifiedStorage::OnEndSave() {
+  if (!Storage::OnEndSave()) return false;
+  if (!_checksum) return true;
+
+  _stored_crc = entries_crc(&_stored_crc, true);
+  save_entry(_stored_crc);
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool VerifiedStorage::_migrate() {
+  if (_header != storage_header_value || stored_app_id() != app_id() || stored_version() == version()) return false;
+
+  // Entries start from defaults; every old field is read before anything
+  // is written, so fields may move over each other in any order
+  uint16_t __version = stored_version();
+  OnClear();
+  if (!OnMigrate(__version)) return false;
+  touch_entries();
+  save();
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool VerifiedStorage::verify(bool aAutoClear) {
+  _load_header();
+  bool __ok = _header == storage_header_value && OnVerify(stored_app_id(), stored_version());
+  if (!__ok && aAutoClear) {
+    if (!_migrate()) clear();
+    return verify(false);
+  }
+  return __ok;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool VerifiedStorage::load_verified(bool aAutoClear) {
+  load();
+  bool __ok = _header == storage_header_value && OnVerify(stored_app_id(), stored_version())
+    && (!_checksum || _stored_crc == entries_crc(&_stored_crc));
+  if (!__ok && aAutoClear) {
+    if (!_migrate()) clear();
+    return verify(false);
+  }
+  return __ok;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+BankedStorage::BankedStorage(size_t aBankSize) :
+  Storage(_bank),
+  _target(Access::instance()), _bank(Access::instance()), _bank_size(aBankSize),
+  _active(0), _selected(0), _generation(0), _valid(false), _uncommitted(false)
+{
+  _scan_reset();
+  _select(_active);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+BankedStorage::BankedStorage(Access &aAccess, size_t aBankSize) :
+  Storage(_bank),
+  _target(aAccess), _bank(aAccess), _bank_size(aBankSize),
+  _active(0), _selected(0), _generation(0), _valid(false), _uncommitted(false)
+{
+  _scan_reset();
+  _select(_active);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void BankedStorage::_select(uint8_t aBank) {
+  size_t __base = _target.base() + _bank_address(aBank);
+  size_t __end  = __base + _bank_size + 1; // 'in_range()' excludes 'memory_size()'
+  _bank.base(__base);
+  _bank.memory_size(__end < _target.memory_size() ? __end : _target.memory_size());
+  _selected = aBank;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool BankedStorage::_check(uint8_t aBank, uint16_t aCrc, uint16_t &aGeneration) {
+  Record __record;
+  if (!_target.read_block(_record_address(aBank), __record)) return false;
+
+  aCrc = crc16(aCrc, &__record.generation, sizeof(__record.generation));
+  aGeneration = __record.generation;
+  return aCrc == __record.crc;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void BankedStorage::_pick(const bool aValid[2], const uint16_t aGeneration[2]) {
+  _valid = aValid[0] || aValid[1];
+  if (!_valid) return;
+
+  // Generations wrap around, the newer one is less than half the range ahead
+  _active = aValid[0] && (!aValid[1] || (int16_t)(aGeneration[0] - aGeneration[1]) > 0) ? 0 : 1;
+  _generation = aGeneration[_active];
+  _select(_active);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void BankedStorage::_commit(uint8_t aBank, uint16_t aCrc) {
+  Record __record;
+  __record.generation = _generation + 1;
+  __record.crc = crc16(aCrc, &__record.generation, sizeof(__record.generation));
+  _target.update_block(_record_address(aBank), __record);
+
+  _active = aBank, _generation = __record.generation, _valid = true, _uncommitted = false;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool BankedStorage::_scan(uint8_t aBank) {
+  size_t __size = size() - _scan_offset < ScanChunk ? size() - _scan_offset : ScanChunk;
+  _scan_crc = _target.crc16(_bank_address(aBank) + _scan_offset, __size, _scan_crc);
+  _scan_offset += __size;
+  return _scan_offset >= size();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void BankedStorage::OnLoad() {
+  uint16_t __generation[2];
+  bool __valid[2];
+  __valid[0] = _check(0, _target.crc16(_bank_address(0), size()), __generation[0]);
+  __valid[1] = _check(1, _target.crc16(_bank_address(1), size()), __generation[1]);
+
+  _pick(__valid, __generation);
+  if (_valid) load_entries();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void BankedStorage::OnSave() {
+  if (_valid && !dirty() && !_uncommitted) return;
+
+  // The inactive bank is brought up to date with every entry; only bytes
+  // differing from its older image are programmed
+  uint8_t __bank = _active ^ 1;
+  _select(__bank);
+  save_entries(false);
+  if (preempted()) {
+    // Committed by 'flush()', or left for the next save
+    if (_active != __bank) _uncommitted = true;
+    return;
+  }
+  _bank.flush(); // Queued bank bytes must reach EEPROM before the record
+  _commit(__bank, _target.crc16(_bank_address(__bank), size()));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool BankedStorage::OnBeginLoad() {
+  // A step takes a chunk of a bank, or checks its record once done
+  if (_scan_bank < 2) {
+    if (!_scan(_scan_bank)) return false;
+    _scan_valid[_scan_bank] = _check(_scan_bank, _scan_crc, _scan_generation[_scan_bank]);
+    _scan_reset(_scan_bank + 1);
+    return false;
+  }
+
+  _scan_reset();
+  _pick(_scan_valid, _scan_generation);
+  if (_valid) mark_entries(false);
+  else cancel();
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool BankedStorage::OnBeginSave() {
+  if (_valid && !dirty() && !_uncommitted) {
+    cancel();
+    return true;
+  }
+
+  // Entries saved by the pass are clean, but not committed until it ends
+  _select(_active ^ 1);
+  _uncommitted = true;
+  mark_entries(false);
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool BankedStorage::OnEndSave() {
+  // A step takes a chunk of the bank, the record is written by the last one
+  _bank.flush();
+  if (_scan_offset < size()) {
+    _scan(_active ^ 1);
+    return false;
+  }
+
+  _commit(_active ^ 1, _scan_crc);
+  _scan_reset();
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long BankedStorage::OnFlush(unsigned long aBudget) {
+  if (_valid && !dirty() && !_uncommitted) return 0;
+
+  uint8_t __bank = _active ^ 1, __selected = _selected;
+  _select(__bank);
+  unsigned long __time = _bank.flush_time() + entries_save_time(false) + _target.write_time(_record_address(__bank), sizeof(Record));
+  if (__time > aBudget) {
+    _select(__selected); // A save it preempts goes on with the inactive bank
+    return 0;
+  }
+
+  // The whole bank is written here, a resumable save of it is done
+  if (saving()) cancel();
+  BankedStorage::OnSave();
+  return __time;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ShadowStorageBase::_fill() {
+  size_t __size = size() < _shadow_size ? size() : _shadow_size;
+  _shadowed = access().read_block(0, _shadow, __size);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ShadowStorageBase::OnLoad() {
+  _fill();
+  if (_shadowed) load_entries(_shadow, _shadowed);
+  else load_entries();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ShadowStorageBase::OnSave() {
+  // Entries issued since the shadow was read are not covered by it yet
+  if (_shadowed < size() && _shadowed < _shadow_size) _fill();
+  if (_shadowed) save_entries(_shadow, _shadowed);
+  else save_entries();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+KVStoreBase::KVStoreBase(const Access &aAccess, size_t aAddress, size_t aSize, uint16_t *aIndex, uint8_t *aLengths, uint8_t aKeys) :
+  _access(aAccess), _address(aAddress), _half_size(aSize / 2 < (size_t)missing ? aSize / 2 : (size_t)missing),
+  _index(aIndex), _lengths(aLengths), _keys(aKeys), _half(0), _sequence(0), _end(header_size), _compactions(0)
+{
+  for (uint8_t __key = 0; __key < _keys; __key++) _index[__key] = missing, _lengths[__key] = 0;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool KVStoreBase::_read_header(uint8_t aHalf, uint16_t &aSequence) const {
+  uint16_t __header[2];
+  if (!_access.read_block(_half_address(aHalf), __header)) return false;
+  aSequence = __header[0];
+  return __header[1] == _seed(__header[0]);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void KVStoreBase::_write_header(uint8_t aHalf, uint16_t aSequence) const {
+  uint16_t __header[2] = { aSequence, _seed(aSequence) };
+  _access.update_block(_half_address(aHalf), __header);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void KVStoreBase::_scan() {
+  size_t __base = _half_address(_half);
+  uint16_t __seed = _seed(_sequence);
+  uint8_t __record[2];
+  uint16_t __crc;
+
+  for (uint8_t __key = 0; __key < _keys; __key++) _index[__key] = missing, _lengths[__key] = 0;
+
+  // The log ends at the first record failing its CRC: never written, cut
+  // short by a power loss, or left from an older log
+  for (_end = header_size; _end + record_overhead <= _half_size; _end += record_overhead + __record[1]) {
+    if (!_access.read_block(__base + _end, __record)) break;
+    if (__record[0] == 0xFF && __record[1] == 0xFF) break;     // Erased
+    if (_end + record_overhead + __record[1] > _half_size) break;
+
+    if (!_access.read_block(__base + _end + 2 + __record[1], __crc)) break;
+    if (__crc != _access.crc16(__base + _end, 2 + __record[1], __seed)) break;
+
+    if (__record[0] < _keys) {
+      _index[__record[0]] = __record[1] ? (uint16_t)_end : (uint16_t)missing;
+      _lengths[__record[0]] = __record[1];
+    }
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool KVStoreBase::_equals(size_t aOffset, const void *aData, size_t aSize) const {
+  const uint8_t *__p = static_cast<const uint8_t*>(aData);
+  uint8_t __stored[16];
+  size_t __address = _half_address(_half) + aOffset;
+
+  while (aSize) {
+    size_t __chunk = aSize < sizeof(__stored) ? aSize : sizeof(__stored);
+    _access.read_block(__address, __stored, __chunk);
+    if (memcmp(__stored, __p, __chunk)) return false;
+    __address += __chunk, __p += __chunk, aSize -= __chunk;
+  }
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void KVStoreBase::_append(uint8_t aKey, const void *aData, uint8_t aSize) {
+  size_t __address = _half_address(_half) + _end;
+  uint8_t __record[2] = { aKey, aSize };
+  uint16_t __crc = crc16(crc16(_seed(_sequence), __record, sizeof(__record)), aData, aSize);
+
+  // CRC goes last, so a record cut short does not pass
+  _access.update_block(__address, __record);
+  _access.update_block(__address + 2, static_cast<const uint8_t*>(aData), aSize);
+  _access.update_block(__address + 2 + aSize, __crc);
+
+  _index[aKey] = aSize ? (uint16_t)_end : (uint16_t)missing;
+  _lengths[aKey] = aSize;
+  _end += record_overhead + aSize;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool KVStoreBase::load() {
+  uint16_t __sequence[2];
+  bool __valid[2];
+  __valid[0] = _read_header(0, __sequence[0]);
+  __valid[1] = _read_header(1, __sequence[1]);
+
+  if (!__valid[0] && !__valid[1]) {
+    _half = 0, _sequence = 0, _end = header_size;
+    for (uint8_t __key = 0; __key < _keys; __key++) _index[__key] = missing, _lengths[__key] = 0;
+    _write_header(0, _sequence);
+    return false;
+  }
+
+  // Sequences wrap around, the newer one is less than half the range ahead
+  _half = __valid[0] && (!__valid[1] || (int16_t)(__sequence[0] - __sequence[1]) > 0) ? 0 : 1;
+  _sequence = __sequence[_half];
+  _scan();
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t KVStoreBase::read(uint8_t aKey, void *aData, size_t aSize) const {
+  size_t __length = length(aKey);
+  if (__length < aSize) aSize = __length;
+  if (aSize) _access.read_block(_half_address(_half) + _index[aKey] + 2, static_cast<uint8_t*>(aData), aSize);
+  return aSize;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool KVStoreBase::write(uint8_t aKey, const void *aData, size_t aSize) {
+  if (aKey >= _keys || aSize > 0xFF) return false;
+
+  // Unchanged values and removals of missing keys cost nothing
+  if (!contains(aKey)) { if (!aSize) return true; }
+  else if (length(aKey) == aSize && _equals(_index[aKey] + 2, aData, aSize)) return true;
+
+  if (_end + record_overhead + aSize > _half_size) compact();
+  if (_end + record_overhead + aSize > _half_size) return false;
+
+  _append(aKey, aData, aSize);
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool KVStoreBase::remove(uint8_t aKey) { return write(aKey, NULL, 0); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void KVStoreBase::compact() {
+  uint8_t __half = _half ^ 1;
+  uint16_t __sequence = _sequence + 1;
+  uint16_t __seed = _seed(__sequence);
+  size_t __from = _half_address(_half), __to = _half_address(__half);
+  size_t __end = header_size;
+  uint8_t __buffer[16];
+
+  // Live records are copied under the new sequence; the current log stays
+  // valid until the new header is written
+  for (uint8_t __key = 0; __key < _keys; __key++) {
+    if (_index[__key] == missing) continue;
+
+    size_t __offset = _index[__key];
+    size_t __size = 2 + _lengths[__key];
+    uint16_t __crc = __seed;
+    _index[__key] = __end;
+
+    for (size_t __i = 0; __i < __size; ) {
+      size_t __chunk = __size - __i < sizeof(__buffer) ? __size - __i : sizeof(__buffer);
+      _access.read_block(__from + __offset + __i, __buffer, __chunk);
+      _access.update_block(__to + __end + __i, __buffer, __chunk);
+      __crc = crc16(__crc, __buffer, __chunk);
+      __i += __chunk;
+    }
+    _access.update_block(__to + __end + __size, __crc);
+    __end += __size + sizeof(__crc);
+  }
+
+  _access.flush(); // Queued records must reach EEPROM before the header
+  _write_header(__half, __sequence);
+
+  _half = __half, _sequence = __sequence, _end = __end;
+  _compactions++;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Zigzag maps small differences of either sign to small unsigned numbers:
+// 0, -1, 1, -2... to 0, 1, 2, 3...
+static inline uint32_t zigzag(int32_t aDelta) { return ((uint32_t)aDelta << 1) ^ (aDelta < 0 ? 0xFFFFFFFFUL : 0); }
+static inline uint32_t unzigzag(uint32_t aZigzag) { return (aZigzag >> 1) ^ (0 - (aZigzag & 1)); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+SeriesLogBase::SeriesLogBase(const Access &aAccess, size_t aAddress, size_t aSize, uint8_t *aBlock, uint8_t aBlockSize, uint8_t aValueSize) :
+  _access(aAccess), _address(aAddress), _blocks(aSize / aBlockSize),
+  _block(aBlock), _block_size(aBlockSize), _value_size(aValueSize), _header_size(base_offset + aValueSize),
+  _head(_blocks ? _blocks - 1 : 0), _sequence(0xFFFF), _open(false), _dirty(false), _size(0), _flushed(0), _last(0)
+{
+  /* Do Nothing */
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint32_t SeriesLogBase::_extend(uint32_t aValue) const {
+  if (_value_size >= sizeof(uint32_t)) return aValue;
+  uint32_t __sign = (uint32_t)1 << (_value_size * 8 - 1);
+  aValue &= (__sign << 1) - 1;
+  return (aValue ^ __sign) - __sign;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint16_t SeriesLogBase::_crc(const uint8_t *aHeader, uint16_t aCrc) const {
+  aCrc = crc16(aCrc, aHeader, sizeof(uint16_t));
+  return crc16(aCrc, aHeader + time_offset, _header_size - time_offset);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool SeriesLogBase::_check(size_t aBlock, uint8_t *aHeader) const {
+  size_t __address = _block_address(aBlock);
+  if (!_access.read_block(__address, aHeader, _header_size)) return false;
+  if (aHeader[size_offset] > _capacity()) return false;
+
+  uint16_t __crc;
+  memcpy(&__crc, aHeader + sizeof(uint16_t), sizeof(__crc));
+  return __crc == _access.crc16(__address + _header_size, aHeader[size_offset], _crc(aHeader, crc16_init));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool SeriesLogBase::load() {
+  uint8_t __header[base_offset + sizeof(uint32_t)];
+  bool __found = false;
+
+  // Sequences wrap around, the newest block is less than half the range ahead
+  for (size_t __block = 0; __block < _blocks; __block++) {
+    uint16_t __sequence;
+    if (!_check(__block, __header)) continue;
+    memcpy(&__sequence, __header, sizeof(__sequence));
+    if (__found && (int16_t)(__sequence - _sequence) <= 0) continue;
+    _head = __block, _sequence = __sequence, __found = true;
+  }
+
+  _open = _dirty = false, _size = _flushed = 0;
+  if (!__found) { _head = _blocks ? _blocks - 1 : 0, _sequence = 0xFFFF; return false; }
+
+  // Reopen the newest block and replay its deltas to get the last sample
+  _access.read_block(_block_address(_head), _block, _header_size);
+  _size = _flushed = _block[size_offset];
+  _access.read_block(_block_address(_head) + _header_size, _block + _header_size, _size);
+
+  _last = 0;
+  memcpy(&_last, _block + base_offset, _value_size);
+  for (uint8_t __position = 0; __position < _size; ) {
+    uint32_t __zigzag = 0;
+    uint8_t __byte, __shift = 0;
+    do {
+      __byte = _block[_header_size + __position++];
+      __zigzag |= (uint32_t)(__byte & 0x7F) << __shift, __shift += 7;
+    } while ((__byte & 0x80) && __position < _size);
+    _last += unzigzag(__zigzag);
+  }
+  _open = true;
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void SeriesLogBase::_append(uint32_t aValue, unsigned long aTime) {
+  if (!_blocks) return;
+
+  if (_open) {
+    // Differences wrap around within the sample type
+    uint32_t __zigzag = zigzag((int32_t)_extend(aValue - _last));
+    uint8_t __bytes[max_delta_size], __count = 0;
+    do {
+      __bytes[__count] = __zigzag & 0x7F;
+      __zigzag >>= 7;
+      if (__zigzag) __bytes[__count] |= 0x80;
+      __count++;
+    } while (__zigzag);
+
+    if (_size + __count <= _capacity()) {
+      memcpy(_block + _header_size + _size, __bytes, __count);
+      _size += __count, _last = aValue, _dirty = true;
+      return;
+    }
+    flush();
+  }
+
+  // Start a new block in place of the oldest one
+  uint32_t __time = aTime;
+  _head = (_head + 1) % _blocks;
+  _sequence++;
+  memcpy(_block, &_sequence, sizeof(_sequence));
+  memcpy(_block + time_offset, &__time, sizeof(__time));
+  memcpy(_block + base_offset, &aValue, _value_size);
+  _open = _dirty = true, _size = _flushed = 0, _last = aValue;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void SeriesLogBase::flush() {
+  if (!_dirty) return;
+  size_t __address = _block_address(_head);
+
+  // New deltas go first, the header (size and CRC) written last commits them
+  if (_size > _flushed)
+    _access.update_block(__address + _header_size + _flushed, _block + _header_size + _flushed, _size - _flushed);
+
+  _block[size_offset] = _size;
+  uint16_t __crc = crc16(_crc(_block, crc16_init), _block + _header_size, _size);
+  memcpy(_block + sizeof(uint16_t), &__crc, sizeof(__crc));
+  _access.update_block(__address, _block, _header_size);
+
+  _flushed = _size, _dirty = false;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint8_t SeriesLogBase::Reader::_byte(uint8_t aOffset) const {
+  return _ram ? _log._block[aOffset] : _log._access.read_byte(_address + aOffset);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool SeriesLogBase::Reader::_open_block() {
+  uint8_t __header[base_offset + sizeof(uint32_t)];
+  _in_block = false;
+
+  // Blocks are visited oldest first; overwritten or broken ones are skipped
+  while (_log._open && _block < _log._blocks) {
+    size_t __index = (_log._head + 1 + _block) % _log._blocks;
+    uint16_t __sequence = _log._sequence - (uint16_t)(_log._blocks - 1 - _block);
+    _block++;
+
+    const uint8_t *__h = _log._block;
+    _ram = __index == _log._head;
+    _address = _log._block_address(__index);
+    if (!_ram) {
+      uint16_t __stored;
+      if (!_log._check(__index, __header)) continue;
+      memcpy(&__stored, __header, sizeof(__stored));
+      if (__stored != __sequence) continue;
+      __h = __header;
+    }
+
+    _size = _ram ? _log._size : __h[size_offset];
+    _value = 0;
+    memcpy(&_time, __h + time_offset, sizeof(_time));
+    memcpy(&_value, __h + base_offset, _log._value_size);
+    _position = _index = 0;
+    _in_block = true;
+    return true;
+  }
+  return false;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool SeriesLogBase::Reader::_next(uint32_t &aValue) {
+  if (_in_block && _position < _size) {
+    uint32_t __zigzag = 0;
+    uint8_t __byte, __shift = 0;
+    do {
+      __byte = _byte(_log._header_size + _position++);
+      __zigzag |= (uint32_t)(__byte & 0x7F) << __shift, __shift += 7;
+    } while ((__byte & 0x80) && _position < _size);
+    _value += unzigzag(__zigzag);
+    _index++;
+  }
+  else if (!_open_block()) return false;
+
+  aValue = _value;
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+FlashDeviceBase::FlashDeviceBase(Flash &aFlash, size_t aFirstSector, size_t aSectors, uint8_t *aImage, size_t aSize) :
+  _flash(aFlash), _first(aFirstSector), _sectors(aSectors), _image(aImage), _size(aSize), _unit(1),
+  _active(0), _end(0), _sequence(0), _prepared(false), _collecting(false), _copied(0), _target_end(0),
+  _collections(0), _max_write_time(0)
+{
+  memset(_image, 0xFF, _size);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool FlashDeviceBase::_read_header(size_t aSector, uint16_t &aSequence) const {
+  uint16_t __header[3];
+  _flash.read(_sector_address(aSector), __header, sizeof(__header));
+  if (__header[1] != _size || crc16(crc16_init, __header, 2 * sizeof(uint16_t)) != __header[2]) return false;
+  aSequence = __header[0];
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::_write_header(size_t aSector, uint16_t aSequence) {
+  uint16_t __header[4] = { aSequence, static_cast<uint16_t>(_size), 0, 0xFFFF }; // Padded up to 8 byte units
+  __header[2] = crc16(crc16_init, __header, 2 * sizeof(uint16_t));
+  _flash.program(_sector_address(aSector), __header, _align(3 * sizeof(uint16_t)));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool FlashDeviceBase::_blank(size_t aSector) const {
+  uint8_t __chunk[max_record];
+  size_t __address = _sector_address(aSector), __size = _flash.sector_size();
+  for (size_t __offset = 0; __offset < __size; __offset += sizeof(__chunk)) {
+    size_t __length = __size - __offset < sizeof(__chunk) ? __size - __offset : sizeof(__chunk);
+    _flash.read(__address + __offset, __chunk, __length);
+    for (size_t __i = 0; __i < __length; __i++) if (__chunk[__i] != 0xFF) return false;
+  }
+  return true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::_scan() {
+  size_t __address = _sector_address(_active), __sector_size = _flash.sector_size();
+  _flash.read(__address + _align(3 * sizeof(uint16_t)), _image, _size);
+
+  uint8_t __record[record_overhead + max_record];
+  for (_end = _log_start(); _end + record_overhead <= __sector_size; ) {
+    _flash.read(__address + _end, __record, 3);
+    size_t __offset = __record[0] | (__record[1] << 8), __length = __record[2];
+    if (__offset == 0xFFFF && __length == 0xFF) return; // Erased, end of the log
+
+    size_t __stride = _align(record_overhead + __length);
+    if (!__length || __length > max_record || __offset + __length > _size || _end + __stride > __sector_size) break;
+    _flash.read(__address + _end + 3, __record + 3, __length + sizeof(uint16_t));
+    uint16_t __crc;
+    memcpy(&__crc, __record + 3 + __length, sizeof(__crc));
+    if (crc16(crc16_init, __record, 3 + __length) != __crc) break;
+
+    memcpy(_image + __offset, __record + 3, __length);
+    _end += __stride;
+  }
+  // Log full or ends with a torn record, whose space cannot be programmed
+  // again: the next write collects into the next sector
+  _end = __sector_size;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool FlashDeviceBase::load() {
+  _unit = _flash.program_size();
+  _prepared = _collecting = false;
+  memset(_image, 0xFF, _size);
+
+  // Sectors must hold the image and two records at least
+  _end = 0;
+  if (_sectors < 2 || _first + _sectors > _flash.sectors() ||
+      _log_start() + 2 * _align(record_overhead + max_record) > _flash.sector_size()) return false;
+
+  bool __found = false;
+  for (size_t __sector = 0; __sector < _sectors; __sector++) {
+    uint16_t __sequence;
+    if (_read_header(__sector, __sequence) && (!__found || (int16_t)(__sequence - _sequence) > 0))
+      __found = true, _active = __sector, _sequence = __sequence;
+  }
+
+  if (__found) { _scan(); return true; }
+
+  // Fresh flash (or another size): start with an erased image
+  _active = 0, _sequence = 0;
+  if (!_blank(_active)) _flash.erase(_first + _active);
+  _write_header(_active, _sequence);
+  _end = _log_start();
+  return false;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::_prepare() {
+  if (!_blank(_next())) _flash.erase(_first + _next());
+  _prepared = true;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::_collect_step() {
+  if (!_collecting) _collecting = true, _copied = 0, _target_end = _log_start();
+
+  if (_copied < _size) {
+    uint8_t __chunk[max_record];
+    size_t __size = _size - _copied < (size_t)max_record ? _size - _copied : (size_t)max_record;
+    bool __blank = true;
+    memset(__chunk, 0xFF, sizeof(__chunk));
+    memcpy(__chunk, _image + _copied, __size);
+    for (size_t __i = 0; __i < __size; __i++) if (__chunk[__i] != 0xFF) __blank = false;
+
+    // Erased bytes need no programming
+    if (!__blank) _flash.program(_sector_address(_next()) + _align(3 * sizeof(uint16_t)) + _copied, __chunk, _align(__size));
+    _copied += __size;
+    return;
+  }
+
+  // Commit the copy; the old sector is erased by the next '_prepare()'
+  // (or left to a later one when using more than two sectors)
+  _write_header(_next(), _sequence + 1);
+  _active = _next(), _sequence++, _end = _target_end;
+  _prepared = _collecting = false;
+  _collections++;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::_collect() {
+  if (!_prepared) _prepare();
+  do _collect_step(); while (_collecting);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::_append(size_t aAddress, const uint8_t *aData, uint8_t aSize) {
+  uint8_t __record[record_overhead + max_record + 8]; // Padded up to 8 byte units
+  size_t __stride = _align(record_overhead + aSize);
+  memset(__record, 0xFF, __stride);
+  __record[0] = aAddress, __record[1] = aAddress >> 8, __record[2] = aSize;
+  memcpy(__record + 3, aData, aSize);
+  uint16_t __crc = crc16(crc16_init, __record, 3 + aSize);
+  memcpy(__record + 3 + aSize, &__crc, sizeof(__crc));
+  memcpy(_image + aAddress, aData, aSize);
+
+  // Part of the image may be copied already, the record goes to the next
+  // sector as well. It always fits: collections start with a quarter of the
+  // log left, and the next sector's log is as large
+  if (_collecting) {
+    _flash.program(_sector_address(_next()) + _target_end, __record, __stride);
+    _target_end += __stride;
+  }
+
+  if (_end + __stride <= _flash.sector_size()) {
+    _flash.program(_sector_address(_active) + _end, __record, __stride);
+    _end += __stride;
+  }
+  else _collect(); // Log full, the copied image holds the record
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::read(size_t aAddress, void *aData, size_t aSize) { memcpy(aData, _image + aAddress, aSize); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::write(size_t aAddress, const void *aData, size_t aSize) {
+  if (!_end) return; // Not loaded
+  unsigned long __start = micros();
+  const uint8_t *__p = static_cast<const uint8_t*>(aData);
+
+  // Unchanged bytes at both ends are not logged
+  while (aSize && _image[aAddress] == *__p) aAddress++, __p++, aSize--;
+  while (aSize && _image[aAddress + aSize - 1] == __p[aSize - 1]) aSize--;
+
+  while (aSize) {
+    uint8_t __size = aSize < (size_t)max_record ? aSize : (size_t)max_record;
+    _append(aAddress, __p, __size);
+    aAddress += __size, __p += __size, aSize -= __size;
+  }
+
+  unsigned long __time = micros() - __start;
+  if (__time > _max_write_time) _max_write_time = __time;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void FlashDeviceBase::tick() {
+  // Never wait for an erase in progress here
+  if (!_end || !_flash.is_ready()) return;
+
+  if (!_prepared) _prepare();
+  else if (_collecting || used() >= capacity() - capacity() / 4) _collect_step();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+CacheDeviceBase::CacheDeviceBase(Device &aDevice, Line *aLines, uint8_t *aData, uint8_t aCount, uint8_t aLineSize, Policy aPolicy, Eviction aEviction) :
+  _device(aDevice), _lines(aLines), _data(aData), _count(aCount), _line_size(aLineSize),
+  _policy(aPolicy), _eviction(aEviction), _stamp(0), _hand(0), _hits(0), _misses(0), _transactions(0)
+{
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+int CacheDeviceBase::_find(size_t aAddress) const {
+  size_t __address = aAddress - aAddress % _line_size;
+  for (uint8_t __line = 0; __line < _count; __line++)
+    if ((_lines[__line].flags & valid) && _lines[__line].address == __address) return __line;
+  return -1;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint8_t CacheDeviceBase::_victim() {
+  for (uint8_t __line = 0; __line < _count; __line++)
+    if (!(_lines[__line].flags & valid)) return __line;
+
+  if (_eviction == Clock) {
+    // Lines used since the last sweep get a second chance
+    for (;;) {
+      uint8_t __line = _hand;
+      _hand = (_hand + 1) % _count;
+      if (!(_lines[__line].flags & referenced)) return __line;
+      _lines[__line].flags &= ~referenced;
+    }
+  }
+
+  // Stamps wrap around, the oldest line is the furthest behind
+  uint8_t __oldest = 0;
+  for (uint8_t __line = 1; __line < _count; __line++)
+    if ((uint16_t)(_stamp - _lines[__line].used) > (uint16_t)(_stamp - _lines[__oldest].used)) __oldest = __line;
+  return __oldest;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void CacheDeviceBase::_write_back(uint8_t aLine) {
+  Line &__line = _lines[aLine];
+  if (__line.dirty_end <= __line.dirty_begin) return;
+  _device.write(__line.address + __line.dirty_begin, _bytes(aLine) + __line.dirty_begin, __line.dirty_end - __line.dirty_begin);
+  _transactions++;
+  __line.dirty_begin = __line.dirty_end = 0;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint8_t CacheDeviceBase::_load(size_t aAddress, bool aFetch) {
+  int __found = _find(aAddress);
+  uint8_t __line;
+  if (__found >= 0) __line = __found, _hits++;
+  else {
+    __line = _victim();
+    _write_back(__line);
+    _lines[__line].address = aAddress - aAddress % _line_size;
+    _lines[__line].flags = valid;
+    if (aFetch) _device.read(_lines[__line].address, _bytes(__line), _fill_size(_lines[__line].address)), _transactions++;
+    _misses++;
+  }
+
+  _lines[__line].used = ++_stamp;
+  _lines[__line].flags |= referenced;
+  return __line;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void CacheDeviceBase::read(size_t aAddress, void *aData, size_t aSize) {
+  uint8_t *__p = static_cast<uint8_t*>(aData);
+  while (aSize) {
+    size_t __offset = aAddress % _line_size;
+    size_t __chunk = _line_size - __offset < aSize ? _line_size - __offset : aSize;
+    memcpy(__p, _bytes(_load(aAddress, true)) + __offset, __chunk);
+    aAddress += __chunk, __p += __chunk, aSize -= __chunk;
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void CacheDeviceBase::write(size_t aAddress, const void *aData, size_t aSize) {
+  const uint8_t *__p = static_cast<const uint8_t*>(aData);
+
+  if (_policy == WriteThrough) {
+    _device.write(aAddress, aData, aSize);
+    _transactions++;
+    for (uint8_t __line = 0; __line < _count; __line++) {
+      if (!(_lines[__line].flags & valid)) continue;
+      size_t __begin = aAddress > _lines[__line].address ? aAddress : _lines[__line].address;
+      size_t __end = aAddress + aSize < _lines[__line].address + _line_size ? aAddress + aSize : _lines[__line].address + _line_size;
+      if (__begin < __end) memcpy(_bytes(__line) + __begin - _lines[__line].address, __p + __begin - aAddress, __end - __begin);
+    }
+    return;
+  }
+
+  while (aSize) {
+    size_t __offset = aAddress % _line_size;
+    size_t __chunk = _line_size - __offset < aSize ? _line_size - __offset : aSize;
+
+    // A line written whole needs no fetch
+    uint8_t __index = _load(aAddress, __chunk < _fill_size(aAddress - __offset));
+    Line &__line = _lines[__index];
+    memcpy(_bytes(__index) + __offset, __p, __chunk);
+    if (__line.dirty_end <= __line.dirty_begin) __line.dirty_begin = __offset, __line.dirty_end = __offset + __chunk;
+    else {
+      if (__offset < __line.dirty_begin) __line.dirty_begin = __offset;
+      if (__offset + __chunk > __line.dirty_end) __line.dirty_end = __offset + __chunk;
+    }
+    aAddress += __chunk, __p += __chunk, aSize -= __chunk;
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void CacheDeviceBase::program(size_t aAddress, uint8_t aValue, ProgramMode aMode) {
+  if (_policy == WriteBack) { write(aAddress, &aValue, sizeof(aValue)); return; }
+
+  // 'Access' picks modes turning the cell into 'aValue'
+  _device.program(aAddress, aValue, aMode);
+  _transactions++;
+  int __line = _find(aAddress);
+  if (__line >= 0) _bytes(__line)[aAddress % _line_size] = aValue;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void CacheDeviceBase::flush() {
+  for (uint8_t __line = 0; __line < _count; __line++) _write_back(__line);
+  _device.flush();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void CacheDeviceBase::invalidate() {
+  for (uint8_t __line = 0; __line < _count; __line++)
+    _lines[__line].flags = 0, _lines[__line].dirty_begin = _lines[__line].dirty_end = 0;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void CacheDeviceBase::invalidate(size_t aAddress, size_t aSize) {
+  for (uint8_t __line = 0; __line < _count; __line++)
+    if (_lines[__line].address < aAddress + aSize && _lines[__line].address + _line_size > aAddress)
+      _lines[__line].flags = 0, _lines[__line].dirty_begin = _lines[__line].dirty_end = 0;
+}
+
+#if defined(EROM_HOST)
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+ImageFlash::ImageFlash(size_t aSectorSize, size_t aSectors, size_t aProgramSize) :
+  _sector_size(aSectorSize), _sectors(aSectors), _program_size(aProgramSize),
+  _erase_latency(DefaultEraseLatency), _program_latency(DefaultProgramLatency), _realtime(false), _busy_until(0)
+{
+  _image  = static_cast<uint8_t*>(malloc(aSectorSize * aSectors));
+  _erases = static_cast<uint32_t*>(calloc(aSectors, sizeof(uint32_t)));
+  memset(_image, 0xFF, aSectorSize * aSectors);
+  reset_stats();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+ImageFlash::~ImageFlash() { free(_image); free(_erases); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageFlash::_wait() const { while (!is_ready()) delayMicroseconds(100); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageFlash::read(size_t aAddress, void *aData, size_t aSize) {
+  _wait();
+  if (aAddress + aSize > _sector_size * _sectors) return;
+  memcpy(aData, _image + aAddress, aSize);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageFlash::program(size_t aAddress, const void *aData, size_t aSize) {
+  _wait();
+  if (aAddress + aSize > _sector_size * _sectors) { _violations++; return; }
+  if (aAddress % _program_size || aSize % _program_size) _violations++;
+
+  const uint8_t *__p = static_cast<const uint8_t*>(aData);
+  for (size_t __i = 0; __i < aSize; __i++) {
+    // Bits can't be set; multi-byte units (ECC) can't be programmed twice
+    uint8_t &__cell = _image[aAddress + __i];
+    if ((__cell & __p[__i]) != __p[__i] || (_program_size > 1 && __cell != 0xFF)) _violations++;
+    __cell &= __p[__i];
+  }
+
+  unsigned long __latency = (aSize + _program_size - 1) / _program_size * _program_latency;
+  _programming_time += __latency;
+  _bytes_programmed += aSize;
+  if (_realtime) delayMicroseconds(__latency);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageFlash::erase(size_t aSector) {
+  _wait();
+  if (aSector >= _sectors) return;
+  memset(_image + aSector * _sector_size, 0xFF, _sector_size);
+  _erases[aSector]++;
+  _programming_time += _erase_latency;
+  if (_realtime) _busy_until = micros() + _erase_latency;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool ImageFlash::is_ready() const { return !_realtime || (long)(micros() - _busy_until) >= 0; }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long ImageFlash::total_erases() const {
+  unsigned long __total = 0;
+  for (size_t __i = 0; __i < _sectors; __i++) __total += _erases[__i];
+  return __total;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long ImageFlash::max_erases() const {
+  unsigned long __max = 0;
+  for (size_t __i = 0; __i < _sectors; __i++) if (_erases[__i] > __max) __max = _erases[__i];
+  return __max;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void ImageFlash::reset_stats() {
+  _programming_time = _bytes_programmed = _violations = 0;
+  memset(_erases, 0, _sectors * sizeof(uint32_t));
+}
+#endif // EROM_HOST
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#ifdef EROM_WRITE_QUEUE_INTERRUPT
+ISR(EE_READY_vect) { erom::WriteQueue::service(); }
+#endif
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
@@ -6,7 +6,7 @@
 // header files but this one.
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 // Avoid linkage bugs in Arduino/AVR libraries
-#if ARDUINO <= 105
+#if ARDUINO <= 105 && defined(__AVR__)
 #ifndef __AVR_ATmega2560__
 #define __AVR_ATmega2560__
 #include <avr/eeprom.h>
@@ -16,8 +16,8 @@
 #endif // __AVR_ATmega2560__
 #endif
 
-// Arduino stuff
-#if ARDUINO >= 100
+// Arduino stuff (host builds use the 'Arduino.h' from 'extras/host')
+#if ARDUINO >= 100 || !defined(__AVR__)
 #include <Arduino.h> 
 #else
 #include <WProgram.h> 
@@ -25,10 +25,30 @@
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 // Includes all available functionality
+#include "erom_Crc.h"
+#include "erom_Device.h"
+#include "erom_ImageDevice.h"
+#include "erom_I2CDevice.h"
+#include "erom_FlashDevice.h"
+#include "erom_ImageFlash.h"
+#include "erom_CacheDevice.h"
+#include "erom_Stats.h"
+#include "erom_Trace.h"
+#include "erom_Batch.h"
 #include "erom_Access.h"
+#include "erom_Codec.h"
 #include "erom_Entry.h"
+#include "erom_Layout.h"
+#include "erom_WearLeveledEntry.h"
+#include "erom_MonotonicCounter.h"
+#include "erom_EntryArray.h"
 #include "erom_Storage.h"
+#include "erom_SaveScheduler.h"
 #include "erom_VerifiedStorage.h"
+#include "erom_BankedStorage.h"
+#include "erom_ShadowStorage.h"
+#include "erom_KVStore.h"
+#include "erom_SeriesLog.h"
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
@@ -4,26 +4,116 @@
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 #include <inttypes.h>
+#include "erom_Batch.h"
+#include "erom_Crc.h"
+#include "erom_Device.h"
+#include "erom_Stats.h"
+#include "erom_Trace.h"
+#include "erom_WriteQueue.h"
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 namespace erom {
 
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Define 'EROM_NATIVE_ONLY' for sketches working with the chip's own EEPROM
+// only: 'Access' then holds no 'Device' pointer and checks none, so every
+// transfer compiles to the plain avr-libc calls, and 'Access(Device&)' is
+// not available. Set through compiler flags, so the library and the sketch
+// see the same value.
+
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 // Provides basic access (read/write) to EEPROM. Works with basic types,
-// strings and structs.
+// strings and structs. Works with the chip's own EEPROM by default, or with
+// any given 'Device'.
 class Access {
 private:
+#ifndef EROM_NATIVE_ONLY
+  Device *_device;
+  inline Device *_dev() const { return _device; }
+#else
+  inline Device *_dev() const { return NULL; }  // Device branches fold away
+#endif
   size_t _base, _memory_size;
+  bool _async;
+  WriteQueue::Policy _queue_policy;
+  mutable unsigned long _bytes_written;
+
+  // Raw transfers, no range checking. Reads see bytes still pending in the
+  // write queue; writes are either queued or programmed right away.
+  inline void _read(size_t aAddress, void *aData, size_t aSize) const {
+    EROM_STATS_READ(aAddress + base(), aSize);
+    EROM_TRACE_READ(aAddress + base(), aSize);
+    if (_dev()) _dev()->read(aAddress + base(), aData, aSize);
+    else if (WriteQueue::pending()) WriteQueue::read(aAddress + base(), aData, aSize);
+    else NativeDevice::read(aAddress + base(), aData, aSize);
+  }
 
-  template<class T> inline void  _read_block(size_t aAddress, T &aValue) const {
-    eeprom_read_block((void*)&aValue, reinterpret_cast<const void*>(aAddress + base()), sizeof(aValue));
+  inline bool _write(size_t aAddress, const void *aData, size_t aSize) const {
+    EROM_STATS_TIMER();
+    if (_dev()) _dev()->write(aAddress + base(), aData, aSize);
+    else if (_async) { if (!WriteQueue::push(aAddress + base(), aData, aSize, _queue_policy)) return false; }
+    else {
+      if (WriteQueue::pending()) WriteQueue::flush(); // Keep order with queued bytes
+      NativeDevice::write(aAddress + base(), aData, aSize);
+    }
+    EROM_STATS_WRITE(aAddress + base(), aSize);
+    EROM_TRACE_WRITE(aAddress + base(), aData, aSize);
+    _bytes_written += aSize;
+    return true;
   }
 
-  template<class T> inline void _write_block(size_t aAddress, const T &aValue) const {
-    eeprom_write_block(reinterpret_cast<const void*>(&aValue), reinterpret_cast<void*>(aAddress + base()), sizeof(aValue));
+  template<class T> inline T _read_value(size_t aAddress) const {
+    T __value = 0;
+    if (in_range(aAddress + sizeof(T))) _read(aAddress, &__value, sizeof(T));
+    return __value;
   }
 
+  template<class T> inline bool _write_value(size_t aAddress, const T &aValue) const {
+    return in_range(aAddress + sizeof(T)) && _write(aAddress, &aValue, sizeof(T));
+  }
+
+  // Programs a single changed byte with the given mode (see 'program_mode()')
+  inline bool _program(size_t aAddress, uint8_t aValue, ProgramMode aMode) const {
+    EROM_STATS_TIMER();
+    if (_dev()) _dev()->program(aAddress + base(), aValue, aMode);
+    else if (_async) { if (!WriteQueue::push(aAddress + base(), &aValue, sizeof(aValue), _queue_policy)) return false; }
+    else {
+      if (WriteQueue::pending()) WriteQueue::flush();
+      NativeDevice::program(aAddress + base(), aValue, aMode);
+    }
+    EROM_STATS_WRITE(aAddress + base(), sizeof(aValue));
+    EROM_TRACE_WRITE(aAddress + base(), &aValue, sizeof(aValue));
+    _bytes_written++;
+    return true;
+  }
+
+  // Returns true if queued writes fail when the queue is full, instead of
+  // waiting for room ('RejectOnFull')
+  inline bool _rejecting() const { return !_dev() && _async && _queue_policy == WriteQueue::RejectOnFull; }
+  // Returns number of bytes of 'aData' which differ from EEPROM (or from
+  // 'aStored'), no range checking
+  size_t _changed(size_t aAddress, const uint8_t *aData, size_t aSize, const uint8_t *aStored = NULL) const;
+  // Returns false if the queue rejects writes and has no room for every
+  // changed byte. Bytes are queued one by one: a value must not be cut where
+  // the room runs out. Pending bytes of the same cells would be overwritten
+  // in place, so this may reject an update which just fits
+  inline bool _fits(size_t aAddress, const void *aData, size_t aSize, const void *aStored = NULL) const {
+    return !_rejecting() || _changed(aAddress, static_cast<const uint8_t*>(aData), aSize, static_cast<const uint8_t*>(aStored)) <= WriteQueue::available();
+  }
+
+  // Writes bytes of 'aData' which differ from EEPROM, no range checking.
+  // Returns number of bytes written
+  // With 'aTime', nothing is written: the estimated programming time is
+  // added to it instead. With 'aStored', EEPROM is taken to hold those bytes
+  // and is not read
+  size_t _update(size_t aAddress, const void *aData, size_t aSize, unsigned long *aTime = NULL, const uint8_t *aStored = NULL) const;
+
+  inline unsigned long _cycle_time(ProgramMode aMode) const { return _dev() ? _dev()->cycle_time(aMode) : NativeDevice::cycle_time(aMode); }
+
+  template<class T> inline void  _read_block(size_t aAddress, T &aValue) const { _read(aAddress, &aValue, sizeof(aValue)); }
+  template<class T> inline bool _write_block(size_t aAddress, const T &aValue) const { return _write(aAddress, &aValue, sizeof(aValue)); }
+
 public:
   // Constructor
   // Use aBase to specify offset of the zero address.
@@ -32,14 +122,23 @@ public:
   //   access.write(4, 0x1F); // Write 0x1F to EEPROM at address 36
   Access(size_t aBase = 0);
 
+#ifndef EROM_NATIVE_ONLY
+  // Constructor for a non-native storage device. Memory size is set to the
+  // device's size.
+  // Example:
+  //   erom::ImageDevice image("eeprom.bin", 4096); // Host-side EEPROM image
+  //   erom::Access access(image);
+  Access(Device &aDevice, size_t aBase = 0);
+#endif
+
   /////////////////////////////////////////////////////////////////////////////
   // Read data from EEPROM methods set. Return read data or 0 if failed
   inline uint8_t  read       (size_t aAddress) const { return read_byte(aAddress); }
          bool     read_bit   (size_t aAddress, uint8_t aBit) const;
-  inline uint8_t  read_byte  (size_t aAddress) const { return in_range(aAddress + sizeof(uint8_t))  ? eeprom_read_byte (reinterpret_cast<unsigned char*>(aAddress + base())) : 0; }
+  inline uint8_t  read_byte  (size_t aAddress) const { return _read_value<uint8_t>(aAddress); }
   inline char     read_char  (size_t aAddress) const { return static_cast<char>(read_byte(aAddress)); }
-  inline uint16_t read_int   (size_t aAddress) const { return in_range(aAddress + sizeof(uint16_t)) ? eeprom_read_word (reinterpret_cast<uint16_t*>(aAddress + base()))      : 0; }
-  inline uint32_t read_long  (size_t aAddress) const { return in_range(aAddress + sizeof(uint32_t)) ? eeprom_read_dword(reinterpret_cast<unsigned long*>(aAddress + base())) : 0; }
+  inline uint16_t read_int   (size_t aAddress) const { return _read_value<uint16_t>(aAddress); }
+  inline uint32_t read_long  (size_t aAddress) const { return _read_value<uint32_t>(aAddress); }
          float    read_float (size_t aAddress) const; // Returns 0.f if failed
          double   read_double(size_t aAddress) const; // Returns 0.  if failed
 
@@ -47,10 +146,10 @@ public:
   // Write data methods set. Returns true if succeeded.
   inline bool write       (size_t aAddress, uint8_t  aValue) const { return write_byte(aAddress, aValue); }
          bool write_bit   (size_t aAddress, uint8_t  aBit, bool aValue) const { return update_bit(aAddress, aBit, aValue); }
-  inline bool write_byte  (size_t aAddress, uint8_t  aValue) const { return in_range(aAddress + sizeof(uint8_t))  ? eeprom_write_byte(reinterpret_cast<unsigned char*>(aAddress + base()), aValue), true : false; }
+  inline bool write_byte  (size_t aAddress, uint8_t  aValue) const { return _write_value<uint8_t>(aAddress, aValue); }
   inline bool write_char  (size_t aAddress, char     aValue) const { return write_byte(aAddress, (uint8_t)aValue); }
-  inline bool write_int   (size_t aAddress, uint16_t aValue) const { return in_range(aAddress + sizeof(uint16_t)) ? eeprom_write_word(reinterpret_cast<uint16_t*>(aAddress + base()), aValue),      true : false; }
-  inline bool write_long  (size_t aAddress, uint32_t aValue) const { return in_range(aAddress + sizeof(uint32_t)) ? eeprom_write_dword(reinterpret_cast<unsigned long*>(aAddress + base()), aValue),true : false; }
+  inline bool write_int   (size_t aAddress, uint16_t aValue) const { return _write_value<uint16_t>(aAddress, aValue); }
+  inline bool write_long  (size_t aAddress, uint32_t aValue) const { return _write_value<uint32_t>(aAddress, aValue); }
   inline bool write_float (size_t aAddress, float    aValue) const { return write_block<float>(aAddress, aValue) != 0; }
   inline bool write_double(size_t aAddress, double   aValue) const { return write_block<double>(aAddress, aValue) != 0; }
 
@@ -64,7 +163,7 @@ public:
   inline bool update_int   (size_t aAddress, uint16_t aValue) const { return update_block<uint16_t>(aAddress, aValue) != 0; }
   inline bool update_long  (size_t aAddress, uint32_t aValue) const { return update_block<uint32_t>(aAddress, aValue) != 0; }
   inline bool update_float (size_t aAddress, float aValue)    const { return update_block<float>(aAddress, aValue) != 0; }
-  inline bool update_double(size_t aAddress, double aValue)   const { return write_block<double>(aAddress, aValue) != 0; }
+  inline bool update_double(size_t aAddress, double aValue)   const { return update_block<double>(aAddress, aValue) != 0; }
 
   /////////////////////////////////////////////////////////////////////////////
   // Templates for complex data types
@@ -85,9 +184,9 @@ public:
   // Example:
   //  int data[4];
   //  erom::access.read_block(0, data, 10);
-  template<class T> size_t read_block(size_t aAddress, T aValue[], int aItems) const {
+  template<class T> size_t read_block(size_t aAddress, T aValue[], size_t aItems) const {
     if (!in_range(aAddress + aItems * sizeof(T))) return 0;
-    for (size_t __i = 0; __i < aItems; __i++) _read_block<T>(aAddress + __i * sizeof(T), aValue[__i]);
+    _read(aAddress, aValue, aItems * sizeof(T));
     return aItems;
   }
 
@@ -99,7 +198,7 @@ public:
   //  erom::access.write_block(0, data);
   template<class T> inline bool write_block(size_t aAddress, const T& aValue) const {
     if (!in_range(aAddress + sizeof(aValue))) return false;
-    else { _write_block(aAddress, aValue); return true; }
+    else return _write_block(aAddress, aValue);
   }
 
   // Write an array to EEPROM
@@ -109,11 +208,12 @@ public:
   //  erom::access.write_block(0, data, 4);
   template<class T> size_t write_block(size_t aAddress, const T aValue[], size_t aItems) const {
     if (!in_range(aAddress + aItems * sizeof(T))) return 0;
-    for (size_t __i = 0; __i < aItems; __i++) _write_block<T>(aAddress + __i * sizeof(T), aValue[__i]);
-    return aItems;
+    return _write(aAddress, aValue, aItems * sizeof(T)) ? aItems : 0;
   }
 
-  // Write user-defined type to EEPROM (changes only)
+  // Write user-defined type to EEPROM (changes only). Stored bytes are read
+  // in blocks and every changed byte is programmed with the cheapest mode:
+  // write-only if it only clears bits, erase-only if it becomes 0xFF.
   // Returns number of bytes written to EEPROM
   // Example:
   //  struct data_t { int a, b; };
@@ -121,16 +221,9 @@ public:
   //  erom::access.write_block(0, data); // write whole 'data' to EEPROM
   //  data.a = 30;
   //  erom::access.update_block(0, data); // write 'data.a' only to EEPROM
-  template<class T> size_t update_block(size_t aAddress, const T &aValue) const {
-    if (!in_range(aAddress + sizeof(aValue))) return 0;
-    const uint8_t *__p = reinterpret_cast<const uint8_t*>(&aValue);
-    size_t __written = 0;
-
-    for (size_t __i = 0; __i < sizeof(aValue); __i++) {
-      if (read(aAddress) != *__p) write(aAddress, *__p), __written++;    
-      aAddress++, __p++;
-    }
-    return __written;
+  template<class T> inline size_t update_block(size_t aAddress, const T &aValue) const {
+    if (!in_range(aAddress + sizeof(aValue)) || !_fits(aAddress, &aValue, sizeof(aValue))) return 0;
+    return _update(aAddress, &aValue, sizeof(aValue));
   }
 
   // Write an array to EEPROM (changes only)
@@ -141,14 +234,74 @@ public:
   //  data[0] = 5; data[3] = 6;
   //  erom::access.update_block(0, data, 4); // write 'data[0]' and 'data[3]' only
   template<class T> size_t update_block(size_t aAddress, const T aValue[], size_t aItems) const {
-    if (!in_range(aAddress + aItems * sizeof(T))) return 0;
-    for (size_t __i = 0; __i < aItems; __i++)
-      update_block<T>(aAddress + (__i * sizeof(T)), aValue[__i]);
+    if (!in_range(aAddress + aItems * sizeof(T)) || !_fits(aAddress, aValue, aItems * sizeof(T))) return 0;
+    _update(aAddress, aValue, aItems * sizeof(T));
     return aItems;
   }
 
-  // Returns true if EEPROM is ready for work
-  inline bool is_ready() const { return eeprom_is_ready(); }
+  // Write bytes of 'aData' which differ from 'aStored', the caller's RAM copy
+  // of what EEPROM holds at 'aAddress' (see 'ShadowStorage'), like
+  // 'update_block()' but without reading EEPROM.
+  // Returns number of bytes written to EEPROM
+  inline size_t update_known(size_t aAddress, const void *aData, const void *aStored, size_t aSize) const {
+    if (!in_range(aAddress + aSize) || !_fits(aAddress, aData, aSize, aStored)) return 0;
+    return _update(aAddress, aData, aSize, NULL, static_cast<const uint8_t*>(aStored));
+  }
+
+  // Write bytes of 'aData' which differ from EEPROM (or from 'aStored', as
+  // 'update_known()'). Unlike 'update_block()' tells a rejected update from
+  // one with nothing to write: returns false, writing nothing, if out of
+  // range or the queue has no room for every changed byte ('RejectOnFull'),
+  // true otherwise
+  inline bool update_bytes(size_t aAddress, const void *aData, size_t aSize, const void *aStored = NULL) const {
+    if (!in_range(aAddress + aSize) || !_fits(aAddress, aData, aSize, aStored)) return false;
+    _update(aAddress, aData, aSize, NULL, static_cast<const uint8_t*>(aStored));
+    return true;
+  }
+
+  // Run the writes and updates of 'aBatch' (see 'Batch') as one sequence in
+  // address order, bytes overwritten within the batch only once. On devices
+  // programming bytes one by one (the chip's own EEPROM) stored bytes of
+  // adjacent operations are read together, and read and compared while the
+  // previous byte is being programmed; paged devices get a write or update
+  // per run of bytes of an operation. Sorts the batch.
+  // Returns number of bytes written to EEPROM, 0 without writing anything if
+  // any operation does not fit the range, or if the queue rejects writes
+  // and has no room for all of them
+  // Example:
+  //  erom::Batch<8> batch;
+  //  for (int i = 0; i < 8; i++) batch.update(i * sizeof(long), counters[i]);
+  //  erom::access.commit(batch);
+  size_t commit(BatchBase &aBatch) const;
+
+  // Estimated microseconds 'update_block()' takes to store 'aValue' (0 if
+  // EEPROM already holds it), from the stored bytes and the device's
+  // 'Device::cycle_time()'. Writes nothing
+  template<class T> inline unsigned long update_time(size_t aAddress, const T &aValue) const {
+    unsigned long __time = 0;
+    if (in_range(aAddress + sizeof(aValue))) _update(aAddress, &aValue, sizeof(aValue), &__time);
+    return __time;
+  }
+
+  // Estimated microseconds 'update_block()' takes to store an array
+  template<class T> unsigned long update_time(size_t aAddress, const T aValue[], size_t aItems) const {
+    unsigned long __time = 0;
+    if (in_range(aAddress + aItems * sizeof(T))) _update(aAddress, aValue, aItems * sizeof(T), &__time);
+    return __time;
+  }
+
+  // Estimated microseconds writing 'aSize' bytes at 'aAddress' takes
+  unsigned long write_time(size_t aAddress, size_t aSize) const;
+
+  // Continue CRC-16 'aCrc' (see 'erom::crc16()') over 'aSize' bytes of EEPROM
+  // read in blocks. Returns 'aCrc' unchanged if the range does not fit
+  // Example:
+  //  uint16_t crc = erom::access.crc16(0, 64);
+  uint16_t crc16(size_t aAddress, size_t aSize, uint16_t aCrc = crc16_init) const;
+
+  // Returns true if EEPROM is ready for work (nothing is being programmed and
+  // the write queue is empty)
+  inline bool is_ready() const { return _dev() ? _dev()->is_ready() : !WriteQueue::pending() && NativeDevice::is_ready(); }
   // Returns true if given address fits the range 'base()' .. 'memory_size()'
   inline bool in_range(size_t aAddress) const { return aAddress + base() < memory_size(); }
 
@@ -160,6 +313,47 @@ public:
   inline size_t memory_size() const { return _memory_size; }
   inline void   memory_size(size_t aMemorySize) { _memory_size = aMemorySize; }
 
+  /////////////////////////////////////////////////////////////////////////////
+  // Asynchronous write mode. When enabled, write and update methods only put
+  // bytes into the RAM write queue (see 'WriteQueue') and return right away;
+  // the EE_READY interrupt programs them into EEPROM in the background. Reads
+  // see queued bytes, so data stays coherent. Applies to the native device.
+  // Example:
+  //  erom::access.async(true);
+  //  storage.save();         // Returns after queueing, not after ~3.4 ms/byte
+  //  ...
+  //  erom::access.flush();   // Wait for everything to reach EEPROM (e.g. before sleep)
+  inline bool async() const { return _async; }
+  inline void async(bool aAsync) { _async = aAsync; }
+
+  // What asynchronous writes do when the queue is full. With 'RejectOnFull'
+  // write methods return false (0 for blocks) and queue nothing.
+  inline WriteQueue::Policy queue_policy() const { return _queue_policy; }
+  inline void queue_policy(WriteQueue::Policy aPolicy) { _queue_policy = aPolicy; }
+  // Returns true if 'aBytes' bytes can be written now, false if the queue
+  // would reject some of them. For writes of several calls which must all
+  // be taken
+  inline bool fits(size_t aBytes) const { return !_rejecting() || aBytes <= WriteQueue::available(); }
+
+  // Amount of bytes waiting to be programmed into EEPROM
+  inline size_t pending() const { return WriteQueue::pending(); }
+  // Blocks until all queued bytes are programmed into EEPROM, or until the
+  // device wrote out everything it held back (see 'Device::flush()')
+  inline void flush() const { EROM_STATS_TIMER(); if (_dev()) _dev()->flush(); else WriteQueue::flush(); }
+  // Estimated microseconds 'flush()' takes to program queued bytes. Bytes a
+  // device holds back are not accounted
+  inline unsigned long flush_time() const { return _dev() ? 0 : WriteQueue::pending() * NativeDevice::cycle_time(EraseWrite); }
+
+  // Lets the device do a slice of background work, see 'Device::tick()'.
+  // Called by 'Storage::tick()'
+  inline void tick() const { if (_dev()) _dev()->tick(); }
+
+  // Bytes written (or queued) through this access since it was created
+  inline unsigned long bytes_written() const { return _bytes_written; }
+
+  // Storage device, NULL for the chip's own EEPROM
+  inline Device *device() const { return _dev(); }
+
 public:
   // Chip's EEPROM actual size
   static size_t device_memory_size();
@@ -0,0 +1,133 @@
+#ifndef _ROBODEM_EROM_BANKED_STORAGE_H_
+#define _ROBODEM_EROM_BANKED_STORAGE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Access.h"
+#include "erom_Storage.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'Storage' keeping two copies (banks) of its entries, so a power loss in
+// the middle of 'save()' never leaves a torn image behind. A save goes to the
+// inactive bank and is committed last by writing the bank's record: a
+// generation number and a CRC-16 of the bank. 'load()' picks the valid bank
+// with the newest generation; a half-written bank fails its CRC and the
+// previous snapshot is loaded instead.
+//
+// The inactive bank holds the image committed before the current one, so a
+// save only programs the bytes which differ from it: the changes of this
+// save and of the previous one.
+//
+// EEPROM layout, starting at the access' base:
+//   [bank 0: 'aBankSize' bytes][record 0][bank 1: 'aBankSize' bytes][record 1]
+// NOTE: entries must be saved through the storage ('save()', 'tick()'), not
+// one by one, nor loaded one by one during a resumable save ('begin_save()'),
+// which has the inactive bank selected. Use plain 'Entry' objects;
+// 'WearLeveledEntry' already rotates its own slots and gains nothing from
+// banking.
+// Example:
+//  class Settings : public erom::BankedStorage {
+//  public:
+//    erom::Entry<long> counter;
+//    Settings() : BankedStorage(32) { issue(counter); }
+//  } settings;
+//
+//  settings.load();
+//  if (!settings.valid()) settings.clear(); // Nothing committed yet
+class BankedStorage : public Storage {
+public:
+  // Bytes of a bank a step of a resumable pass reads to check it
+  static const size_t ScanChunk = 32;
+
+private:
+  struct Record {
+    uint16_t generation;
+    uint16_t crc;
+  };
+
+  Access &_target;      // Access to the whole banked region
+  Access  _bank;        // Access to a single bank, given to issued entries
+  size_t  _bank_size;
+  uint8_t _active;      // Bank holding the newest committed image
+  uint8_t _selected;    // Bank '_bank' gives access to
+  uint16_t _generation;
+  bool _valid;
+  bool _uncommitted;    // Inactive bank partly written by a resumable save
+
+  // Bank CRC taken 'ScanChunk' bytes per step of a resumable pass
+  uint8_t _scan_bank;
+  size_t _scan_offset;
+  uint16_t _scan_crc;
+  bool _scan_valid[2];
+  uint16_t _scan_generation[2];
+
+  inline size_t _bank_address(uint8_t aBank) const { return aBank * (_bank_size + sizeof(Record)); }
+  inline size_t _record_address(uint8_t aBank) const { return _bank_address(aBank) + _bank_size; }
+  inline void _scan_reset(uint8_t aBank = 0) { _scan_bank = aBank, _scan_offset = 0, _scan_crc = crc16_init; }
+
+  void _select(uint8_t aBank);
+  // Checks the record of 'aBank' against CRC 'aCrc' of its bytes
+  bool _check(uint8_t aBank, uint16_t aCrc, uint16_t &aGeneration);
+  // Selects the newest valid bank, if any
+  void _pick(const bool aValid[2], const uint16_t aGeneration[2]);
+  // Writes the record of 'aBank' of CRC 'aCrc', making it the active one
+  void _commit(uint8_t aBank, uint16_t aCrc);
+  // Continues the bank CRC by a chunk. Returns true once it covers the bank
+  bool _scan(uint8_t aBank);
+
+protected:
+  // Loads entries from the newest valid bank. Nothing is loaded if neither
+  // bank is valid (see 'valid()').
+  // NOTE: when overridden, 'BankedStorage::OnLoad()' must be called by user
+  virtual void OnLoad();
+  // Writes changed entries to the inactive bank and commits it.
+  // NOTE: when overridden, 'BankedStorage::OnSave()' must be called by user
+  virtual void OnSave();
+  // Saves like 'OnSave()' if the whole save fits 'aBudget', otherwise
+  // nothing: a partly written bank would fail its CRC anyway.
+  // NOTE: when overridden, 'BankedStorage::OnFlush()' must be called by user
+  virtual unsigned long OnFlush(unsigned long aBudget);
+  // Resumable load: both banks are checked first, a chunk of 'ScanChunk'
+  // bytes per step, then entries are loaded from the newest valid one.
+  // NOTE: when overridden, 'BankedStorage::OnBeginLoad()' must be called by user
+  virtual bool OnBeginLoad();
+  // Resumable save: every entry is saved to the inactive bank, which is then
+  // checked a chunk per step and committed by the last one. Until then
+  // 'load()' and a power loss see the previous image.
+  // NOTE: when overridden, 'BankedStorage::OnBeginSave()' and
+  // 'BankedStorage::OnEndSave()' must be called by user
+  virtual bool OnBeginSave();
+  virtual bool OnEndSave();
+  // NOTE: when overridden, 'BankedStorage::OnCancel()' must be called by user
+  virtual void OnCancel() { _scan_reset(); }
+
+public:
+  // Create banked storage of two 'aBankSize' byte banks with default access
+  BankedStorage(size_t aBankSize);
+  // Create banked storage of two 'aBankSize' byte banks with given access
+  BankedStorage(Access &aAccess, size_t aBankSize);
+
+  // Returns true if the last 'load()' found a committed bank, or a 'save()'
+  // committed one since
+  inline bool valid() const { return _valid; }
+  // Generation of the newest committed image, incremented by every save
+  inline uint16_t generation() const { return _generation; }
+  // Bank holding the newest committed image
+  inline uint8_t active_bank() const { return _active; }
+  // Size of a single bank, in bytes
+  inline size_t bank_size() const { return _bank_size; }
+  // Amount of EEPROM taken by both banks and their records
+  inline size_t footprint() const { return 2 * (_bank_size + sizeof(Record)); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_BANKED_STORAGE_H_
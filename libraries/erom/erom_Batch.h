@@ -0,0 +1,93 @@
+#ifndef _ROBODEM_EROM_BATCH_H_
+#define _ROBODEM_EROM_BATCH_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// A list of writes and updates for 'Access::commit()' to run as one
+// sequence, in address order. Where operations overlap, the one added last
+// wins and the bytes it covers are not written by the others.
+// Data is not copied: the objects given must live until the batch is
+// committed, and a batch committed again stores their current values.
+class BatchBase {
+friend class Access;
+
+public:
+  enum Mode { Write = 0, Update = 1 };
+
+  struct Op {
+    size_t address, size;
+    const void *data;
+    uint8_t mode, order;    // 'Mode', position in the order added
+  };
+
+private:
+  Op *_ops;
+  uint8_t _capacity, _count;
+  bool _sorted;
+
+  // Sorts operations by address, keeping the order added among equal ones
+  void _sort();
+  // Finds the next bytes a single operation writes, in sorted operations:
+  // moves 'aAddress' to the first byte covered from there on, sets 'aEnd' to
+  // where the run ends and 'aOp' to the operation added last covering it.
+  // 'aFirst' is the first operation which may end past 'aAddress'. Returns
+  // false past the last operation
+  bool _segment(size_t &aAddress, size_t &aEnd, const Op *&aOp, uint8_t &aFirst) const;
+
+protected:
+  BatchBase(Op *aOps, uint8_t aCapacity) : _ops(aOps), _capacity(aCapacity), _count(0), _sorted(true) { /* Do Nothing */ }
+
+public:
+  // Adds an operation of 'aSize' bytes at 'aAddress'. Returns false if the
+  // batch is full
+  bool add(size_t aAddress, const void *aData, size_t aSize, Mode aMode);
+
+  // Write (whole) or update (changes only) user-defined type or an array,
+  // as 'Access::write_block()' and 'Access::update_block()'. Returns false if
+  // the batch is full
+  template<class T> inline bool write(size_t aAddress, T &aValue) { return add(aAddress, &aValue, sizeof(aValue), Write); }
+  template<class T> inline bool write(size_t aAddress, const T aValue[], size_t aItems) { return add(aAddress, aValue, aItems * sizeof(T), Write); }
+  template<class T> inline bool update(size_t aAddress, T &aValue) { return add(aAddress, &aValue, sizeof(aValue), Update); }
+  template<class T> inline bool update(size_t aAddress, const T aValue[], size_t aItems) { return add(aAddress, aValue, aItems * sizeof(T), Update); }
+
+  inline void clear() { _count = 0, _sorted = true; }
+  inline uint8_t count() const { return _count; }
+  inline uint8_t capacity() const { return _capacity; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'BatchBase' of up to 'Capacity' operations (255 at most).
+// Example:
+//  struct limits_t { int lo, hi; } limits;   // 4 bytes on AVR
+//  long counter;
+//  char name[8];
+//  erom::Batch<4> batch;
+//  batch.update(0, limits);
+//  batch.update(4, counter);
+//  batch.write(16, name, 8);
+//  erom::access.commit(batch);  // Changed bytes of 0 .. 7, all of 16 .. 23
+template<size_t Capacity> class Batch : public BatchBase {
+private:
+  typedef char _capacity_check[Capacity > 0 && Capacity < 256 ? 1 : -1];
+
+  Op _buffer[Capacity];
+
+public:
+  Batch() : BatchBase(_buffer, Capacity) { /* Do Nothing */ }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_BATCH_H_
@@ -0,0 +1,136 @@
+#ifndef _ROBODEM_EROM_CACHE_DEVICE_H_
+#define _ROBODEM_EROM_CACHE_DEVICE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Device.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Read-through cache of fixed-size lines in RAM in front of a slow 'Device'
+// (e.g. 'I2CDevice', where every read is a bus transaction). Give it to
+// 'Access' instead of the device: reads, and the read-back of 'Access'
+// update methods comparing against stored bytes, are served from cached
+// lines; a missing line is fetched from the device in one read.
+//
+// With 'WriteThrough' every write goes to the device right away and updates
+// cached lines it covers (lines are not allocated for writes). With
+// 'WriteBack' writes only go into lines, and changed bytes of a line are
+// written to the device in one write when the line is evicted or on
+// 'Access::flush()'. Evicted lines are picked least recently used ('LRU') or
+// by a second-chance 'Clock' sweep, which is cheaper to keep track of.
+//
+// The cache does not see changes made to the device behind its back; call
+// 'invalidate()' after them. 'invalidate()' drops changed lines not written
+// back yet, 'flush()' first to keep them.
+class CacheDeviceBase : public Device {
+public:
+  enum Policy {
+    WriteThrough,   // Writes go to the device and cached lines
+    WriteBack       // Writes go to lines, the device gets them on eviction or flush
+  };
+
+  enum Eviction {
+    LRU,            // Least recently used line
+    Clock           // First line not used since the last sweep
+  };
+
+protected:
+  struct Line {
+    size_t address;           // Device address of the first byte
+    uint16_t used;            // Access stamp, for 'LRU'
+    uint8_t flags;
+    uint8_t dirty_begin, dirty_end;   // Changed bytes not written back
+  };
+
+private:
+  enum { valid = 1, referenced = 2 };
+
+  Device &_device;
+  Line *_lines;
+  uint8_t *_data;
+  uint8_t _count, _line_size;
+  Policy _policy;
+  Eviction _eviction;
+  uint16_t _stamp;
+  uint8_t _hand;            // 'Clock' position
+  unsigned long _hits, _misses, _transactions;
+
+  inline uint8_t *_bytes(uint8_t aLine) const { return _data + (size_t)aLine * _line_size; }
+  inline size_t _fill_size(size_t aAddress) const { return aAddress + _line_size <= size() ? _line_size : size() - aAddress; }
+
+  int _find(size_t aAddress) const;
+  uint8_t _victim();
+  void _write_back(uint8_t aLine);
+  uint8_t _load(size_t aAddress, bool aFetch);
+
+protected:
+  CacheDeviceBase(Device &aDevice, Line *aLines, uint8_t *aData, uint8_t aCount, uint8_t aLineSize, Policy aPolicy, Eviction aEviction);
+
+public:
+  virtual size_t size() const { return _device.size(); }
+  virtual void read (size_t aAddress, void *aData, size_t aSize);
+  virtual void write(size_t aAddress, const void *aData, size_t aSize);
+  virtual void program(size_t aAddress, uint8_t aValue, ProgramMode aMode);
+  virtual bool is_ready() const { return _device.is_ready(); }
+  virtual unsigned long cycle_time(ProgramMode aMode) const { return _device.cycle_time(aMode); }
+  virtual size_t page_size() const { return _device.page_size(); }
+  // Writes changed lines back, then flushes the device
+  virtual void flush();
+  virtual void tick() { _device.tick(); }
+
+  // Drops all cached lines, or those covering 'aSize' bytes at 'aAddress'.
+  // Changes not written back are lost
+  void invalidate();
+  void invalidate(size_t aAddress, size_t aSize);
+
+  // Write policy. Switching to 'WriteThrough' writes changed lines back
+  inline Policy policy() const { return _policy; }
+  inline void policy(Policy aPolicy) { if (aPolicy == WriteThrough) flush(); _policy = aPolicy; }
+  inline Eviction eviction() const { return _eviction; }
+  inline void eviction(Eviction aEviction) { _eviction = aEviction; }
+
+  // Line reads served from RAM and fetched from the device, the hit rate in
+  // percent, and reads and writes sent to the device, since start or
+  // 'reset_stats()'
+  inline unsigned long hits() const { return _hits; }
+  inline unsigned long misses() const { return _misses; }
+  inline uint8_t hit_rate() const { return _hits + _misses ? _hits * 100 / (_hits + _misses) : 0; }
+  inline unsigned long transactions() const { return _transactions; }
+  inline void reset_stats() { _hits = _misses = _transactions = 0; }
+
+  // Cached device
+  inline Device &device() const { return _device; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'CacheDeviceBase' of 'Lines' lines of 'LineSize' bytes (up to 255 each).
+// Takes about 'Lines * (LineSize + 9)' bytes of RAM on AVR.
+// Example:
+//  erom::I2CDevice<TwoWire> chip(Wire, 0x50, 32768, 64);
+//  erom::CacheDevice<4, 16> cache(chip);        // 4 lines of 16 bytes
+//  erom::Access external(cache);
+//  ...
+//  storage.save();                               // Compares against cached lines
+template<size_t Lines, size_t LineSize = 16> class CacheDevice : public CacheDeviceBase {
+private:
+  typedef char _size_check[Lines > 0 && Lines < 256 && LineSize > 0 && LineSize < 256 ? 1 : -1];
+
+  Line _line_buffer[Lines];
+  uint8_t _buffer[Lines * LineSize];
+
+public:
+  CacheDevice(Device &aDevice, Policy aPolicy = WriteThrough, Eviction aEviction = LRU) :
+    CacheDeviceBase(aDevice, _line_buffer, _buffer, Lines, LineSize, aPolicy, aEviction) { invalidate(); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_CACHE_DEVICE_H_
@@ -0,0 +1,181 @@
+#ifndef _ROBODEM_EROM_CODEC_H_
+#define _ROBODEM_EROM_CODEC_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Codecs turn an 'Entry' value into the bytes stored in EEPROM and back.
+// A codec is a class of static members:
+//   enum { raw = 0, size = N };  // N - most bytes an encoded value takes
+//   static size_t encode(const T &aValue, uint8_t *aData); // Returns bytes used
+//   static void decode(T &aValue, const uint8_t *aData);
+// 'Storage::issue()' gives an entry 'size' bytes, 'save()' programs the
+// bytes 'encode()' used only. Entries of 'raw' codecs store the value's own
+// bytes through the same code as before codecs existed, so they cost
+// nothing extra.
+
+// Selects 'Entry' code for raw (1) and encoded (0) values at compile time
+template<int Raw> struct CodecTag {};
+
+// Unsigned integer wide enough for 'Size' bytes
+template<size_t Size> struct CodecWord { typedef uint32_t type; };
+template<> struct CodecWord<8> { typedef uint64_t type; };
+
+// Value bytes as they are
+template<typename T> struct RawCodec {
+  enum { raw = 1, size = sizeof(T) };
+  static inline size_t encode(const T &aValue, uint8_t *aData) { memcpy(aData, &aValue, sizeof(T)); return sizeof(T); }
+  static inline void decode(T &aValue, const uint8_t *aData) { memcpy(&aValue, aData, sizeof(T)); }
+};
+
+// Default codec of 'Entry<T>'. Specialize it for your own types to store
+// them encoded everywhere; pass a codec to 'Entry' for built-in types.
+// Example:
+//  namespace erom { template<> struct Codec<Flags> : BitfieldCodec<Flags, 2> {}; }
+//  erom::Entry<Flags> flags;                 // Takes 2 bytes
+template<typename T> struct Codec : RawCodec<T> {};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Integer in 7 bits per byte, high bit set on all bytes but the last one, so
+// small values take (and change) fewer bytes. Signed values are zigzag
+// coded first (0, -1, 1, -2... become 0, 1, 2, 3...). 'Bytes' caps the size,
+// values out of the range it holds (e.g. -8192 .. 8191 for 2 bytes) are
+// stored saturated.
+// Example:
+//  erom::Entry<long, erom::VarintCodec<long, 2> > timeout;  // Takes 2 bytes
+template<typename T, size_t Bytes = (sizeof(T) * 8 + 6) / 7> struct VarintCodec {
+  typedef typename CodecWord<sizeof(T)>::type word;
+  enum {
+    raw       = 0,
+    size      = Bytes,
+    is_signed = (T)-1 < (T)0,
+    clamped   = Bytes * 7 < sizeof(word) * 8
+  };
+
+private:
+  typedef char _bytes_check[(Bytes > 0 && Bytes <= (sizeof(T) * 8 + 6) / 7) ? 1 : -1];
+
+  // Largest zigzag code 'Bytes' bytes hold
+  static inline word _limit() { return clamped ? ((word)1 << (clamped ? Bytes * 7 : 0)) - 1 : ~(word)0; }
+
+public:
+  static size_t encode(const T &aValue, uint8_t *aData) {
+    word __code = !is_signed || aValue >= 0 ? (word)aValue << (is_signed ? 1 : 0) : (~(word)aValue << 1) | 1;
+    if (clamped && __code > _limit()) __code = is_signed && !(__code & 1) ? _limit() - 1 : _limit();
+    size_t __n = 0;
+    for (; __code >= 0x80 && __n + 1 < Bytes; __code >>= 7) aData[__n++] = (uint8_t)__code | 0x80;
+    aData[__n++] = (uint8_t)__code;
+    return __n;
+  }
+
+  static void decode(T &aValue, const uint8_t *aData) {
+    word __code = 0;
+    for (size_t __i = 0; __i < Bytes; __i++) {
+      __code |= (word)(aData[__i] & 0x7F) << (__i * 7);
+      if (!(aData[__i] & 0x80)) break;
+    }
+    aValue = !is_signed || !(__code & 1) ? (T)(__code >> (is_signed ? 1 : 0)) : (T)(-(T)(__code >> 1) - 1);
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Floating point value stored as the integer 'S' of 'value * Scale',
+// rounded to nearest and saturated to the range of 'S'.
+// Example:
+//  erom::Entry<float, erom::FixedPointCodec<float, 100> > gain; // 2 bytes, -327.68 .. 327.67
+template<typename T, long Scale, typename S = int16_t> struct FixedPointCodec {
+  typedef typename CodecWord<sizeof(S)>::type word;
+  enum { raw = 0, size = sizeof(S), is_signed = (S)-1 < (S)0 };
+
+private:
+  typedef char _scale_check[Scale > 0 ? 1 : -1];
+
+  static inline T _max() { return is_signed ? (T)(((word)1 << (sizeof(S) * 8 - 1)) - 1) : (T)(S)~(S)0; }
+  static inline T _min() { return is_signed ? -_max() - 1 : 0; }
+
+public:
+  static size_t encode(const T &aValue, uint8_t *aData) {
+    T __scaled = aValue * Scale;
+    S __stored = !(__scaled < _max()) ? (S)_max() : !(__scaled > _min()) ? (S)_min() : (S)(__scaled < 0 ? __scaled - (T)0.5 : __scaled + (T)0.5);
+    memcpy(aData, &__stored, sizeof(S));
+    return sizeof(S);
+  }
+
+  static inline void decode(T &aValue, const uint8_t *aData) {
+    S __stored;
+    memcpy(&__stored, aData, sizeof(S));
+    aValue = (T)__stored / Scale;
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Packs fields of given bit widths into bytes, lowest bit first. Used by
+// 'BitfieldCodec'
+class BitWriter {
+private:
+  uint8_t *_data;
+  size_t _size, _bit;
+
+public:
+  // Clears 'aSize' bytes at 'aData' to pack into
+  BitWriter(uint8_t *aData, size_t aSize);
+
+  // Appends the lowest 'aBits' (up to 32) bits of 'aValue'. Returns false if
+  // they do not fit
+  bool write(uint32_t aValue, uint8_t aBits);
+
+  // Bits written so far
+  inline size_t bits() const { return _bit; }
+};
+
+// Reads fields packed by 'BitWriter'
+class BitReader {
+private:
+  const uint8_t *_data;
+  size_t _size, _bit;
+
+public:
+  BitReader(const uint8_t *aData, size_t aSize) : _data(aData), _size(aSize), _bit(0) { /* Do Nothing */ }
+
+  // Next 'aBits' (up to 32) bits, zero-extended or sign-extended. Bits past
+  // the end read as 0
+  uint32_t read(uint8_t aBits);
+  int32_t read_signed(uint8_t aBits);
+
+  // Bits read so far
+  inline size_t bits() const { return _bit; }
+};
+
+// Struct packed into 'Bytes' bytes by its own members, which name the bit
+// width of every field:
+//   void pack(erom::BitWriter &aBits) const;
+//   void unpack(erom::BitReader &aBits);
+// Example:
+//  struct Flags {
+//    uint8_t mode; bool enabled; int8_t trim;
+//    void pack(erom::BitWriter &aBits) const { aBits.write(mode, 3); aBits.write(enabled, 1); aBits.write(trim, 6); }
+//    void unpack(erom::BitReader &aBits) { mode = aBits.read(3); enabled = aBits.read(1); trim = aBits.read_signed(6); }
+//  };
+//  erom::Entry<Flags, erom::BitfieldCodec<Flags, 2> > flags;  // Takes 2 bytes
+template<typename T, size_t Bytes> struct BitfieldCodec {
+  enum { raw = 0, size = Bytes };
+
+  static inline size_t encode(const T &aValue, uint8_t *aData) { BitWriter __bits(aData, Bytes); aValue.pack(__bits); return Bytes; }
+  static inline void decode(T &aValue, const uint8_t *aData) { BitReader __bits(aData, Bytes); aValue.unpack(__bits); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_CODEC_H_
@@ -0,0 +1,30 @@
+#ifndef _ROBODEM_EROM_CRC_H_
+#define _ROBODEM_EROM_CRC_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF). Computed
+// with a 16 entry nibble table, which is small enough for any AVR while
+// still being several times faster than bit by bit computation.
+static const uint16_t crc16_init = 0xFFFF;
+
+// Continues 'aCrc' over 'aSize' bytes of 'aData'
+// Example:
+//  uint16_t crc = erom::crc16(erom::crc16_init, "123456789", 9); // 0x29B1
+uint16_t crc16(uint16_t aCrc, const void *aData, size_t aSize);
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_CRC_H_
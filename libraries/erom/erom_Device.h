@@ -0,0 +1,237 @@
+#ifndef _ROBODEM_EROM_DEVICE_H_
+#define _ROBODEM_EROM_DEVICE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <inttypes.h>
+#include <stddef.h>
+
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#endif
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Chip's EEPROM size in bytes, known at compile time (see
+// 'Access::device_memory_size()'). 0 if unknown; define it through compiler
+// flags for chips missing below.
+#ifndef EROM_DEVICE_MEMORY_SIZE
+#if   !defined (__AVR__)
+#define EROM_DEVICE_MEMORY_SIZE 0         // Host image sized at run time, or no EEPROM
+#elif defined (__AVR_AT94K__)         \
+   || defined (__AVR_AT76C711__)      \
+   || defined (__AVR_AT43USB320__)    \
+   || defined (__AVR_AT43USB355__)
+#define EROM_DEVICE_MEMORY_SIZE 0         // No EEPROM Memory
+#elif defined (__AVR_ATtiny13__)      \
+   || defined (__AVR_ATtiny13A__)     \
+   || defined (__AVR_ATtiny43U__)     \
+   || defined (__AVR_ATtiny48__)      \
+   || defined (__AVR_ATtiny88__)
+#define EROM_DEVICE_MEMORY_SIZE 64        // 64 bytes
+#elif defined (__AVR_ATtiny22__)      \
+   || defined (__AVR_ATtiny26__)      \
+   || defined (__AVR_AT90S2343__)     \
+   || defined (__AVR_AT90S2333__)     \
+   || defined (__AVR_AT90S2323__)     \
+   || defined (__AVR_AT90S2313__)     \
+   || defined (__AVR_ATtiny2313__)    \
+   || defined (__AVR_ATtiny24__)      \
+   || defined (__AVR_ATtiny25__)      \
+   || defined (__AVR_ATtiny261__)
+#define EROM_DEVICE_MEMORY_SIZE 128       // 128 bytes
+#elif defined (__AVR_ATmega48__)      \
+   || defined (__AVR_ATmega48P__)     \
+   || defined (__AVR_ATmega8HVA__)    \
+   || defined (__AVR_AT90S4414__)     \
+   || defined (__AVR_AT90S4434__)     \
+   || defined (__AVR_AT90S4433__)     \
+   || defined (__AVR_ATtiny44__)      \
+   || defined (__AVR_ATtiny45__)      \
+   || defined (__AVR_ATtiny461__)
+#define EROM_DEVICE_MEMORY_SIZE 256       // 256 bytes
+#elif defined (__AVR_ATmega164P__)    \
+   || defined (__AVR_ATmega16__)      \
+   || defined (__AVR_ATmega161__)     \
+   || defined (__AVR_ATmega162__)     \
+   || defined (__AVR_ATmega163__)     \
+   || defined (__AVR_ATmega165__)     \
+   || defined (__AVR_ATmega165P__)    \
+   || defined (__AVR_ATmega168__)     \
+   || defined (__AVR_ATmega168P__)    \
+   || defined (__AVR_ATmega169__)     \
+   || defined (__AVR_ATmega169P__)    \
+   || defined (__AVR_ATmega16HVA__)   \
+   || defined (__AVR_ATmega406__)     \
+   || defined (__AVR_ATmega8__)       \
+   || defined (__AVR_ATmega8U2__)     \
+   || defined (__AVR_ATmega88__)      \
+   || defined (__AVR_ATmega88P__)     \
+   || defined (__AVR_ATmega8515__)    \
+   || defined (__AVR_ATmega8535__)    \
+                                      \
+   || defined (__AVR_ATtiny167__)     \
+   || defined (__AVR_ATtiny84__)      \
+   || defined (__AVR_ATtiny85__)      \
+   || defined (__AVR_ATtiny861__)     \
+                                      \
+   || defined (__AVR_AT90S8515__)     \
+   || defined (__AVR_AT90C8534__)     \
+   || defined (__AVR_AT90S8535__)     \
+   || defined (__AVR_AT90PWM1__)      \
+   || defined (__AVR_AT90PWM2__)      \
+   || defined (__AVR_AT90PWM2B__)     \
+   || defined (__AVR_AT90PWM2B__)     \
+   || defined (__AVR_AT90PWM3__)      \
+   || defined (__AVR_AT90PWM3B__)     \
+   || defined (__AVR_AT90PWM216__)    \
+   || defined (__AVR_AT90PWM316__)    \
+   || defined (__AVR_AT90USB82__)     \
+   || defined (__AVR_AT90USB162__)
+#define EROM_DEVICE_MEMORY_SIZE 512       // 512 bytes
+#elif defined (__AVR_ATmega32C1__)    \
+   || defined (__AVR_ATmega32M1__)    \
+   || defined (__AVR_ATmega32U4__)    \
+   || defined (__AVR_ATmega32U6__)    \
+   || defined (__AVR_AT90CAN32__)     \
+   || defined (__AVR_ATmega32__)      \
+   || defined (__AVR_ATmega323__)     \
+   || defined (__AVR_ATmega325__)     \
+   || defined (__AVR_ATmega325P__)    \
+   || defined (__AVR_ATmega3250__)    \
+   || defined (__AVR_ATmega3250P__)   \
+   || defined (__AVR_ATmega329__)     \
+   || defined (__AVR_ATmega329P__)    \
+   || defined (__AVR_ATmega3290__)    \
+   || defined (__AVR_ATmega3290P__)   \
+   || defined (__AVR_ATmega324P__)    \
+   || defined (__AVR_ATmega328P__)    \
+   || defined (__AVR_ATmega32HVB__)
+#define EROM_DEVICE_MEMORY_SIZE 1024      // 1 KB
+#elif defined (__AVR_AT90CAN64__)     \
+   || defined (__AVR_AT90USB646__)    \
+   || defined (__AVR_AT90USB647__)    \
+   || defined (__AVR_ATmega64__)      \
+   || defined (__AVR_ATmega644__)     \
+   || defined (__AVR_ATmega644P__)    \
+   || defined (__AVR_ATmega645__)     \
+   || defined (__AVR_ATmega6450__)    \
+   || defined (__AVR_ATmega649__)     \
+   || defined (__AVR_ATmega6490__)
+#define EROM_DEVICE_MEMORY_SIZE 2048      // 2 KB
+#elif defined (__AVR_ATmega128__)     \
+   || defined (__AVR_ATmega1280__)    \
+   || defined (__AVR_ATmega1281__)    \
+   || defined (__AVR_ATmega1284P__)   \
+   || defined (__AVR_ATmega128RFA1__) \
+   || defined (__AVR_ATmega2560__)    \
+   || defined (__AVR_ATmega2561__)    \
+   || defined (__AVR_AT90CAN128__)    \
+   || defined (__AVR_AT90USB1286__)   \
+   || defined (__AVR_AT90USB1287__)   \
+   || defined (__AVR_ATmega640__)     \
+   || defined (__AVR_ATmega103__)
+#define EROM_DEVICE_MEMORY_SIZE 4096      // 4 KB
+#elif defined (__AVR_AT86RF401__)
+#define EROM_DEVICE_MEMORY_SIZE 131072    // 128 KB
+#else
+#define EROM_DEVICE_MEMORY_SIZE 0         // Memory unknown, specify manually
+#endif
+#endif // EROM_DEVICE_MEMORY_SIZE
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// EEPROM cell programming modes (AVR EEPM bits). Erase sets all bits of a
+// cell to 1, write can only clear bits; each phase takes about half of the
+// atomic erase+write time.
+enum ProgramMode {
+  EraseWrite = 0, // Atomic erase and write (~3.4 ms)
+  EraseOnly  = 1, // Erase only, cell becomes 0xFF (~1.8 ms)
+  WriteOnly  = 2  // Write only, cell becomes 'old & new' (~1.8 ms)
+};
+
+// Cheapest mode turning a cell holding 'aOld' into 'aNew'
+inline ProgramMode program_mode(uint8_t aOld, uint8_t aNew) {
+  return aNew == 0xFF ? EraseOnly : (aOld & aNew) == aNew ? WriteOnly : EraseWrite;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Storage device driver interface. 'Access' works with the chip's own EEPROM
+// ('NativeDevice') by default; give it a 'Device' to work with anything else
+// (external chips, emulated or simulated memories).
+// Addresses are physical, i.e. already adjusted by 'Access::base()', and
+// transfers are already range checked.
+class Device {
+public:
+  virtual ~Device() { /* Do Nothing */ }
+
+  // Device memory size in bytes
+  virtual size_t size() const = 0;
+
+  // Transfer 'aSize' bytes from/to the device
+  virtual void read (size_t aAddress, void *aData, size_t aSize) = 0;
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) = 0;
+
+  // Program a single byte using the given mode (see 'program_mode()').
+  // Devices without split programming simply write the byte.
+  virtual void program(size_t aAddress, uint8_t aValue, ProgramMode /* aMode */) { write(aAddress, &aValue, sizeof(aValue)); }
+
+  // Returns true if device is not busy programming
+  virtual bool is_ready() const { return true; }
+
+  // Estimated microseconds of a write cycle programming with 'aMode' (a
+  // whole page on paged devices), see 'Access::update_time()'. Defaults to
+  // AVR EEPROM cycle times
+  virtual unsigned long cycle_time(ProgramMode aMode) const { return aMode == EraseWrite ? 3400 : 1800; }
+
+  // Bytes programmed in a single write cycle. 'Access' update methods write
+  // the changed bytes of such a page with one 'write()' call
+  virtual size_t page_size() const { return 1; }
+
+  // Writes out data the device holds back, see 'Access::flush()'
+  virtual void flush() { /* Do Nothing */ }
+
+  // Does a slice of background work (e.g. 'FlashDevice' garbage collection),
+  // see 'Access::tick()'
+  virtual void tick() { /* Do Nothing */ }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// The chip's own EEPROM, dispatched at compile time so it costs nothing over
+// calling avr-libc directly. On host builds it is backed by the memory-mapped
+// image of 'ImageDevice::native()'. Other chips have no EEPROM: reads return
+// erased bytes and writes are dropped, use a 'Device' (e.g. 'FlashDevice').
+struct NativeDevice {
+#if defined(__AVR__)
+  static inline void read(size_t aAddress, void *aData, size_t aSize) {
+    eeprom_read_block(aData, reinterpret_cast<const void*>(aAddress), aSize);
+  }
+  static inline void write(size_t aAddress, const void *aData, size_t aSize) {
+    eeprom_write_block(aData, reinterpret_cast<void*>(aAddress), aSize);
+  }
+  static inline bool is_ready() { return eeprom_is_ready(); }
+#if defined(EEPM0) && defined(EEPM1)
+  static inline unsigned long cycle_time(ProgramMode aMode) { return aMode == EraseWrite ? 3400 : 1800; }
+#else
+  static inline unsigned long cycle_time(ProgramMode /* aMode */) { return 3400; }
+#endif
+#else
+  static void read(size_t aAddress, void *aData, size_t aSize);
+  static void write(size_t aAddress, const void *aData, size_t aSize);
+  static bool is_ready();
+  static unsigned long cycle_time(ProgramMode aMode);
+#endif
+  // Program a single byte using the given mode. Falls back to atomic
+  // erase+write on chips without EEPM bits.
+  static void program(size_t aAddress, uint8_t aValue, ProgramMode aMode);
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_DEVICE_H_
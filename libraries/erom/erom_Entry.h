@@ -4,48 +4,201 @@
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 #include "erom_Access.h"
+#include "erom_Codec.h"
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 namespace erom {
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
-// A template class that provides easy transition from EEPROM storage to RAM
-// and vice-versa.
-template<typename T> class Entry {
+// Base of all entries: EEPROM location, dirty flag and 'Storage' registry
+// link. Lets 'Storage' save and load the entries it issued without knowing
+// their types. Takes 9 bytes of RAM on AVR (vtable pointer, link, access,
+// address and a byte of flags), besides the value.
+class EntryBase {
 friend class Storage;
 
 public:
-  typedef T type;
-  enum { size = sizeof(type) };
+  enum { max_priority = 31 };
 
 private:
+  EntryBase *_next;   // Next entry issued by the same storage
+
+protected:
   Access *_access;
   size_t _address;
+  uint8_t _dirty    : 1;  // RAM value changed since last save/load
+  uint8_t _pending  : 1;  // Left for the running 'Storage' pass
+  uint8_t _critical : 1;  // Saved right away by 'SaveScheduler'
+  uint8_t _priority : 5;  // Order of 'Storage::flush()'
 
-protected:
+  inline Access *get_access() const { return _access; }
   inline void set_access(Access *aAccess) { _access = aAccess; }
   inline void set_address(size_t aAddress) { _address = aAddress; }
 
+  EntryBase() : _next(NULL), _access(NULL), _address(0), _dirty(false), _pending(false), _critical(false), _priority(0) { /* Do Nothing */ }
+  EntryBase(Access *aAccess, size_t aAddress, bool aDirty) : _next(NULL), _access(aAccess), _address(aAddress), _dirty(aDirty), _pending(false), _critical(false), _priority(0) { /* Do Nothing */ }
+  EntryBase(const EntryBase &O) : _next(NULL), _access(O._access), _address(O._address), _dirty(O._dirty), _pending(false), _critical(O._critical), _priority(O._priority) { /* Do Nothing */ }
+  // Assigning an entry changes its value only: the link, access and address
+  // stay those of the entry assigned to
+  EntryBase &operator=(const EntryBase & /* O */) { return *this; }
+
+public:
+  virtual ~EntryBase() { /* Do Nothing */ }
+
+  // Write RAM value into EEPROM
+  // aFullWrite - if true, all data will be written, otherwise changes only
+  virtual void save(bool aFullWrite = false) = 0;
+  // Load value from EEPROM to RAM
+  virtual void load() = 0;
+  // Continue CRC-16 'aCrc' (see 'erom::crc16()') over the RAM value
+  virtual uint16_t crc16(uint16_t aCrc) const = 0;
+  // Continue CRC-16 'aCrc' over the value stored in EEPROM
+  virtual uint16_t stored_crc16(uint16_t aCrc) const = 0;
+  // Estimated microseconds 'save()' takes to store the RAM value, 0 if
+  // EEPROM already holds it (see 'Access::update_time()')
+  virtual unsigned long save_time() const = 0;
+  // Save RAM value against 'aShadow', a RAM copy of the 'aSize' bytes EEPROM
+  // holds from the entry's address on (see 'ShadowStorage'): bytes which
+  // differ from it are written, then copied into it. Nothing is read from
+  // EEPROM. Returns false, doing nothing, if the entry cannot be saved so
+  // (by default, or if it does not fit 'aSize'); use 'save()' then. Returns
+  // false as well if the write queue rejected the changed bytes
+  virtual bool save_shadowed(uint8_t * /* aShadow */, size_t /* aSize */) { return false; }
+  // Load RAM value from 'aShadow' instead of EEPROM. Returns false, doing
+  // nothing, if the entry cannot be loaded so; use 'load()' then
+  virtual bool load_shadowed(const uint8_t * /* aShadow */, size_t /* aSize */) { return false; }
+
+  // Returns true if RAM value was changed through entry's operators since the
+  // last save or load
+  inline bool dirty() const { return _dirty != 0; }
+  // Mark RAM value changed. Call after modifying 'value' directly, so
+  // 'Storage::save()' does not skip the entry.
+  inline void touch() { _dirty = true; }
+  // Returns true if the running 'Storage::tick(aBudget)' pass did not load or
+  // save the entry yet. An entry is loaded or saved whole within one step,
+  // so its value is either the old or the new one, never a mix
+  inline bool pending() const { return _pending != 0; }
+
+  // Critical entries are saved as soon as they change when their storage is
+  // driven by a 'SaveScheduler', regardless of its write budget
+  inline bool critical() const { return _critical != 0; }
+  inline void critical(bool aCritical) { _critical = aCritical; }
+
+  // 'Storage::flush()' saves dirty entries of higher priority first (0 by
+  // default, 'max_priority' at most)
+  inline uint8_t priority() const { return _priority; }
+  inline void priority(uint8_t aPriority) { _priority = aPriority < max_priority ? aPriority : (uint8_t)max_priority; }
+
+  // Address of value in EEPROM storage
+  inline size_t address() const { return _address; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// A template class that provides easy transition from EEPROM storage to RAM
+// and vice-versa. Assignment and arithmetic operators mark the entry dirty.
+// 'C' is the codec storing the value (see 'erom_Codec.h'), raw bytes of the
+// value by default; 'size' is the most bytes it takes in EEPROM.
+// RAM: the value plus the 9 bytes of 'EntryBase' on AVR, where an entry
+// used to take 4 (access and address). Fields at fixed addresses which need
+// no dirty tracking or 'Storage' registry take the value only as
+// 'StaticEntry' (see 'erom_Layout.h').
+// Example:
+//  erom::Entry<long, erom::VarintCodec<long, 2> > timeout(0); // 2 bytes instead of 4
+template<typename T, class C = Codec<T> > class Entry : public EntryBase {
+friend class Storage;
+
+public:
+  typedef T type;
+  typedef C codec;
+  enum { size = C::size };
+
+private:
+  // Raw values are stored as they are. Saves return false if some changed
+  // byte was not taken (see 'Access::queue_policy()')
+  inline bool _save(bool aFullWrite, CodecTag<1>) const {
+    if (aFullWrite) return _access->write_block(address(), value);
+    return _access->update_bytes(address(), &value, sizeof(value));
+  }
+  inline void _load(CodecTag<1>) { _access->read_block(address(), value); }
+  inline uint16_t _crc16(uint16_t aCrc, CodecTag<1>) const { return erom::crc16(aCrc, &value, sizeof(value)); }
+  inline uint16_t _stored_crc16(uint16_t aCrc, CodecTag<1>) const { return _access->crc16(address(), sizeof(value), aCrc); }
+  inline unsigned long _save_time(CodecTag<1>) const { return _access->update_time(address(), value); }
+  inline bool _save_shadowed(uint8_t *aShadow, size_t aSize, CodecTag<1>) { return _save_shadowed(aShadow, aSize, &value, sizeof(value)); }
+  inline bool _load_shadowed(const uint8_t *aShadow, size_t aSize, CodecTag<1>) {
+    if (sizeof(value) > aSize) return false;
+    memcpy(&value, aShadow, sizeof(value));
+    return true;
+  }
+
+  // Encoded values: only the bytes 'C::encode()' used are written, CRCs are
+  // taken over them
+  inline bool _save(bool aFullWrite, CodecTag<0>) const {
+    uint8_t __data[size];
+    size_t __size = C::encode(value, __data);
+    if (aFullWrite) return _access->write_block(address(), __data, __size) == __size;
+    return _access->update_bytes(address(), __data, __size);
+  }
+  inline void _load(CodecTag<0>) {
+    uint8_t __data[size];
+    if (_access->read_block(address(), __data, size)) C::decode(value, __data);
+  }
+  inline uint16_t _crc16(uint16_t aCrc, CodecTag<0>) const {
+    uint8_t __data[size];
+    return erom::crc16(aCrc, __data, C::encode(value, __data));
+  }
+  inline uint16_t _stored_crc16(uint16_t aCrc, CodecTag<0>) const {
+    uint8_t __data[size];
+    if (!_access->read_block(address(), __data, size)) return aCrc;
+    type __value;
+    C::decode(__value, __data);
+    return erom::crc16(aCrc, __data, C::encode(__value, __data));
+  }
+  inline unsigned long _save_time(CodecTag<0>) const {
+    uint8_t __data[size];
+    return _access->update_time(address(), __data, C::encode(value, __data));
+  }
+  inline bool _save_shadowed(uint8_t *aShadow, size_t aSize, CodecTag<0>) {
+    uint8_t __data[size];
+    return _save_shadowed(aShadow, aSize, __data, C::encode(value, __data));
+  }
+  inline bool _load_shadowed(const uint8_t *aShadow, size_t aSize, CodecTag<0>) {
+    if (size > aSize) return false;
+    C::decode(value, aShadow);
+    return true;
+  }
+
+  // Writes the 'aBytes' bytes of 'aData' which differ from 'aShadow'
+  inline bool _save_shadowed(uint8_t *aShadow, size_t aSize, const void *aData, size_t aBytes) {
+    if (aBytes > aSize || !_access->in_range(address() + aBytes)) return false;
+    if (memcmp(aShadow, aData, aBytes)) {
+      if (!_access->update_bytes(address(), aData, aBytes, aShadow)) return false;
+      memcpy(aShadow, aData, aBytes);
+    }
+    return true;
+  }
+
 public:
   type value;   // Data stored in RAM
 
   // Create a null referenced entry. It wont' be able to interact with EEPROM.
   // Used in 'Storage'.
-  Entry() { _access = NULL; }
+  Entry() { /* Do Nothing */ }
   // Create a referenced entry with default access (Access::instance()) with
   // manually defined address. Initializes RAM value with with the one in EEPROM.
-  Entry(size_t aAddress) : _access(&Access::instance()), _address(aAddress) { load(); }
+  Entry(size_t aAddress) : EntryBase(&Access::instance(), aAddress, false) { load(); }
   // Create a referenced entry with default access (Access::instance()) with
   // manually defined address. Initialized RAM value with aValue.
-  Entry(size_t aAddress, const type &aValue) : _access(&Access::instance()), _address(aAddress), value(aValue) { /* Do Nothing */ }
+  Entry(size_t aAddress, const type &aValue) : EntryBase(&Access::instance(), aAddress, true), value(aValue) { /* Do Nothing */ }
   // Create a referenced entry with given access and manually defined address.
   // Initializes RAM value with with the one in EEPROM.
-  Entry(Access &aAccess, size_t aAddress) : _access(&aAccess), _address(aAddress) { load(); }
+  Entry(Access &aAccess, size_t aAddress) : EntryBase(&aAccess, aAddress, false) { load(); }
   // Create a referenced entry with given access and manually defined address
   // and initializes RAM value with with aValue.
-  Entry(Access &aAccess, size_t aAddress, const type &aValue) : _access(&aAccess), _address(aAddress), value(aValue) { /* Do Nothing */ }
-  Entry(const Entry &O) : _access(O._access), _address(O._address), value(O.value) { /* Do Nothing */ }
+  Entry(Access &aAccess, size_t aAddress, const type &aValue) : EntryBase(&aAccess, aAddress, true), value(aValue) { /* Do Nothing */ }
+  Entry(const Entry &O) : EntryBase(O), value(O.value) { /* Do Nothing */ }
+  // Takes the value of 'aEntry', keeps its own address
+  Entry& operator=(const Entry &aEntry) { value = aEntry.value; touch(); return *this; }
 
   // All kinds of operator functionality
   // Example1:
@@ -67,15 +220,15 @@ public:
   inline operator const type&() const { return value; }
   inline operator type&() { return value; }
 
-  inline Entry& operator=(const type &aValue) { value = aValue; return *this; }
-  inline type& operator+=(const type &aValue) { return value += aValue; }
-  inline type& operator-=(const type &aValue) { return value -= aValue; }	 	  
+  inline Entry& operator=(const type &aValue) { value = aValue; touch(); return *this; }
+  inline type& operator+=(const type &aValue) { touch(); return value += aValue; }
+  inline type& operator-=(const type &aValue) { touch(); return value -= aValue; }
 
-  inline type& operator++() { ++value; return value; }
-  inline type  operator++(int) { type __v(value); ++value; return __v; }
+  inline type& operator++() { ++value; touch(); return value; }
+  inline type  operator++(int) { type __v(value); ++value; touch(); return __v; }
 
-  inline type& operator--() { --value; return *this; }
-  inline type  operator--(int) { type __v(value); --value; return __v; }
+  inline type& operator--() { --value; touch(); return value; }
+  inline type  operator--(int) { type __v(value); --value; touch(); return __v; }
 
   inline bool operator <(const type &aValue) const { return value  < aValue; }
   inline bool operator >(const type &aValue) const { return value  > aValue; }
@@ -84,10 +237,10 @@ public:
   inline bool operator==(const type &aValue) const { return value == aValue; }
   inline bool operator!=(const type &aValue) const { return value != aValue; }
 
-  template<typename OT> inline type& operator+=(const OT &aValue) { return value += aValue; }
-  template<typename OT> inline type& operator-=(const OT &aValue) { return value -= aValue; }
-  template<typename OT> inline type& operator/=(const OT &aValue) { return value /= aValue; }
-  template<typename OT> inline type& operator*=(const OT &aValue) { return value *= aValue; }
+  template<typename OT> inline type& operator+=(const OT &aValue) { touch(); return value += aValue; }
+  template<typename OT> inline type& operator-=(const OT &aValue) { touch(); return value -= aValue; }
+  template<typename OT> inline type& operator/=(const OT &aValue) { touch(); return value /= aValue; }
+  template<typename OT> inline type& operator*=(const OT &aValue) { touch(); return value *= aValue; }
 
   template<typename OT> inline bool  operator <(const OT &aValue) const { return value  < aValue; }
   template<typename OT> inline bool  operator >(const OT &aValue) const { return value  > aValue; }
@@ -96,22 +249,39 @@ public:
   template<typename OT> inline bool  operator==(const OT &aValue) const { return value == aValue; }
   template<typename OT> inline bool  operator!=(const OT &aValue) const { return value != aValue; }
 
-  inline Entry& assign(const type &aValue) { value = aValue; return *this; }
+  inline Entry& assign(const type &aValue) { value = aValue; touch(); return *this; }
 
   // Write RAM value into EEPROM
   // aFullWrite - if true, all data will be written, otherwise changes only
-  inline void save(bool aFullWrite = false) const {
-    if (_access) {
-      if (aFullWrite) _access->write_block(address(), value);
-      else _access->update_block(address(), value);
-    }
+  // Stays dirty if the write queue rejected it (see 'Access::queue_policy()')
+  virtual void save(bool aFullWrite = false) {
+    if (_access && _save(aFullWrite, CodecTag<C::raw>())) _dirty = false;
   }
+  // Same for a const entry, such as a copy returned by 'Storage::issue<T>()'
+  // that no storage saves: the dirty flag is left as it is
+  inline void save(bool aFullWrite = false) const { if (_access) _save(aFullWrite, CodecTag<C::raw>()); }
 
   // Load value from EEPROM to RAM
-  inline void load() { if (_access) _access->read_block(address(), value); }
+  virtual void load() { if (_access) _load(CodecTag<C::raw>()), _dirty = false; }
 
-  // Address of value in EEPROM storage
-  inline size_t address() const { return _address; }
+  // Continue CRC-16 'aCrc' over RAM value
+  virtual uint16_t crc16(uint16_t aCrc) const { return _crc16(aCrc, CodecTag<C::raw>()); }
+  virtual uint16_t stored_crc16(uint16_t aCrc) const { return _access ? _stored_crc16(aCrc, CodecTag<C::raw>()) : aCrc; }
+
+  // Estimated microseconds 'save()' takes to store the RAM value
+  virtual unsigned long save_time() const { return _access ? _save_time(CodecTag<C::raw>()) : 0; }
+
+  // Save or load RAM value against a RAM copy of EEPROM, see 'EntryBase'
+  virtual bool save_shadowed(uint8_t *aShadow, size_t aSize) {
+    if (!_access || !_save_shadowed(aShadow, aSize, CodecTag<C::raw>())) return false;
+    _dirty = false;
+    return true;
+  }
+  virtual bool load_shadowed(const uint8_t *aShadow, size_t aSize) {
+    if (!_access || !_load_shadowed(aShadow, aSize, CodecTag<C::raw>())) return false;
+    _dirty = false;
+    return true;
+  }
 };
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
@@ -0,0 +1,184 @@
+#ifndef _ROBODEM_EROM_ENTRY_ARRAY_H_
+#define _ROBODEM_EROM_ENTRY_ARRAY_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <string.h>
+#include "erom_Access.h"
+#include "erom_Entry.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// An array of 'N' elements stored one after another, read from EEPROM
+// element by element on first access and tracked changed element by element.
+// 'save()' writes changed elements only, a run of consecutive changed
+// elements as one block; 'load()' only drops what RAM holds, elements are
+// read again when accessed. Unlike 'Entry<T[N]>', a save neither reads nor
+// compares the elements which did not change.
+//
+// With 'Window' below 'N', only 'Window' elements are kept in RAM, for tables
+// larger than SRAM: element 'i' goes to slot 'i % Window', and accessing an
+// element saves the changed element holding its slot first. Takes about
+// 'Window * (sizeof(T) + 1) + Window / 4' bytes of RAM ('Window * sizeof(T)
+// + N / 4' without a window) besides 'EntryBase'.
+// Elements are accessed by index below 'N', which is not checked.
+// Example:
+//  class Settings : public erom::Storage {
+//  public:
+//    erom::EntryArray<int16_t, 256, 16> curve;  // 512 bytes, 16 in RAM
+//    Settings() { issue(curve); }
+//  } settings;
+//
+//  int16_t y = settings.curve[40];             // Reads element 40
+//  settings.curve.set(41, y + 5);              // Not read, 41 is overwritten
+//  settings.curve.edit(42) += 5;               // Reads 42, marks it changed
+//  settings.save();                            // Writes 41 .. 42 as one block
+template<typename T, size_t N, size_t Window = N> class EntryArray : public EntryBase {
+friend class Storage;
+
+public:
+  typedef T type;
+  enum { count = N, window = Window, size = N * sizeof(T) };
+
+private:
+  // The window must fit the array, the elements sharing a slot a byte
+  typedef char _size_check[N > 0 && Window > 0 && Window <= N && (N - 1) / Window < 256 ? 1 : -1];
+
+  enum { _windowed = Window < N, _bitmap = (Window + 7) / 8 };
+
+  type _slots[Window];
+  uint8_t _tags[_windowed ? Window : 1];  // Slot 's' holds element 'tag * Window + s'
+  uint8_t _resident[_bitmap];             // Slot holds its element
+  uint8_t _changed[_bitmap];              // Slot changed since last save or load
+
+  static inline bool _bit(const uint8_t *aBits, size_t aSlot) { return aBits[aSlot / 8] & (1 << aSlot % 8); }
+  static inline void _set(uint8_t *aBits, size_t aSlot) { aBits[aSlot / 8] |= 1 << aSlot % 8; }
+  static inline void _reset(uint8_t *aBits, size_t aSlot) { aBits[aSlot / 8] &= ~(1 << aSlot % 8); }
+
+  inline size_t _slot(size_t aIndex) const { return _windowed ? aIndex % Window : aIndex; }
+  inline size_t _index(size_t aSlot) const { return _windowed ? (size_t)_tags[aSlot] * Window + aSlot : aSlot; }
+  inline bool _holds(size_t aSlot, size_t aIndex) const { return _bit(_resident, aSlot) && (!_windowed || _tags[aSlot] == aIndex / Window); }
+  inline size_t _element_address(size_t aIndex) const { return address() + aIndex * sizeof(type); }
+
+  // Slot of element 'aIndex'. The changed element holding it is saved first,
+  // then 'aIndex' is read unless 'aFetch' is false (it is to be overwritten)
+  type &_fetch(size_t aIndex, bool aFetch) {
+    size_t __slot = _slot(aIndex);
+    if (_holds(__slot, aIndex)) return _slots[__slot];
+
+    if (_bit(_changed, __slot)) {
+      if (_access) _access->update_block(_element_address(_index(__slot)), _slots[__slot]);
+      _reset(_changed, __slot);
+    }
+    if (aFetch && _access) _access->read_block(_element_address(aIndex), _slots[__slot]);
+    if (_windowed) _tags[__slot] = aIndex / Window;
+    _set(_resident, __slot);
+    return _slots[__slot];
+  }
+
+  // End of the run of slots from 'aSlot' on which are set in 'aBits' and
+  // hold consecutive elements
+  size_t _run_end(const uint8_t *aBits, size_t aSlot) const {
+    size_t __end = aSlot + 1;
+    while (__end < Window && _bit(aBits, __end) && _index(__end) == _index(__end - 1) + 1) __end++;
+    return __end;
+  }
+
+protected:
+  // Elements held in RAM belong to the old address: dropped, nothing read
+  inline void set_address(size_t aAddress) {
+    EntryBase::set_address(aAddress);
+    memset(_resident, 0, sizeof(_resident));
+    memset(_changed, 0, sizeof(_changed));
+  }
+
+public:
+  // Create a null referenced array. It wont' be able to interact with EEPROM.
+  // Used in 'Storage'.
+  EntryArray() : EntryBase() { load(); }
+  // Create a referenced array with default access (Access::instance()) with
+  // manually defined address. Nothing is read until elements are accessed.
+  EntryArray(size_t aAddress) : EntryBase(&Access::instance(), aAddress, false) { load(); }
+  // Create a referenced array with given access and manually defined address.
+  EntryArray(Access &aAccess, size_t aAddress) : EntryBase(&aAccess, aAddress, false) { load(); }
+
+  // Element 'aIndex', read from EEPROM on first access
+  inline const type &get(size_t aIndex) { return _fetch(aIndex, true); }
+  inline const type &operator[](size_t aIndex) { return _fetch(aIndex, true); }
+  // Set element 'aIndex' to 'aValue' in RAM, without reading it first
+  inline void set(size_t aIndex, const type &aValue) { _fetch(aIndex, false) = aValue; _set(_changed, _slot(aIndex)); touch(); }
+  // Element 'aIndex' to modify in place: read on first access and marked
+  // changed
+  inline type &edit(size_t aIndex) { type &__value = _fetch(aIndex, true); _set(_changed, _slot(aIndex)); touch(); return __value; }
+
+  // Returns true if RAM holds element 'aIndex'
+  inline bool resident(size_t aIndex) const { return _holds(_slot(aIndex), aIndex); }
+  // Returns true if element 'aIndex' changed since the last save or load
+  inline bool changed(size_t aIndex) const { return resident(aIndex) && _bit(_changed, _slot(aIndex)); }
+
+  // Write changed elements into EEPROM, consecutive ones as one block
+  // aFullWrite - if true, all elements held in RAM are written whole,
+  //              otherwise changed bytes of changed elements only
+  // Runs the write queue rejected stay changed (see 'Access::queue_policy()')
+  virtual void save(bool aFullWrite = false) {
+    if (!_access) return;
+    const uint8_t *__bits = aFullWrite ? _resident : _changed;
+    bool __rejected = false;
+    for (size_t __slot = 0; __slot < Window; ) {
+      if (!_bit(__bits, __slot)) { __slot++; continue; }
+      size_t __end = _run_end(__bits, __slot);
+      size_t __address = _element_address(_index(__slot));
+      bool __taken;
+      if (aFullWrite) __taken = _access->write_block(__address, _slots + __slot, __end - __slot) != 0;
+      else __taken = _access->update_bytes(__address, _slots + __slot, (__end - __slot) * sizeof(type));
+      if (!__taken) __rejected = true;
+      else for (; __slot < __end; __slot++) _reset(_changed, __slot);
+      __slot = __end;
+    }
+    if (!__rejected) _dirty = false;
+  }
+
+  // Drop elements held in RAM, changed ones included: they are read from
+  // EEPROM again when accessed. Changes a window already saved stay
+  virtual void load() {
+    memset(_resident, 0, sizeof(_resident));
+    memset(_changed, 0, sizeof(_changed));
+    _dirty = false;
+  }
+
+  // Continue CRC-16 'aCrc' over RAM values, elements not held in RAM are
+  // taken from EEPROM
+  virtual uint16_t crc16(uint16_t aCrc) const {
+    for (size_t __index = 0; __index < N; __index++) {
+      size_t __slot = _slot(__index);
+      if (_holds(__slot, __index)) aCrc = erom::crc16(aCrc, &_slots[__slot], sizeof(type));
+      else if (_access) aCrc = _access->crc16(_element_address(__index), sizeof(type), aCrc);
+    }
+    return aCrc;
+  }
+  virtual uint16_t stored_crc16(uint16_t aCrc) const { return _access ? _access->crc16(address(), size, aCrc) : aCrc; }
+
+  // Estimated microseconds 'save()' takes to store changed elements
+  virtual unsigned long save_time() const {
+    if (!_access) return 0;
+    unsigned long __time = 0;
+    for (size_t __slot = 0; __slot < Window; ) {
+      if (!_bit(_changed, __slot)) { __slot++; continue; }
+      size_t __end = _run_end(_changed, __slot);
+      __time += _access->update_time(_element_address(_index(__slot)), _slots + __slot, __end - __slot);
+      __slot = __end;
+    }
+    return __time;
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_ENTRY_ARRAY_H_
@@ -0,0 +1,156 @@
+#ifndef _ROBODEM_EROM_FLASH_DEVICE_H_
+#define _ROBODEM_EROM_FLASH_DEVICE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Device.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Erasable flash driver interface, implemented per chip (internal flash
+// pages, SPI NOR, ...). Addresses are relative to the first byte of the first
+// sector given to the driver. Erase sets a whole sector to 0xFF, programming
+// can only clear bits (a byte becomes 'old & new').
+class Flash {
+public:
+  virtual ~Flash() { /* Do Nothing */ }
+
+  // Sector size in bytes and amount of sectors
+  virtual size_t sector_size() const = 0;
+  virtual size_t sectors() const = 0;
+  // Smallest programmable unit in bytes (1, 2, 4 or 8). Programs start at a
+  // multiple of it and cover whole units
+  virtual size_t program_size() const { return 1; }
+
+  // Reading and programming wait for an erase in progress to end.
+  // Programming blocks until done
+  virtual void read(size_t aAddress, void *aData, size_t aSize) = 0;
+  virtual void program(size_t aAddress, const void *aData, size_t aSize) = 0;
+  // Starts erasing sector 'aSector'. May return before the erase ends, see
+  // 'is_ready()'
+  virtual void erase(size_t aSector) = 0;
+
+  // Returns true if flash is not busy erasing or programming
+  virtual bool is_ready() const { return true; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// EEPROM emulated in flash, for chips without EEPROM. Give it to 'Access' to
+// use 'Entry', 'Storage', 'VerifiedStorage' etc. as usual.
+//
+// The emulated memory is kept in a RAM image, so reads never touch flash.
+// Writes are appended to a log in the active sector:
+//   [sequence][size][crc] [image: 'size()' bytes] [record][record]...
+// A record is [address][length][data: 1..'max_record' bytes][crc]; the
+// newest record of an address wins over older ones and the image. Unchanged
+// bytes are not logged. A record cut short by a power loss fails its CRC and
+// ends the log.
+//
+// When the log is full, the image is copied into the next sector, which is
+// committed by writing its header (with the next sequence) last; the old
+// sector is erased afterwards. 'tick()' (called by 'Access::tick()' and
+// 'Storage::tick()') does this collection in slices once three quarters of
+// the log are used, and erases the next sector in advance, so writes rarely
+// wait for more than programming their record. Writes made during a
+// collection go to both sectors. Sectors are used round-robin, spreading
+// their wear.
+//
+// Flash needs room for the header, the image and at least two records of
+// 'max_record' bytes per sector; emulated sizes of a quarter of a sector or
+// less keep collections rare.
+class FlashDeviceBase : public Device {
+public:
+  enum {
+    max_record      = 32,                 // Data bytes per record, and per collection slice
+    record_overhead = 3 + sizeof(uint16_t) // Address, length and CRC
+  };
+
+private:
+  Flash &_flash;
+  size_t _first, _sectors;   // Sectors used
+  uint8_t *_image;
+  size_t _size;
+  size_t _unit;              // Flash programming unit
+  size_t _active, _end;      // Active sector, offset of its log end
+  uint16_t _sequence;
+  bool _prepared;            // Next sector is known erased
+  bool _collecting;
+  size_t _copied, _target_end;
+  unsigned long _collections, _max_write_time;
+
+  inline size_t _align(size_t aSize) const { return (aSize + _unit - 1) / _unit * _unit; }
+  inline size_t _sector_address(size_t aSector) const { return (_first + aSector) * _flash.sector_size(); }
+  inline size_t _next() const { return (_active + 1) % _sectors; }
+  inline size_t _log_start() const { return _align(3 * sizeof(uint16_t)) + _align(_size); }
+
+  bool _read_header(size_t aSector, uint16_t &aSequence) const;
+  void _write_header(size_t aSector, uint16_t aSequence);
+  bool _blank(size_t aSector) const;
+  void _scan();
+  void _prepare();
+  void _collect_step();
+  void _collect();
+  void _append(size_t aAddress, const uint8_t *aData, uint8_t aSize);
+
+protected:
+  FlashDeviceBase(Flash &aFlash, size_t aFirstSector, size_t aSectors, uint8_t *aImage, size_t aSize);
+
+public:
+  // Finds the newest sector and rebuilds the RAM image from it. Formats the
+  // flash if there is none. Must be called before use; returns false if the
+  // flash was formatted (or does not fit the emulated size)
+  bool load();
+
+  virtual size_t size() const { return _size; }
+  virtual void read (size_t aAddress, void *aData, size_t aSize);
+  virtual void write(size_t aAddress, const void *aData, size_t aSize);
+  virtual bool is_ready() const { return _flash.is_ready(); }
+  virtual size_t page_size() const { return max_record; }
+  virtual void tick();
+
+  // Returns true while the image is being copied into the next sector
+  inline bool collecting() const { return _collecting; }
+  // Sequence of the active sector, incremented by every collection
+  inline uint16_t sequence() const { return _sequence; }
+  // Log bytes used and available in the active sector
+  inline size_t used() const { return _end - _log_start(); }
+  inline size_t capacity() const { return _flash.sector_size() - _log_start(); }
+
+  // Collections done and the longest 'write()' call in microseconds, since
+  // start or 'reset_stats()'
+  inline unsigned long collections() const { return _collections; }
+  inline unsigned long max_write_time() const { return _max_write_time; }
+  inline void reset_stats() { _collections = _max_write_time = 0; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'FlashDeviceBase' emulating 'Size' bytes of EEPROM (up to 64 KB) in
+// 'aSectors' sectors of 'aFlash' from 'aFirstSector' on. The image takes
+// 'Size' bytes of RAM.
+// Example:
+//  MyFlash flash;                                // Implements 'erom::Flash'
+//  erom::FlashDevice<512> eeprom(flash, 0, 2);   // 512 bytes in sectors 0 and 1
+//  erom::Access emulated(eeprom);
+//  eeprom.load();
+//  ...
+//  storage.tick();                               // Collects in the background
+template<size_t Size> class FlashDevice : public FlashDeviceBase {
+private:
+  typedef char _size_check[Size > 0 && Size <= 0xFFFF ? 1 : -1];
+
+  uint8_t _buffer[Size];
+
+public:
+  FlashDevice(Flash &aFlash, size_t aFirstSector, size_t aSectors) : FlashDeviceBase(aFlash, aFirstSector, aSectors, _buffer, Size) { /* Do Nothing */ }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_FLASH_DEVICE_H_
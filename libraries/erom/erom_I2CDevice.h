@@ -0,0 +1,186 @@
+#ifndef _ROBODEM_EROM_I2C_DEVICE_H_
+#define _ROBODEM_EROM_I2C_DEVICE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Device.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// External I2C serial EEPROM (24LC01 .. 24LC512 and alike) on bus 'Bus', an
+// Arduino 'TwoWire' compatible class. Give it to 'Access' to use the chip with
+// the usual read/write/update methods, 'Entry' and 'Storage' classes.
+//
+// Such parts program up to a whole page in a single ~5 ms write cycle, so
+// writes are sent in bursts split on page boundaries (a burst crossing one
+// would wrap around to the page start) and on the bus buffer size
+// 'BufferSize' (address bytes included). 'Access' update methods write all
+// changed bytes of a page in one burst (see 'Device::page_size()'). Reads are
+// sequential bursts of up to 'BufferSize' bytes. While programming, the part
+// does not acknowledge its address; the next transfer polls for that ACK
+// instead of waiting the worst case cycle time.
+//
+// With 'combine(true)' writes are collected in RAM while they fall into the
+// same burst (e.g. the entries of a 'Storage' saved one by one) and sent on
+// 'Access::flush()', or when a write does not fit the burst.
+//
+// Parts up to 2 KB (24LC16) take a single address byte and the address bits
+// 8..10 in the device address; set 'aAddressBytes' to 1 for them.
+// Example:
+//  #include <Wire.h>
+//  erom::I2CDevice<TwoWire> chip(Wire, 0x50, 32768, 64);  // 24LC256 at 0x50
+//  erom::Access external(chip);
+//  Wire.begin();
+//  external.write_long(0, 12345);
+template<class Bus, size_t BufferSize = 32> class I2CDevice : public Device {
+public:
+  // Longest time to poll for the end of a write cycle, in microseconds
+  static const unsigned long DefaultWriteTimeout = 10000;
+
+private:
+  Bus &_bus;
+  uint8_t _address, _address_bytes;
+  size_t _size, _page_size;
+  unsigned long _write_timeout;
+  mutable bool _busy;
+  bool _combine;
+  uint8_t _pending[BufferSize];   // Combined burst not sent yet
+  size_t _pending_address, _pending_size;
+  unsigned long _write_cycles, _errors;
+
+  inline uint8_t _device_address(size_t aAddress) const { return _address_bytes > 1 ? _address : _address | ((aAddress >> 8) & 0x07); }
+
+  inline void _begin(size_t aAddress) {
+    _bus.beginTransmission(_device_address(aAddress));
+    if (_address_bytes > 1) _bus.write(static_cast<uint8_t>(aAddress >> 8));
+    _bus.write(static_cast<uint8_t>(aAddress));
+  }
+
+  // Polls until the write cycle in progress ends. Returns false on timeout
+  bool _wait() {
+    if (!_busy) return true;
+    unsigned long __start = micros();
+    while (!is_ready()) {
+      if (micros() - __start >= _write_timeout) { _busy = false, _errors++; return false; }
+      delayMicroseconds(100);
+    }
+    return true;
+  }
+
+  void _receive(size_t aAddress, uint8_t *aData, size_t aSize) {
+    _wait();
+    while (aSize) {
+      size_t __chunk = aSize < BufferSize ? aSize : BufferSize;
+      size_t __received = 0;
+
+      // Set the address pointer, then read with a repeated start
+      _begin(aAddress);
+      if (_bus.endTransmission(false) == 0)
+        __received = _bus.requestFrom(_device_address(aAddress), static_cast<uint8_t>(__chunk));
+      if (__received != __chunk) _errors++;
+
+      for (size_t __i = 0; __i < __chunk; __i++) aData[__i] = __i < __received ? _bus.read() : 0xFF;
+      aAddress += __chunk, aData += __chunk, aSize -= __chunk;
+    }
+  }
+
+  void _send(size_t aAddress, const uint8_t *aData, size_t aSize) {
+    while (aSize) {
+      size_t __chunk = _page_size - aAddress % _page_size;
+      if (__chunk > BufferSize - _address_bytes) __chunk = BufferSize - _address_bytes;
+      if (__chunk > aSize) __chunk = aSize;
+
+      _wait();
+      _begin(aAddress);
+      _bus.write(aData, __chunk);
+      if (_bus.endTransmission() == 0) _busy = true, _write_cycles++;
+      else _errors++;
+
+      aAddress += __chunk, aData += __chunk, aSize -= __chunk;
+    }
+  }
+
+public:
+  // 'aAddress' - device address (0x50 .. 0x57), 'aSize' and 'aPageSize' in bytes
+  I2CDevice(Bus &aBus, uint8_t aAddress, size_t aSize, size_t aPageSize, uint8_t aAddressBytes = 2) :
+    _bus(aBus), _address(aAddress), _address_bytes(aAddressBytes), _size(aSize), _page_size(aPageSize),
+    _write_timeout(DefaultWriteTimeout), _busy(false), _combine(false), _pending_address(0), _pending_size(0),
+    _write_cycles(0), _errors(0) { /* Do Nothing */ }
+
+  virtual size_t size() const { return _size; }
+  virtual size_t page_size() const { return _page_size; }
+  // Worst case: the longest write cycle allowed ('write_timeout()')
+  virtual unsigned long cycle_time(ProgramMode /* aMode */) const { return _write_timeout; }
+
+  // Reads see combined bytes not sent yet
+  virtual void read(size_t aAddress, void *aData, size_t aSize) {
+    uint8_t *__p = static_cast<uint8_t*>(aData);
+    _receive(aAddress, __p, aSize);
+    for (size_t __i = 0; __i < _pending_size; __i++)
+      if (_pending_address + __i >= aAddress && _pending_address + __i < aAddress + aSize) __p[_pending_address + __i - aAddress] = _pending[__i];
+  }
+
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) {
+    const uint8_t *__p = static_cast<const uint8_t*>(aData);
+    if (!_combine) { _send(aAddress, __p, aSize); return; }
+
+    while (aSize) {
+      // Bytes join the burst if they fall into its page and reach
+      size_t __reach = BufferSize - _address_bytes;
+      if (_pending_size && (aAddress < _pending_address || aAddress >= _pending_address + __reach ||
+                            aAddress / _page_size != _pending_address / _page_size)) flush();
+      if (!_pending_size) _pending_address = aAddress;
+
+      size_t __offset = aAddress - _pending_address;
+      size_t __chunk = __reach - __offset;
+      if (__chunk > _page_size - aAddress % _page_size) __chunk = _page_size - aAddress % _page_size;
+      if (__chunk > aSize) __chunk = aSize;
+
+      // A gap in the burst keeps its current contents
+      if (__offset > _pending_size) _receive(_pending_address + _pending_size, _pending + _pending_size, __offset - _pending_size);
+      memcpy(_pending + __offset, __p, __chunk);
+      if (__offset + __chunk > _pending_size) _pending_size = __offset + __chunk;
+
+      aAddress += __chunk, __p += __chunk, aSize -= __chunk;
+    }
+  }
+
+  // Sends the combined burst
+  virtual void flush() {
+    size_t __size = _pending_size;
+    _pending_size = 0;
+    if (__size) _send(_pending_address, _pending, __size);
+  }
+
+  // Returns true if the part acknowledges its address, i.e. is not programming
+  virtual bool is_ready() const {
+    if (_busy) {
+      _bus.beginTransmission(_address);
+      _busy = _bus.endTransmission() != 0;
+    }
+    return !_busy;
+  }
+
+  // Whether writes are combined in RAM, see above. Disabling sends the burst
+  inline bool combine() const { return _combine; }
+  inline void combine(bool aCombine) { if (!aCombine) flush(); _combine = aCombine; }
+
+  inline unsigned long write_timeout() const { return _write_timeout; }
+  inline void write_timeout(unsigned long aTimeout) { _write_timeout = aTimeout; }
+
+  // Write cycles started and failed transfers (NACKs, short reads, write
+  // cycles not finished in time) since start
+  inline unsigned long write_cycles() const { return _write_cycles; }
+  inline unsigned long errors() const { return _errors; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_I2C_DEVICE_H_
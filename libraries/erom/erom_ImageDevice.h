@@ -0,0 +1,124 @@
+#ifndef _ROBODEM_EROM_IMAGE_DEVICE_H_
+#define _ROBODEM_EROM_IMAGE_DEVICE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Device.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#if defined(EROM_HOST)
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host (Linux) EEPROM model. Keeps the memory image in a file mapped into
+// RAM (or in anonymous memory if no file is given), so data survives between
+// runs just like on a chip. Models EEPROM programming time and counts
+// reads, writes and per-cell wear, which makes it possible to run and profile
+// 'Storage'/'VerifiedStorage' based code natively (see 'extras/host').
+//
+// Programming time is modelled, not waited for, unless 'realtime(true)' is
+// set: then every written byte keeps the device busy ('is_ready()' returns
+// false) for its programming time and the next write waits for it. Atomic
+// erase+write takes 'write_latency()', split erase-only and write-only
+// programming (see 'ProgramMode') takes 'phase_latency()' microseconds.
+//
+// 'power_off(N)' simulates a brown-out: the supply lasts for N more
+// microseconds of programming time. A cycle cut short leaves its cell erased
+// (0xFF), or unchanged if it was write-only; later ones are dropped and
+// counted by 'lost_writes()' until 'power_on()'.
+// Example:
+//  erom::ImageDevice image("eeprom.bin", 1024);
+//  erom::Access access(image);
+//  access.write_long(0, 12345);
+//  printf("%lu us, max wear %lu\n", image.programming_time(), image.max_wear());
+class ImageDevice : public Device {
+public:
+  // ATmega EEPROM erase+write and erase-only/write-only cycle times
+  static const unsigned long DefaultWriteLatency = 3400;
+  static const unsigned long DefaultPhaseLatency = 1800;
+
+private:
+  uint8_t  *_image;
+  uint32_t *_wear, *_erases;
+  size_t _size;
+  unsigned long _write_latency, _phase_latency;
+  bool _realtime;
+  unsigned long _busy_until;
+  bool _powered;
+  unsigned long _power_left, _lost_writes;   // Programming time until cut-off
+  unsigned long _programming_time, _bytes_read, _bytes_written;
+
+  void _program(size_t aAddress, uint8_t aValue, ProgramMode aMode);
+
+public:
+  // Create a closed device; 'open()' must be called before use
+  ImageDevice();
+  // Create and open a device, see 'open()'
+  ImageDevice(const char *aPath, size_t aSize, unsigned long aWriteLatency = DefaultWriteLatency);
+  virtual ~ImageDevice();
+
+  // Maps 'aSize' bytes of file 'aPath' (created and erased to 0xFF if absent
+  // or shorter). With NULL 'aPath' the image lives in anonymous memory.
+  // Returns true upon success
+  bool open(const char *aPath, size_t aSize, unsigned long aWriteLatency = DefaultWriteLatency);
+  void close();
+  inline bool is_open() const { return _image != NULL; }
+
+  virtual size_t size() const { return _size; }
+  virtual void read (size_t aAddress, void *aData, size_t aSize);
+  virtual void write(size_t aAddress, const void *aData, size_t aSize);
+  virtual void program(size_t aAddress, uint8_t aValue, ProgramMode aMode);
+  virtual bool is_ready() const;
+  virtual unsigned long cycle_time(ProgramMode aMode) const { return aMode == EraseWrite ? _write_latency : _phase_latency; }
+
+  // Per-byte programming time in microseconds
+  inline unsigned long write_latency() const { return _write_latency; }
+  inline void write_latency(unsigned long aLatency) { _write_latency = aLatency; }
+  inline unsigned long phase_latency() const { return _phase_latency; }
+  inline void phase_latency(unsigned long aLatency) { _phase_latency = aLatency; }
+
+  // Whether writes really take 'write_latency()' per byte
+  inline bool realtime() const { return _realtime; }
+  inline void realtime(bool aRealtime) { _realtime = aRealtime; }
+
+  // Cuts the supply after 'aMicroseconds' more of programming time, or
+  // restores it
+  inline void power_off(unsigned long aMicroseconds) { _powered = false, _power_left = aMicroseconds, _lost_writes = 0; }
+  inline void power_on() { _powered = true; }
+  inline bool powered() const { return _powered; }
+  // Cell programs dropped or cut short since the last 'power_off()'
+  inline unsigned long lost_writes() const { return _lost_writes; }
+
+  // Statistics since open or the last 'reset_stats()'
+  inline unsigned long programming_time() const { return _programming_time; }
+  inline unsigned long bytes_read() const { return _bytes_read; }
+  inline unsigned long bytes_written() const { return _bytes_written; }
+  inline unsigned long wear(size_t aAddress) const { return aAddress < _size ? _wear[aAddress] : 0; }
+  unsigned long max_wear() const;
+  // Cycles that erased a cell (all but write-only ones), what its endurance
+  // is spent on
+  inline unsigned long erases(size_t aAddress) const { return aAddress < _size ? _erases[aAddress] : 0; }
+  unsigned long max_erases() const;
+  void reset_stats();
+
+  // Direct access to the image, e.g. to inspect or corrupt it in tests
+  inline uint8_t *image() { return _image; }
+
+  // Image backing 'NativeDevice' on host builds. Opened on first use with
+  // file 'EROM_IMAGE' (anonymous memory if not set) of 'EROM_IMAGE_SIZE'
+  // bytes (1024 by default); both are read from the environment. Set
+  // 'EROM_REALTIME' to make writes really take their programming time.
+  static ImageDevice& native();
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+#endif // EROM_HOST
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_IMAGE_DEVICE_H_
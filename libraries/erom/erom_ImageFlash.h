@@ -0,0 +1,91 @@
+#ifndef _ROBODEM_EROM_IMAGE_FLASH_H_
+#define _ROBODEM_EROM_IMAGE_FLASH_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_FlashDevice.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#if defined(EROM_HOST)
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host (Linux) NOR flash model in RAM, to run and profile 'FlashDevice'
+// natively. Enforces NOR behavior: erase sets a sector to 0xFF, programming
+// only clears bits and must cover whole aligned units of 'program_size()'
+// bytes. Programs breaking these rules are counted as 'violations()' (and
+// still clear bits only), so a test can catch a driver relying on them.
+//
+// Programming takes 'program_latency()' microseconds per unit, erasing
+// 'erase_latency()' per sector. Like 'ImageDevice', time is modelled unless
+// 'realtime(true)' is set: then programming waits with 'delayMicroseconds()'
+// and an erase keeps the flash busy ('is_ready()' returns false) for its
+// latency of 'micros()' time, which also works with 'host_advance_clock()'.
+// Example:
+//  erom::ImageFlash flash(2048, 4);              // 4 sectors of 2 KB
+//  erom::FlashDevice<512> eeprom(flash, 0, 4);
+//  eeprom.load();
+//  printf("%lu erases max\n", flash.max_erases());
+class ImageFlash : public Flash {
+public:
+  // Typical internal flash: 20 ms page erase, 50 us per 32-bit word
+  static const unsigned long DefaultEraseLatency   = 20000;
+  static const unsigned long DefaultProgramLatency = 50;
+
+private:
+  uint8_t  *_image;
+  uint32_t *_erases;
+  size_t _sector_size, _sectors, _program_size;
+  unsigned long _erase_latency, _program_latency;
+  bool _realtime;
+  unsigned long _busy_until;
+  unsigned long _programming_time, _bytes_programmed, _violations;
+
+  void _wait() const;
+
+public:
+  ImageFlash(size_t aSectorSize, size_t aSectors, size_t aProgramSize = 4);
+  virtual ~ImageFlash();
+
+  virtual size_t sector_size() const { return _sector_size; }
+  virtual size_t sectors() const { return _sectors; }
+  virtual size_t program_size() const { return _program_size; }
+
+  virtual void read(size_t aAddress, void *aData, size_t aSize);
+  virtual void program(size_t aAddress, const void *aData, size_t aSize);
+  virtual void erase(size_t aSector);
+  virtual bool is_ready() const;
+
+  inline unsigned long erase_latency() const { return _erase_latency; }
+  inline void erase_latency(unsigned long aLatency) { _erase_latency = aLatency; }
+  inline unsigned long program_latency() const { return _program_latency; }
+  inline void program_latency(unsigned long aLatency) { _program_latency = aLatency; }
+
+  // Whether erasing and programming really take their latency
+  inline bool realtime() const { return _realtime; }
+  inline void realtime(bool aRealtime) { _realtime = aRealtime; }
+
+  // Statistics since creation or the last 'reset_stats()'
+  inline unsigned long programming_time() const { return _programming_time; }
+  inline unsigned long bytes_programmed() const { return _bytes_programmed; }
+  inline unsigned long violations() const { return _violations; }
+  inline unsigned long erases(size_t aSector) const { return aSector < _sectors ? _erases[aSector] : 0; }
+  unsigned long total_erases() const;
+  unsigned long max_erases() const;
+  void reset_stats();
+
+  // Direct access to the image, e.g. to inspect or corrupt it in tests
+  inline uint8_t *image() { return _image; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+#endif // EROM_HOST
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_IMAGE_FLASH_H_
@@ -0,0 +1,129 @@
+#ifndef _ROBODEM_EROM_KV_STORE_H_
+#define _ROBODEM_EROM_KV_STORE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Access.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Log-structured key/value store. Values are appended as records to a log,
+// so writes move through the whole region instead of hammering fixed cells,
+// and keys can be added, removed or resized between firmware releases
+// without invalidating the others.
+//
+// The region is split into two halves; one holds the log:
+//   [sequence][crc] [record][record]...
+// A record is [key][length][value: 'length' bytes][crc]; a zero length
+// record marks a removed key. Record CRCs are seeded with the sequence of
+// their half, so leftovers of an older log never pass as records. The end
+// of the log is the first record failing its CRC, thus a record cut short
+// by a power loss is simply ignored.
+//
+// 'load()' scans the log once and keeps the offset and length of the newest
+// record of each key in RAM (3 bytes per key), so lookups read the value
+// directly and lengths are not read at all.
+// When the log is full, 'compact()' copies the live records into the other
+// half and commits it by writing its header (with the next sequence) last.
+// Keys are 0 .. 'keys()' - 1, values are up to 255 bytes long.
+class KVStoreBase {
+public:
+  enum {
+    missing         = 0xFFFF,                 // Index value of a missing key
+    header_size     = 2 * sizeof(uint16_t),   // Sequence and its CRC
+    record_overhead = 2 + sizeof(uint16_t)    // Key, length and CRC
+  };
+
+private:
+  const Access &_access;
+  size_t _address, _half_size;
+  uint16_t *_index;
+  uint8_t *_lengths;  // Value lengths of the keys, 0 if missing
+  uint8_t _keys;
+  uint8_t _half;
+  uint16_t _sequence;
+  size_t _end;
+  unsigned long _compactions;
+
+  inline size_t _half_address(uint8_t aHalf) const { return _address + aHalf * _half_size; }
+  inline uint16_t _seed(uint16_t aSequence) const { return crc16(crc16_init, &aSequence, sizeof(aSequence)); }
+
+  bool _read_header(uint8_t aHalf, uint16_t &aSequence) const;
+  void _write_header(uint8_t aHalf, uint16_t aSequence) const;
+  void _scan();
+  bool _equals(size_t aOffset, const void *aData, size_t aSize) const;
+  void _append(uint8_t aKey, const void *aData, uint8_t aSize);
+
+protected:
+  KVStoreBase(const Access &aAccess, size_t aAddress, size_t aSize, uint16_t *aIndex, uint8_t *aLengths, uint8_t aKeys);
+
+public:
+  // Rebuilds the RAM index with a single scan of the log. Initializes an
+  // empty log if there is none. Returns true if an existing log was found
+  bool load();
+
+  // Returns true if there is a value for 'aKey'
+  inline bool contains(uint8_t aKey) const { return aKey < _keys && _index[aKey] != missing; }
+  // Length of the value of 'aKey', 0 if missing
+  inline size_t length(uint8_t aKey) const { return contains(aKey) ? _lengths[aKey] : 0; }
+
+  // Copies up to 'aSize' bytes of the value of 'aKey' into 'aData'.
+  // Returns number of bytes copied, 0 if missing
+  size_t read(uint8_t aKey, void *aData, size_t aSize) const;
+  // Stores 'aSize' bytes of 'aData' as the value of 'aKey'; zero bytes remove
+  // it. Nothing is written if the value did not change. Returns false if the
+  // value does not fit even after 'compact()'
+  bool write(uint8_t aKey, const void *aData, size_t aSize);
+  // Removes 'aKey'. Returns false if the removal could not be logged
+  bool remove(uint8_t aKey);
+
+  // Typed access, the stored length must match the type
+  // Example:
+  //  erom::KVStore<16> config(0, 512);
+  //  config.load();
+  //  float gain = 1.f;
+  //  config.get(3, gain);    // Keeps 1.f unless key 3 holds a float
+  //  config.put(3, 2.5f);
+  template<class T> inline bool get(uint8_t aKey, T &aValue) const { return length(aKey) == sizeof(T) && read(aKey, &aValue, sizeof(T)) == sizeof(T); }
+  template<class T> inline bool put(uint8_t aKey, const T &aValue) { return write(aKey, &aValue, sizeof(T)); }
+
+  // Moves the live records into the other half, leaving the rest of the
+  // space free. Called by 'write()' when the log is full
+  void compact();
+
+  // Amount of keys, bytes used by the log and its capacity (half the region)
+  inline uint8_t keys() const { return _keys; }
+  inline size_t used() const { return _end; }
+  inline size_t capacity() const { return _half_size; }
+  // Sequence of the current log, incremented by every compaction
+  inline uint16_t sequence() const { return _sequence; }
+  inline unsigned long compactions() const { return _compactions; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'KVStoreBase' with a RAM index for 'Keys' keys, taking 'aSize' bytes of
+// EEPROM from 'aAddress' on.
+// Example:
+//  erom::KVStore<8> settings(64, 256); // Keys 0..7, EEPROM 64..319
+//  settings.load();
+//  settings.put(0, 1200L);
+template<uint8_t Keys> class KVStore : public KVStoreBase {
+private:
+  uint16_t _offsets[Keys];
+  uint8_t _lengths[Keys];
+
+public:
+  KVStore(size_t aAddress, size_t aSize) : KVStoreBase(Access::instance(), aAddress, aSize, _offsets, _lengths, Keys) { /* Do Nothing */ }
+  KVStore(const Access &aAccess, size_t aAddress, size_t aSize) : KVStoreBase(aAccess, aAddress, aSize, _offsets, _lengths, Keys) { /* Do Nothing */ }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_KV_STORE_H_
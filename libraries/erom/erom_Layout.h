@@ -0,0 +1,126 @@
+#ifndef _ROBODEM_EROM_LAYOUT_H_
+#define _ROBODEM_EROM_LAYOUT_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Access.h"
+#include "erom_Device.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Unused 'Layout' field
+struct LayoutNone {};
+
+// 'Layout' field of type 'T' placed at an address multiple of 'Align'
+template<typename T, size_t Align> struct Aligned {};
+
+// Type, alignment and size of a 'Layout' field
+template<typename F> struct LayoutFieldTraits { typedef F type; enum { used = 1, align = 1, size = sizeof(F) }; };
+template<typename T, size_t Align> struct LayoutFieldTraits< Aligned<T, Align> > {
+  typedef T type;
+  enum { used = 1, align = Align, size = sizeof(T) };
+};
+template<> struct LayoutFieldTraits<LayoutNone> { typedef LayoutNone type; enum { used = 0, align = 1, size = 0 }; };
+
+// Field 'Index' of fields 'F0'... placed from 'Offset' on
+template<size_t Offset, int Index, class F0, class F1, class F2, class F3, class F4, class F5, class F6, class F7>
+struct LayoutField {
+  typedef LayoutFieldTraits<F0> _traits;
+  typedef LayoutField<(Offset + _traits::align - 1) / _traits::align * _traits::align + _traits::size,
+                      Index - 1, F1, F2, F3, F4, F5, F6, F7, LayoutNone> _next;
+  typedef typename _next::type type;
+  enum { address = _next::address, end = _next::end };
+};
+
+template<size_t Offset, class F0, class F1, class F2, class F3, class F4, class F5, class F6, class F7>
+struct LayoutField<Offset, 0, F0, F1, F2, F3, F4, F5, F6, F7> {
+  typedef LayoutFieldTraits<F0> _traits;
+  typedef typename _traits::type type;
+  enum { address = (Offset + _traits::align - 1) / _traits::align * _traits::align, end = address + _traits::size };
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// EEPROM layout resolved at compile time. Lists up to 8 field types, placed
+// one after another from address 'Base' on; wrap a type into 'Aligned<T, N>'
+// to place it at an address multiple of N. Compilation fails if the layout
+// does not fit the chip's EEPROM ('EROM_DEVICE_MEMORY_SIZE', not checked if
+// unknown). Addresses are logical, i.e. relative to 'Access::base()'.
+// Layouts can be chained: 'Layout<Other::end, ...>' starts where 'Other' ends.
+// Example:
+//  typedef erom::Layout<0, long, erom::Aligned<float, 4>, char[16]> Schema;
+//  // Schema::field<1>::address == 4, Schema::end == 24
+template<size_t Base,
+         class F0,              class F1 = LayoutNone, class F2 = LayoutNone, class F3 = LayoutNone,
+         class F4 = LayoutNone, class F5 = LayoutNone, class F6 = LayoutNone, class F7 = LayoutNone>
+class Layout {
+public:
+  enum {
+    base   = Base,
+    fields = LayoutFieldTraits<F0>::used + LayoutFieldTraits<F1>::used + LayoutFieldTraits<F2>::used + LayoutFieldTraits<F3>::used
+           + LayoutFieldTraits<F4>::used + LayoutFieldTraits<F5>::used + LayoutFieldTraits<F6>::used + LayoutFieldTraits<F7>::used,
+    end    = LayoutField<Base, 7, F0, F1, F2, F3, F4, F5, F6, F7>::end,
+    size   = end - base
+  };
+
+  // Type and address of field 'Index'
+  template<int Index> struct field {
+  private:
+    typedef char _index_check[(Index >= 0 && Index < fields) ? 1 : -1];
+    typedef LayoutField<Base, Index, F0, F1, F2, F3, F4, F5, F6, F7> _field;
+
+  public:
+    typedef typename _field::type type;
+    enum { address = _field::address, size = sizeof(type) };
+  };
+
+private:
+  // Layout must fit the chip's EEPROM
+  typedef char _size_check[(EROM_DEVICE_MEMORY_SIZE == 0 || (size_t)end <= (size_t)EROM_DEVICE_MEMORY_SIZE) ? 1 : -1];
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Value of field 'Index' of 'Schema' (a 'Layout'). Unlike 'Entry' it holds
+// nothing but the value: the address is a compile-time constant and the
+// access is passed to 'load()'/'save()' ('Access::instance()' by default),
+// so each of them is a single block transfer from/to a constant address.
+// Example:
+//  typedef erom::Layout<0, uint16_t, long> Schema;
+//  erom::StaticEntry<Schema, 0> boots;   // sizeof(boots) == sizeof(uint16_t)
+//  erom::StaticEntry<Schema, 1> uptime;
+//  boots.load(); ++boots; boots.save();
+template<class Schema, int Index> class StaticEntry {
+public:
+  typedef typename Schema::template field<Index>::type type;
+  enum { address = Schema::template field<Index>::address, size = sizeof(type) };
+
+  type value;   // Data stored in RAM
+
+  // Create an entry with unknown RAM value; call 'load()' to read it
+  StaticEntry() { /* Do Nothing */ }
+  // Create an entry and initialize RAM value with aValue
+  StaticEntry(const type &aValue) : value(aValue) { /* Do Nothing */ }
+
+  inline operator const type&() const { return value; }
+  inline operator type&() { return value; }
+  inline StaticEntry& operator=(const type &aValue) { value = aValue; return *this; }
+
+  // Load value from EEPROM to RAM
+  inline void load(const Access &aAccess = Access::instance()) { aAccess.read_block(address, value); }
+  // Write RAM value into EEPROM
+  // aFullWrite - if true, all data will be written, otherwise changes only
+  inline void save(bool aFullWrite = false, const Access &aAccess = Access::instance()) const {
+    if (aFullWrite) aAccess.write_block(address, value);
+    else aAccess.update_block(address, value);
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_LAYOUT_H_
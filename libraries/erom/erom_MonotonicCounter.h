@@ -0,0 +1,207 @@
+#ifndef _ROBODEM_EROM_MONOTONIC_COUNTER_H_
+#define _ROBODEM_EROM_MONOTONIC_COUNTER_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Access.h"
+#include "erom_Crc.h"
+#include "erom_Entry.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// An 'Entry<uint32_t>' for event counters (boot count, relay cycles, etc.)
+// that only ever grow. The count is kept as a binary base plus 'Bytes' bytes
+// of unary code: every increment clears one more bit, lowest bit of the
+// first byte first, which is a write-only cycle (see 'ProgramMode') taking
+// about half the time of an erase+write and no erase at all. Only when all
+// 'Bytes * 8' bits are cleared, the base is rewritten and the bits erased,
+// so each cell is erased once per 'Bytes * 8' increments.
+//
+// EEPROM layout: two status bytes, two base slots and the unary bits.
+//   [status 0][status 1][base 0][base 1][bits 0 .. Bytes-1]
+// A rollover writes the new base into the slot not in use, then advances its
+// status byte (as 'WearLeveledEntry' does), then erases the bits from the
+// last one. A power loss in between may count some increments twice, but the
+// stored count never goes back.
+//
+// Saving a value lower than the stored one (e.g. resetting the counter to 0)
+// or more than 'Bytes * 8' above the base rolls over as well.
+// Example:
+//  erom::MonotonicCounter<16> boots(0);   // 2 + 8 + 16 = 26 bytes
+//  ++boots;
+//  boots.save();                           // Clears one bit, write-only
+template<size_t Bytes> class MonotonicCounter : public Entry<uint32_t> {
+friend class Storage;
+
+public:
+  typedef uint32_t type;
+  enum { bytes = Bytes, capacity = Bytes * 8, size = 2 + 2 * sizeof(type) + Bytes };
+
+private:
+  // Unary bits must fit 'size_t' counts on 8-bit targets
+  typedef char _bytes_check[(Bytes > 0 && Bytes < 4096) ? 1 : -1];
+
+  static const uint8_t unknown_slot = 0xFF;
+  uint8_t _slot;      // Base slot in use, 'unknown_slot' if not scanned yet
+  type _base;         // Stored base
+  size_t _count;      // Stored bits cleared
+
+  inline size_t _status_address(uint8_t aSlot) const { return address() + aSlot; }
+  inline size_t _base_address(uint8_t aSlot) const { return address() + 2 + aSlot * sizeof(type); }
+  inline size_t _bits_address() const { return address() + 2 + 2 * sizeof(type); }
+
+  // Unary byte holding the first 'aCount - 8 * aByte' cleared bits
+  static inline uint8_t _bits(size_t aByte, size_t aCount) {
+    return aCount >= aByte * 8 + 8 ? 0x00 : aCount > aByte * 8 ? (uint8_t)(0xFF << (aCount - aByte * 8)) : 0xFF;
+  }
+
+  // Reads the stored base slot, base and cleared bits, or returns the ones
+  // seen last
+  void _stored(uint8_t &aSlot, type &aBase, size_t &aCount) const {
+    if (_slot != unknown_slot) { aSlot = _slot, aBase = _base, aCount = _count; return; }
+    uint8_t __status = get_access()->read_byte(_status_address(0));
+    aSlot = get_access()->read_byte(_status_address(1)) == (uint8_t)(__status + 1) ? 1 : 0;
+    aBase = 0;
+    get_access()->read_block(_base_address(aSlot), aBase);
+
+    // Cleared bits are counted wherever they are
+    aCount = 0;
+    uint8_t __bits[8];
+    for (size_t __i = 0; __i < Bytes; __i += sizeof(__bits)) {
+      size_t __size = Bytes - __i < sizeof(__bits) ? Bytes - __i : sizeof(__bits);
+      get_access()->read_block(_bits_address() + __i, __bits, __size);
+      for (size_t __j = 0; __j < __size; __j++)
+        for (uint8_t __b = ~__bits[__j]; __b; __b >>= 1) aCount += __b & 1;
+    }
+  }
+  inline void _scan() { _slot = unknown_slot; _stored(_slot, _base, _count); }
+
+  // Whether 'value' is reached by clearing more bits over 'aBase'
+  inline bool _advances(type aBase, size_t aCount) const {
+    return value >= aBase && value - aBase >= aCount && value - aBase <= (type)capacity;
+  }
+
+protected:
+  inline void set_address(size_t aAddress) { Entry<uint32_t>::set_address(aAddress); _slot = unknown_slot; }
+
+public:
+  // Create a null referenced counter. It wont' be able to interact with EEPROM.
+  // Used in 'Storage'.
+  MonotonicCounter() : Entry<uint32_t>(), _slot(unknown_slot), _base(0), _count(0) { /* Do Nothing */ }
+  // Create a referenced counter with default access (Access::instance()) with
+  // manually defined address. Initializes RAM value with the stored count.
+  MonotonicCounter(size_t aAddress) : Entry<uint32_t>(), _slot(unknown_slot), _base(0), _count(0) { set_access(&Access::instance()); set_address(aAddress); load(); }
+  // Create a referenced counter with default access (Access::instance()) with
+  // manually defined address. Initialized RAM value with aValue.
+  MonotonicCounter(size_t aAddress, type aValue) : Entry<uint32_t>(aAddress, aValue), _slot(unknown_slot), _base(0), _count(0) { /* Do Nothing */ }
+  // Create a referenced counter with given access and manually defined
+  // address. Initializes RAM value with the stored count.
+  MonotonicCounter(Access &aAccess, size_t aAddress) : Entry<uint32_t>(), _slot(unknown_slot), _base(0), _count(0) { set_access(&aAccess); set_address(aAddress); load(); }
+  // Create a referenced counter with given access and manually defined
+  // address and initializes RAM value with with aValue.
+  MonotonicCounter(Access &aAccess, size_t aAddress, type aValue) : Entry<uint32_t>(aAccess, aAddress, aValue), _slot(unknown_slot), _base(0), _count(0) { /* Do Nothing */ }
+
+  inline MonotonicCounter& operator=(type aValue) { value = aValue; touch(); return *this; }
+  inline MonotonicCounter& assign(type aValue) { value = aValue; touch(); return *this; }
+
+  // Store RAM value: clears the bits it is ahead of the stored count, or
+  // rolls over (see above). Nothing is written if the value equals the
+  // stored count, unless aFullWrite is true; then the counter is rolled over
+  // with every byte written. Stays dirty if the write queue rejected a byte
+  // (see 'Access::queue_policy()'): the bits cleared so far are counted, a
+  // rollover is only started with room for all of it.
+  virtual void save(bool aFullWrite = false) {
+    if (!get_access()) return;
+    if (_slot == unknown_slot) _scan();
+
+    if (!aFullWrite && _advances(_base, _count)) {
+      // Clears the lowest bits still set, so bits cleared out of order by a
+      // cut programming cycle are counted once
+      size_t __count = value - _base;
+      for (size_t __i = _count / 8; __i < Bytes && _count < __count; __i++) {
+        uint8_t __stored = get_access()->read_byte(_bits_address() + __i), __bits = __stored;
+        size_t __cleared = _count;
+        for (uint8_t __bit = 1; __bit && __cleared < __count; __bit <<= 1)
+          if (__bits & __bit) __bits &= ~__bit, __cleared++;
+        if (__bits != __stored && !get_access()->update_byte(_bits_address() + __i, __bits)) return;
+        _count = __cleared;
+      }
+      if (_count == __count) { _dirty = false; return; }
+    }
+    if (!get_access()->fits(sizeof(type) + 1 + Bytes)) return;
+
+    uint8_t __status = get_access()->read_byte(_status_address(_slot));
+    uint8_t __next = _slot ^ 1;
+    if (aFullWrite) get_access()->write_block(_base_address(__next), value);
+    else get_access()->update_block(_base_address(__next), value);
+    get_access()->write_byte(_status_address(__next), __status + 1);
+    _slot = __next, _base = value;
+
+    // Last byte first, so a cut erase leaves cleared bits in order
+    for (size_t __i = Bytes; __i-- > 0; ) {
+      if (aFullWrite) get_access()->write_byte(_bits_address() + __i, 0xFF);
+      else get_access()->update_byte(_bits_address() + __i, 0xFF);
+    }
+    _count = 0;
+    _dirty = false;
+  }
+
+  // Estimated microseconds 'save()' takes: the bits to clear, or the base,
+  // status byte and bits to erase of a rollover
+  virtual unsigned long save_time() const {
+    if (!get_access()) return 0;
+    uint8_t __slot; type __base; size_t __count;
+    _stored(__slot, __base, __count);
+    unsigned long __time = 0;
+
+    if (_advances(__base, __count)) {
+      size_t __end = value - __base;
+      for (size_t __i = __count / 8; __i * 8 < __end; __i++)
+        __time += get_access()->update_time(_bits_address() + __i, _bits(__i, __end));
+      return __time;
+    }
+
+    __time = get_access()->update_time(_base_address(__slot ^ 1), value) + get_access()->write_time(_status_address(__slot ^ 1), 1);
+    for (size_t __i = 0; __i * 8 < __count && __i < Bytes; __i++)
+      __time += get_access()->update_time(_bits_address() + __i, (uint8_t)0xFF);  // Cleared bits come first
+    return __time;
+  }
+
+  // Continue CRC-16 'aCrc' over the stored count
+  virtual uint16_t stored_crc16(uint16_t aCrc) const {
+    if (!get_access()) return aCrc;
+    uint8_t __slot; type __base; size_t __count;
+    _stored(__slot, __base, __count);
+    type __value = __base + __count;
+    return erom::crc16(aCrc, &__value, sizeof(__value));
+  }
+
+  // Load the stored count from EEPROM to RAM
+  virtual void load() {
+    if (!get_access()) return;
+    _scan();
+    value = _base + _count;
+    _dirty = false;
+  }
+
+  // Bits are not a flat copy of the value: always saved and loaded by
+  // 'save()' and 'load()'
+  virtual bool save_shadowed(uint8_t * /* aShadow */, size_t /* aSize */) { return false; }
+  virtual bool load_shadowed(const uint8_t * /* aShadow */, size_t /* aSize */) { return false; }
+
+  // Stored binary base and bits cleared over it (valid after 'load()' or
+  // 'save()')
+  inline type base() const { return _base; }
+  inline size_t cleared() const { return _count; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_MONOTONIC_COUNTER_H_
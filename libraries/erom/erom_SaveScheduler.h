@@ -0,0 +1,89 @@
+#ifndef _ROBODEM_EROM_SAVE_SCHEDULER_H_
+#define _ROBODEM_EROM_SAVE_SCHEDULER_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Storage.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Saves a 'Storage' within an EEPROM endurance budget, instead of after a
+// fixed 'postpone_save()' delay. Every save that writes anything cycles the
+// hottest cell once (the one of a value changing every time, or a
+// 'VerifiedStorage' checksum), so cells of 'aEndurance' cycles last
+// 'aLifetimeYears' if saves are at least 'interval()' =
+// lifetime / endurance apart. If every changing value is spread over
+// 'aLeveling' cells (e.g. 'WearLeveledEntry<T, 8>'), the interval shrinks
+// by that factor.
+//
+// 'tick()' saves changed entries once they waited 'min_delay()' and the
+// budget allows: each save pushes the next allowed one 'interval()' further,
+// counted from now or from when it was allowed, whichever is later. So
+// after quiet periods changes are saved quickly, while under constant
+// changes the coalescing window grows until saves settle at one per
+// 'interval()'. Saves writing nothing (values changed back) cost nothing.
+// Critical entries ('EntryBase::critical()') are saved as soon as they
+// change; those saves are counted too and delay the following ones.
+// Example:
+//  Storage storage;                              // With entries 'A0', 'alarm'
+//  erom::SaveScheduler scheduler(storage, 10);   // 10 years of 100000 cycles
+//  storage.alarm.critical(true);
+//  ...
+//  void loop() {
+//    storage.A0 = analogRead(A0);
+//    scheduler.tick();                           // Instead of 'storage.tick()'
+//  }
+class SaveScheduler {
+public:
+  // Erase/write cycles of AVR EEPROM cells, and the default 'min_delay()'
+  static const unsigned long DefaultEndurance = 100000;
+  static const unsigned long DefaultMinDelay  = 1000;
+
+private:
+  Storage &_storage;
+  unsigned long _cycles;              // Endurance times leveling
+  unsigned long _interval, _min_delay;
+  unsigned long _due;                 // When the budget allows the next save
+  unsigned long _since;               // When unsaved changes were seen first
+  bool _pending;
+  unsigned long _last_tick, _uptime, _uptime_ms;
+  unsigned long _saves, _bytes_written, _max_window;
+
+public:
+  SaveScheduler(Storage &aStorage, unsigned int aLifetimeYears, unsigned long aEndurance = DefaultEndurance, uint8_t aLeveling = 1);
+
+  // Must be called in the main program loop (it calls 'Storage::tick()')
+  void tick();
+  // Saves changed entries now (e.g. before powering down), within the
+  // budget or not
+  void save();
+
+  // Milliseconds of budget per save
+  inline unsigned long interval() const { return _interval; }
+  // Least time changes wait for other changes to save them together, in ms
+  inline unsigned long min_delay() const { return _min_delay; }
+  inline void min_delay(unsigned long aDelay) { _min_delay = aDelay; }
+  // Milliseconds a change made now would wait to be saved (the current
+  // coalescing window)
+  unsigned long window() const;
+
+  // Saves that wrote something and bytes they wrote, since start
+  inline unsigned long saves() const { return _saves; }
+  inline unsigned long bytes_written() const { return _bytes_written; }
+  // Longest time changes waited to be saved, i.e. the data lost at worst
+  // by a power loss, in milliseconds
+  inline unsigned long max_window() const { return _max_window; }
+  // Days the hottest cell lasts at the save rate seen since start
+  unsigned long projected_lifetime() const;
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_SAVE_SCHEDULER_H_
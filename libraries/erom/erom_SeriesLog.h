@@ -0,0 +1,153 @@
+#ifndef _ROBODEM_EROM_SERIES_LOG_H_
+#define _ROBODEM_EROM_SERIES_LOG_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Access.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Compressed ring buffer of integer samples (up to 4 bytes each). The region
+// is divided into fixed-size blocks:
+//   [sequence][crc][time][size][base] [delta][delta]...
+// 'base' is the first sample of the block, 'time' its timestamp; every next
+// sample is stored as the difference to the previous one, zigzag and varint
+// encoded (1 byte for differences of -64..63, 2 bytes up to +-8191...).
+// 'size' is the amount of delta bytes, the CRC covers the whole block.
+//
+// The block being filled lives in RAM and is written to EEPROM in one batch
+// when it is full, or on 'flush()'. Repeated flushes of the same block only
+// write its new bytes and header. When all blocks are used, the oldest one
+// is overwritten. Samples appended since the last flush are lost on a power
+// loss; so is the open block if the power fails during its flush.
+class SeriesLogBase {
+public:
+  enum {
+    time_offset   = 2 * sizeof(uint16_t),        // After sequence and CRC
+    size_offset   = time_offset + sizeof(uint32_t),
+    base_offset   = size_offset + sizeof(uint8_t),
+    max_delta_size = 5                            // Varint of 32 bits
+  };
+
+  // Streaming reader, yields samples from the oldest to the newest one
+  // without loading whole blocks into RAM. Appending while reading is not
+  // supported.
+  class Reader {
+  private:
+    const SeriesLogBase &_log;
+    size_t _block;           // Blocks opened so far, oldest first
+    size_t _address;         // EEPROM address of the current block
+    bool _ram;               // Current block is the open one, read from RAM
+    uint8_t _position, _size, _index;
+    uint32_t _value, _time;
+    bool _in_block;
+
+    uint8_t _byte(uint8_t aOffset) const;
+    bool _open_block();
+
+  protected:
+    Reader(const SeriesLogBase &aLog) : _log(aLog), _block(0), _address(0), _ram(false), _position(0), _size(0), _index(0), _value(0), _time(0), _in_block(false) { /* Do Nothing */ }
+    bool _next(uint32_t &aValue);
+
+  public:
+    // Timestamp of the first sample of the current block
+    inline unsigned long time() const { return _time; }
+    // Index of the current sample within its block, 0 for the first one
+    inline uint8_t index() const { return _index; }
+    // Restart from the oldest sample
+    inline void rewind() { _block = 0, _in_block = false; }
+  };
+
+private:
+  friend class Reader;
+
+  const Access &_access;
+  size_t _address, _blocks;
+  uint8_t *_block;
+  uint8_t _block_size, _value_size, _header_size;
+  size_t _head;            // Index of the newest block
+  uint16_t _sequence;      // Sequence of the newest block
+  bool _open, _dirty;      // Newest block is in RAM, has unflushed changes
+  uint8_t _size, _flushed; // Delta bytes in RAM and in EEPROM
+  uint32_t _last;          // Last appended sample
+
+  inline size_t _block_address(size_t aBlock) const { return _address + aBlock * _block_size; }
+  inline uint8_t _capacity() const { return _block_size - _header_size; }
+  uint32_t _extend(uint32_t aValue) const;
+  uint16_t _crc(const uint8_t *aHeader, uint16_t aCrc) const; // Over the header fields
+  bool _check(size_t aBlock, uint8_t *aHeader) const;
+
+protected:
+  SeriesLogBase(const Access &aAccess, size_t aAddress, size_t aSize, uint8_t *aBlock, uint8_t aBlockSize, uint8_t aValueSize);
+
+  void _append(uint32_t aValue, unsigned long aTime);
+
+public:
+  // Finds the newest block and reopens it, so appending continues where it
+  // stopped. Returns false if the log is empty
+  bool load();
+  // Writes the new samples of the open block into EEPROM
+  void flush();
+
+  // Amount of blocks and their size in bytes
+  inline size_t blocks() const { return _blocks; }
+  inline uint8_t block_size() const { return _block_size; }
+  // Sequence of the newest block, incremented by every new block
+  inline uint16_t sequence() const { return _sequence; }
+  // Returns true if there are appended samples not written to EEPROM yet
+  inline bool dirty() const { return _dirty; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'SeriesLogBase' of samples of type 'T' (an integer of up to 4 bytes) in
+// blocks of 'BlockSize' bytes, taking 'aSize' bytes of EEPROM from 'aAddress'
+// on. The open block takes 'BlockSize' bytes of RAM.
+// Example:
+//  erom::SeriesLog<int> history(64, 512);  // 16 blocks of 32 bytes
+//  history.load();
+//  history.append(analogRead(A0));         // Timestamped with 'millis()'
+//  ...
+//  history.flush();                        // E.g. before going to sleep
+//
+//  erom::SeriesLog<int>::Reader reader(history);
+//  int sample;
+//  while (reader.next(sample)) Serial.println(sample);
+template<typename T, uint8_t BlockSize = 32> class SeriesLog : public SeriesLogBase {
+private:
+  // Samples must fit 32 bits, blocks must hold the header and a few deltas
+  typedef char _type_check[sizeof(T) <= sizeof(uint32_t) ? 1 : -1];
+  typedef char _block_size_check[BlockSize >= base_offset + sizeof(T) + 2 * max_delta_size ? 1 : -1];
+
+  uint8_t _buffer[BlockSize];
+
+public:
+  class Reader : public SeriesLogBase::Reader {
+  public:
+    Reader(const SeriesLog &aLog) : SeriesLogBase::Reader(aLog) { /* Do Nothing */ }
+    // Reads the next sample. Returns false after the newest one
+    inline bool next(T &aValue) {
+      uint32_t __value;
+      if (!_next(__value)) return false;
+      aValue = static_cast<T>(__value);
+      return true;
+    }
+  };
+
+  SeriesLog(size_t aAddress, size_t aSize) : SeriesLogBase(Access::instance(), aAddress, aSize, _buffer, BlockSize, sizeof(T)) { /* Do Nothing */ }
+  SeriesLog(const Access &aAccess, size_t aAddress, size_t aSize) : SeriesLogBase(aAccess, aAddress, aSize, _buffer, BlockSize, sizeof(T)) { /* Do Nothing */ }
+
+  // Appends a sample taken at 'millis()' or at 'aTime'
+  inline void append(const T &aValue) { _append(static_cast<uint32_t>(aValue), millis()); }
+  inline void append(const T &aValue, unsigned long aTime) { _append(static_cast<uint32_t>(aValue), aTime); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_SERIES_LOG_H_
@@ -0,0 +1,93 @@
+#ifndef _ROBODEM_EROM_SHADOW_STORAGE_H_
+#define _ROBODEM_EROM_SHADOW_STORAGE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "erom_Access.h"
+#include "erom_Storage.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'Storage' keeping a contiguous RAM copy (shadow) of the image its entries
+// last loaded or saved. 'load()' reads the issued region in one block and
+// the entries take their values from the shadow. 'save()' compares each
+// changed entry against the shadow with 'memcmp()' and writes only the
+// bytes which differ (see 'Access::update_known()'), without reading EEPROM
+// back; unchanged entries cost no device access at all. The first save
+// without a valid shadow reads it in one block.
+//
+// 'WearLeveledEntry' and 'MonotonicCounter' objects, and entries issued past
+// the shadow, are loaded and saved by themselves as in a plain 'Storage'.
+// Resumable passes ('begin_load()', 'begin_save()') and 'flush()' save and
+// load entry by entry too, and drop the shadow.
+// NOTE: entries must be saved through the storage ('save()'), not one by
+// one; call 'invalidate()' after writing the storage's EEPROM behind its
+// back, or a changed value equal to the shadow would not be written.
+class ShadowStorageBase : public Storage {
+private:
+  uint8_t *_shadow;
+  size_t _shadow_size;
+  size_t _shadowed;     // Leading bytes of '_shadow' holding what EEPROM holds
+
+  // Reads the issued region (as much as fits) into the shadow
+  void _fill();
+
+protected:
+  ShadowStorageBase(uint8_t *aShadow, size_t aSize) : Storage(), _shadow(aShadow), _shadow_size(aSize), _shadowed(0) { /* Do Nothing */ }
+  ShadowStorageBase(Access &aAccess, uint8_t *aShadow, size_t aSize) : Storage(aAccess), _shadow(aShadow), _shadow_size(aSize), _shadowed(0) { /* Do Nothing */ }
+
+  // Loads the shadow in one read, then registered entries from it
+  // NOTE: when overridden, 'ShadowStorageBase::OnLoad()' must be called by user
+  virtual void OnLoad();
+  // Saves changed registered entries against the shadow
+  // NOTE: when overridden, 'ShadowStorageBase::OnSave()' must be called by user
+  virtual void OnSave();
+  // Entry by entry saves and loads bypass the shadow, which is dropped
+  virtual unsigned long OnFlush(unsigned long aBudget) { invalidate(); return Storage::OnFlush(aBudget); }
+  virtual bool OnBeginLoad() { invalidate(); return Storage::OnBeginLoad(); }
+  virtual bool OnBeginSave() { invalidate(); return Storage::OnBeginSave(); }
+
+public:
+  // Drops the shadow: the next 'load()' or 'save()' reads EEPROM again
+  inline void invalidate() { _shadowed = 0; }
+  // Returns true while the shadow holds what EEPROM holds
+  inline bool shadowed() const { return _shadowed != 0; }
+  // Bytes of RAM copy
+  inline size_t shadow_size() const { return _shadow_size; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'ShadowStorageBase' with a shadow of 'Size' bytes, at least 'size()' of the
+// storage to cover all of its entries.
+// Example:
+//  class Settings : public erom::ShadowStorage<64> {
+//  public:
+//    erom::Entry<long> counter;
+//    erom::Entry<float> gains[8];
+//    Settings() { issue(counter); for (int i = 0; i < 8; i++) issue(gains[i]); }
+//  } settings;
+//
+//  settings.load();    // One 36 byte read
+//  settings.gains[2] = 0.5f;
+//  settings.save();    // Compares 'gains[2]' in RAM, programs changed bytes
+template<size_t Size> class ShadowStorage : public ShadowStorageBase {
+private:
+  typedef char _size_check[Size > 0 ? 1 : -1];
+
+  uint8_t _buffer[Size];
+
+public:
+  ShadowStorage() : ShadowStorageBase(_buffer, Size) { /* Do Nothing */ }
+  ShadowStorage(Access &aAccess) : ShadowStorageBase(aAccess, _buffer, Size) { /* Do Nothing */ }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_SHADOW_STORAGE_H_
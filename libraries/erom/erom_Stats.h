@@ -0,0 +1,121 @@
+#ifndef _ROBODEM_EROM_STATS_H_
+#define _ROBODEM_EROM_STATS_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Define 'EROM_STATS' to make 'Access' count its EEPROM traffic (see
+// 'erom::Stats'). Without it the instrumentation compiles to nothing. Set
+// through compiler flags, so the library and the sketch see the same value.
+//
+// Written bytes are counted per bucket of 'EROM_STATS_BUCKET_SIZE' physical
+// addresses; addresses past the last of 'EROM_STATS_BUCKETS' buckets count
+// into the last one. The histogram takes 'EROM_STATS_BUCKETS * 4' bytes of
+// RAM; use a bucket size of 1 for per-cell counts.
+#ifndef EROM_STATS_BUCKETS
+#define EROM_STATS_BUCKETS 16
+#endif
+
+#ifndef EROM_STATS_BUCKET_SIZE
+#define EROM_STATS_BUCKET_SIZE 64
+#endif
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#ifdef EROM_STATS
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// EEPROM traffic counters, shared by all 'Access' objects (addresses are
+// physical, i.e. base-adjusted). Counts bytes read, written, and left alone
+// by update methods because they did not change, per-bucket writes for wear
+// forecasting, and the time write methods spent blocked waiting for EEPROM
+// (or for room in the write queue). Reads are not timed, as the clock would
+// cost more than the read itself.
+// Example (build with -DEROM_STATS):
+//  erom::Stats::reset();
+//  storage.save();
+//  erom::Stats::dump(Serial);
+//  if (erom::Stats::bucket_writes(erom::Stats::hottest_bucket()) > 10000) ...
+class Stats {
+public:
+  enum { buckets = EROM_STATS_BUCKETS, bucket_size = EROM_STATS_BUCKET_SIZE };
+
+  // Adds the lifetime of the object to the blocked time
+  class Timer {
+  private:
+    unsigned long _start;
+  public:
+    Timer() : _start(Stats::clock()) { /* Do Nothing */ }
+    ~Timer() { Stats::_blocked_time += Stats::clock() - _start; }
+  };
+
+private:
+  friend class Timer;
+
+  static uint32_t _writes[buckets];
+  static unsigned long _bytes_read, _bytes_written, _bytes_skipped, _blocked_time;
+
+  static unsigned long clock();
+
+public:
+  // Counting hooks, called by 'Access'
+  static inline void read(size_t /* aAddress */, size_t aSize) { _bytes_read += aSize; }
+  static void write(size_t aAddress, size_t aSize);
+  static inline void skip(size_t aSize) { _bytes_skipped += aSize; }
+
+  // Totals since start or the last 'reset()'
+  static inline unsigned long bytes_read() { return _bytes_read; }
+  static inline unsigned long bytes_written() { return _bytes_written; }
+  static inline unsigned long bytes_skipped() { return _bytes_skipped; }
+  // Time blocked in write methods, in microseconds
+  static inline unsigned long blocked_time() { return _blocked_time; }
+
+  // Write histogram
+  static inline size_t bucket(size_t aAddress) { return aAddress / bucket_size < buckets ? aAddress / bucket_size : buckets - 1; }
+  static inline uint32_t bucket_writes(size_t aBucket) { return aBucket < buckets ? _writes[aBucket] : 0; }
+  static size_t hottest_bucket();
+
+  static void reset();
+
+  // Prints totals and the non-empty buckets to 'aOut' ('Serial' or any other
+  // object with Arduino-like 'print()'/'println()')
+  template<class P> static void dump(P &aOut) {
+    aOut.print("read ");    aOut.print(bytes_read());
+    aOut.print(" written ");  aOut.print(bytes_written());
+    aOut.print(" skipped ");  aOut.print(bytes_skipped());
+    aOut.print(" blocked_us "); aOut.println(blocked_time());
+    for (size_t __i = 0; __i < buckets; __i++) {
+      if (!_writes[__i]) continue;
+      aOut.print((unsigned long)(__i * bucket_size));
+      aOut.print(": ");
+      aOut.println((unsigned long)_writes[__i]);
+    }
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+#define EROM_STATS_READ(aAddress, aSize)  erom::Stats::read(aAddress, aSize)
+#define EROM_STATS_WRITE(aAddress, aSize) erom::Stats::write(aAddress, aSize)
+#define EROM_STATS_SKIP(aSize)            erom::Stats::skip(aSize)
+#define EROM_STATS_TIMER()                erom::Stats::Timer __stats_timer
+
+#else // EROM_STATS
+
+#define EROM_STATS_READ(aAddress, aSize)
+#define EROM_STATS_WRITE(aAddress, aSize)
+#define EROM_STATS_SKIP(aSize)
+#define EROM_STATS_TIMER()
+
+#endif // EROM_STATS
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_STATS_H_
@@ -4,6 +4,10 @@
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 #include "erom_Access.h"
+#include "erom_Entry.h"
+#include "erom_WearLeveledEntry.h"
+#include "erom_MonotonicCounter.h"
+#include "erom_EntryArray.h"
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
@@ -13,32 +17,128 @@ namespace erom {
 // EEPROM storage management, used to issue address locations to 'Entry'
 // objects, as well, as initializing, saving and loading multiple entries.
 // Also provides postponed save functionality to reduce flash write cycles.
+// Entries issued by reference ('issue(entry)') are registered with the
+// storage, so by default 'load()' loads all of them and 'save()' saves only
+// those changed since the last save or load (see 'EntryBase::dirty()').
+//
+// 'load()' and 'save()' run to completion, which blocks the sketch for the
+// programming time of every changed byte. 'begin_load()'/'begin_save()'
+// start the same work as a resumable pass instead, which 'tick(aBudget)'
+// advances an entry at a time within 'aBudget' microseconds per call.
+// Example:
+//  storage.begin_load();
+//  while (storage.busy()) storage.tick(2000), control();  // 2 ms slices
+//  ...
+//  void loop() { storage.tick(2000); control(); }         // Postponed saves in slices
 class Storage {
 public:
   // Default postponed save delay duration
   static const unsigned long DefaultPostponeSaveDelay = 1000;
 
+  // Resumable pass run by 'tick(aBudget)'
+  enum Pass {
+    Idle    = 0,
+    Loading = 1,
+    Saving  = 2
+  };
+
 private:
   Access &_access;
   size_t _last_issue;
   unsigned long _save_time;
   bool _save_requested;
+  EntryBase *_first_entry, *_last_entry;   // Registry of issued entries
+  uint8_t _pass, _phase;                   // See 'Pass' and '_Phase'
+  EntryBase *_cursor;                      // Next entry of the pass
+  size_t _pass_entries, _pass_done;        // Entries marked pending by the pass, done so far
+  EntryBase *volatile _current;            // Entry being saved, see 'flush()'
+  volatile bool _preempted;                // 'flush()' ran since the save started
+
+  enum _Phase { _Begin, _Entries, _End };
 
   inline size_t _advance_issue(size_t aSize) { return _last_issue < access().memory_size() ? _last_issue += aSize : _last_issue; }
+  void _register(EntryBase &aEntry);
+  void _begin(Pass aPass);
+  // Runs the next step of the pass: a call of its begin or end hook, or the
+  // load or save of the next pending entry
+  void _step();
 
 protected:
-  virtual void OnLoad() { /* Do Nothing */ }  // Override to specify how to load your entries from EEPROM
-  virtual void OnSave() { /* Do Nothing */ }  // Override to specify how to save your entries to EEPROM
-  virtual void OnClear() { /* Do Nothing */ } // Override to specify how to clear/initialize RAM values with default data
+  // Override to specify how to load your entries from EEPROM. By default loads
+  // all registered entries
+  virtual void OnLoad() { load_entries(); }
+  // Override to specify how to save your entries to EEPROM. By default saves
+  // registered entries that changed since the last save or load
+  virtual void OnSave() { save_entries(); }
+  // Override to specify how to clear/initialize RAM values with default data
+  virtual void OnClear() { /* Do Nothing */ }
+  // Override to specify how to save your entries within 'aBudget'
+  // microseconds, see 'flush()'. By default flushes registered entries by
+  // priority
+  virtual unsigned long OnFlush(unsigned long aBudget) { return flush_entries(aBudget); }
+  // Override to specify how a resumable load ('begin_load()') starts: mark
+  // the entries to load pending (see 'mark_entries()'), or call 'cancel()'
+  // if there is nothing to load. Called by 'tick(aBudget)' until it returns
+  // true, on a call of its own every time, so work may be split into short
+  // steps. By default marks all registered entries
+  virtual bool OnBeginLoad() { mark_entries(false); return true; }
+  // Override to specify how a resumable save ('begin_save()') starts, as for
+  // 'OnBeginLoad()'. By default marks registered entries that changed since
+  // the last save or load
+  virtual bool OnBeginSave() { if (!mark_entries()) cancel(); return true; }
+  // Override to specify what completes a resumable load or save, once its
+  // last pending entry was processed. Called like 'OnBeginLoad()' until it
+  // returns true
+  virtual bool OnEndLoad() { return true; }
+  virtual bool OnEndSave() { return true; }
+  // Override to specify what to undo when a resumable pass is abandoned
+  // (see 'cancel()')
+  virtual void OnCancel() { /* Do Nothing */ }
+  // NOTE: the pass hooks must not call 'load()', 'save()' nor start a pass
+
+  // Load all registered entries from EEPROM
+  void load_entries();
+  // Save 'aEntry', letting 'flush()' know it is being written. Entries saved
+  // by overrides of 'OnSave()' and the pass hooks should go through it
+  void save_entry(EntryBase &aEntry);
+  // Returns true if 'flush()' preempted the running save: 'save_entries()'
+  // stops, and overrides of 'OnSave()' must skip what completes the save
+  // (checksums, commit records), as the flush wrote its own
+  inline bool preempted() const { return _preempted; }
+  // Mark all registered entries changed, so the next 'save()' compares all of
+  // them against EEPROM
+  void touch_entries();
+  // Save registered entries to EEPROM. If 'aDirtyOnly', entries that did not
+  // change since the last save or load are skipped without touching EEPROM.
+  void save_entries(bool aDirtyOnly = true);
+  // Same as 'load_entries()'/'save_entries()', against 'aShadow', a RAM copy
+  // of the first 'aSize' bytes of the storage (see
+  // 'EntryBase::load_shadowed()'/'save_shadowed()'). Entries outside of it
+  // or which cannot use it are loaded and saved by themselves
+  void load_entries(const uint8_t *aShadow, size_t aSize);
+  void save_entries(uint8_t *aShadow, size_t aSize, bool aDirtyOnly = true);
+  // Save dirty registered entries by priority, as long as their estimated
+  // programming time fits 'aBudget' microseconds. Returns the time spent
+  unsigned long flush_entries(unsigned long aBudget);
+  // Estimated microseconds 'save_entries(aDirtyOnly)' takes
+  unsigned long entries_save_time(bool aDirtyOnly = true) const;
+  // CRC-16 of RAM values of registered entries in issue order, 'aExcept'
+  // excluded. Costs no EEPROM access, unless 'aStoredDirty': then values of
+  // dirty entries are read from EEPROM instead
+  uint16_t entries_crc(const EntryBase *aExcept = NULL, bool aStoredDirty = false) const;
+  // Marks registered entries (changed ones only, if 'aDirtyOnly') pending
+  // for the pass being started. Returns the number of entries marked
+  size_t mark_entries(bool aDirtyOnly = true);
 
 public:
   // Create storage with default access
-  Storage() : _access(Access::instance()) { _last_issue = 0; }
+  Storage() : _access(Access::instance()), _last_issue(0), _save_time(0), _save_requested(false), _first_entry(NULL), _last_entry(NULL), _pass(Idle), _phase(_Begin), _cursor(NULL), _pass_entries(0), _pass_done(0), _current(NULL), _preempted(false) { /* Do Nothing */ }
   // Create storage with user-defined storage
-  Storage(Access &aAccess) : _access(aAccess) { _last_issue = 0; }
+  Storage(Access &aAccess) : _access(aAccess), _last_issue(0), _save_time(0), _save_requested(false), _first_entry(NULL), _last_entry(NULL), _pass(Idle), _phase(_Begin), _cursor(NULL), _pass_entries(0), _pass_done(0), _current(NULL), _preempted(false) { /* Do Nothing */ }
   virtual ~Storage() { /* Do Nothing */ }
 
-  // Create an 'Entry' object, issue an address for it and read EEPROM value into RAM
+  // Create an 'Entry' object, issue an address for it and read EEPROM value into RAM.
+  // The returned copy is not registered with the storage (see 'issue(Entry&)')
   // Example:
   //  Storage storage;
   //  Entry<int>   v1 = storage.issue<int>();   // v1.address() == 0; read it from EEPROM
@@ -59,38 +159,110 @@ public:
   //  v1.save(), v2.save();                        // Write values (0 and 0.f) to EEPROM
   template<typename T> inline Entry<T> issue(const T &aValue) {
     Entry<T> __entry(access(), _last_issue, aValue);
-    _advance_issue(sizeof(T));
+    _advance_issue(__entry.size);
     return __entry;
   }
 
-  // Initialize/reissue/recycle already existing 'Entry' object, issuing it an address
+  // Initialize/reissue/recycle already existing 'Entry' object, issuing it an
+  // address and registering it for 'load()'/'save()'. The entry must outlive
+  // the storage (e.g. be a member of it)
   // Example:
   //  Storage storage;
   //  Entry<int> v1;      // Create default/empty 'Entry' object with unknown RAM value
   //  v1.save();          // Does nothing, as the object cannot be used for EEPROM operations
   //  storage.issue(v1);  // Issue the object an address; object is ready for EEPROM operations
   //  v1.load();          // Read value from EEPROM to RAM
-  template<typename T> inline Entry<T>& issue(Entry<T> &aEntry) {
+  // Encoded entries are issued the most bytes their codec takes (see 'Codec')
+  //  Entry<long, VarintCodec<long, 2> > v2;
+  //  storage.issue(v2);  // Takes 2 bytes
+  template<typename T, class C> inline Entry<T, C>& issue(Entry<T, C> &aEntry) {
+    aEntry.set_access(&_access);
+    aEntry.set_address(_last_issue);
+    _advance_issue(aEntry.size);
+    _register(aEntry);
+    return aEntry;
+  }
+
+  // Initialize/reissue 'WearLeveledEntry' object, issuing it 'Slots' value
+  // slots and their status bytes
+  // Example:
+  //  Storage storage;
+  //  WearLeveledEntry<long, 8> uptime; // Takes 8 * (4 + 1) = 40 bytes
+  //  storage.issue(uptime);            // Issue the object an address
+  //  uptime.load();                    // Read the newest value from EEPROM to RAM
+  template<typename T, size_t Slots> inline WearLeveledEntry<T, Slots>& issue(WearLeveledEntry<T, Slots> &aEntry) {
+    aEntry.set_access(&_access);
+    aEntry.set_address(_last_issue);
+    _advance_issue(aEntry.size);
+    _register(aEntry);
+    return aEntry;
+  }
+
+  // Initialize/reissue 'MonotonicCounter' object, issuing it its base slots
+  // and 'Bytes' bytes of unary bits
+  // Example:
+  //  Storage storage;
+  //  MonotonicCounter<16> boots;       // Takes 2 + 8 + 16 = 26 bytes
+  //  storage.issue(boots);             // Issue the object an address
+  //  boots.load();                     // Read the stored count from EEPROM to RAM
+  template<size_t Bytes> inline MonotonicCounter<Bytes>& issue(MonotonicCounter<Bytes> &aEntry) {
+    aEntry.set_access(&_access);
+    aEntry.set_address(_last_issue);
+    _advance_issue(aEntry.size);
+    _register(aEntry);
+    return aEntry;
+  }
+
+  // Initialize/reissue 'EntryArray' object, issuing it 'N' elements
+  // Example:
+  //  Storage storage;
+  //  EntryArray<int16_t, 64> curve;    // Takes 64 * 2 = 128 bytes
+  //  storage.issue(curve);             // Issue the object an address
+  //  int16_t y = curve[10];            // Read element 10 from EEPROM to RAM
+  template<typename T, size_t N, size_t Window> inline EntryArray<T, N, Window>& issue(EntryArray<T, N, Window> &aEntry) {
     aEntry.set_access(&_access);
     aEntry.set_address(_last_issue);
     _advance_issue(aEntry.size);
+    _register(aEntry);
     return aEntry;
   }
 
   // Loads all values to RAM. The method by itself does nothing but calling
-  // the user-defined 'OnLoad()' method. It is up to the user to specify the
-  // loading process
-  inline void load() { OnLoad(); }
+  // the 'OnLoad()' method, which loads all registered entries unless
+  // overridden. A resumable pass in progress is finished first
+  inline void load() { finish(); OnLoad(); }
   // Saves all values to EEPROM. The method by itself does nothing but calling
-  // the user-defined 'OnSave()' method. It is up to the user to specify the
-  // saving process
-  inline void save() { OnSave(); }
+  // the 'OnSave()' method, which saves changed registered entries unless
+  // overridden. A resumable pass in progress is finished first
+  inline void save() { finish(); _preempted = false; OnSave(); }
   // Clears all values to their defaults. If 'aAutoSave' is true, then 'save()'
   // will be called after the clearing is done. The method by itself doesn't
   // nothing but calling the user-defined 'OnClaer()' method and then the 'save()'
   // method is requested. It is up to the user to specify the clearing process
   inline void clear(bool aAutoSave = true) { OnClear(); if (aAutoSave) save(); }
 
+  // Saves as much as 'aBudget' microseconds of EEPROM programming allow, for
+  // a power loss (e.g. from the brown-out or analog comparator interrupt,
+  // with the hold-up time left). Dirty entries are saved by priority (see
+  // 'EntryBase::priority()'), each only if its estimated programming time
+  // (see 'EntryBase::save_time()') still fits, so a large entry that does
+  // not fit lets smaller ones of lower priority through. Returns the
+  // estimated time spent; entries left out stay dirty.
+  // Does not wait for 'millis()' nor allocate, so it may be called from an
+  // interrupt with the native EEPROM (queued asynchronous bytes are written
+  // first and count against the budget). Devices whose drivers need
+  // interrupts (e.g. 'I2CDevice' on 'Wire') must be flushed from the main
+  // loop.
+  // An interrupt may preempt 'save()' or 'tick()': the entry they were
+  // writing (see 'save_entry()') is marked dirty and saved first, whatever
+  // its priority, as its bytes may be half programmed. Once the interrupt
+  // returns, the interrupted save finishes that entry and stops (a resumable
+  // one is cancelled); entries left out stay dirty for the next save.
+  // A load must not be preempted.
+  // Example:
+  //  ISR(ANALOG_COMP_vect) { storage.flush(20000); } // 20 ms of hold-up time
+  unsigned long flush(unsigned long aBudget);
+
   // Postpone save call for the specified delay time (see 'tick()' method).
   //   aDelay - After which period 'save()' should be called
   //   aRestartDelay - Overrides previously postponed and uncalled save with a new delay
@@ -105,14 +277,63 @@ public:
   inline unsigned long postpone_save_time() const { return _save_time; }
 
   // Must be called in the main program loop, in order to call 'save()' as per
-  // posponed save requests.
-  inline void tick() { if (_save_requested && _save_time <= millis()) save(), _save_requested = false; }
+  // posponed save requests. Also gives the device its background work time
+  // (see 'Access::tick()').
+  inline void tick() { _access.tick(); if (_save_requested && (long)(millis() - _save_time) >= 0) save(), _save_requested = false; }
+
+  // Starts a resumable load of all values (see 'OnBeginLoad()'), to be
+  // advanced by 'tick(aBudget)'. Entries are loaded one at a time in issue
+  // order; 'EntryBase::pending()' tells the ones not loaded yet. Do not
+  // change pending entries, the load overwrites them.
+  // A pass in progress is finished first
+  inline void begin_load() { _begin(Loading); }
+  // Starts a resumable save of changed values (see 'OnBeginSave()'), to be
+  // advanced by 'tick(aBudget)'. Entries changed again after they were saved
+  // stay dirty for the next save. A pass in progress is finished first
+  inline void begin_save() { _begin(Saving); }
+
+  // Cooperative version of 'tick()': gives the device its background work
+  // time, starts a postponed save as a resumable pass when it is due and
+  // advances the running pass for up to 'aBudget' microseconds. A save step
+  // runs only if its estimated programming time (see
+  // 'EntryBase::save_time()') still fits, a load step while time is left.
+  // At least one step runs per call once the device is ready (see
+  // 'Access::is_ready()'), so a call takes at most 'aBudget' or a single
+  // step, whichever is longer (loads may run over by the read of an entry):
+  // entries are never split. Steps of the pass hooks (see 'OnBeginLoad()')
+  // run on a call of their own. Returns the microseconds spent
+  // Example:
+  //  void loop() { storage.tick(2000); control(); } // Never blocks much over 2 ms
+  unsigned long tick(unsigned long aBudget);
+
+  // Runs the pass in progress to its end, like 'load()'/'save()' would
+  void finish();
+  // Abandons the pass in progress (see 'OnCancel()'). Entries left pending
+  // keep their RAM values (and stay dirty, if not saved)
+  void cancel();
+
+  // Pass in progress, see 'Pass'
+  inline Pass pass() const { return (Pass)_pass; }
+  // Returns true while a resumable pass is in progress
+  inline bool busy() const { return _pass != Idle; }
+  // Returns true while a resumable load is in progress: RAM values of
+  // entries mix old values and loaded ones until it is done
+  inline bool loading() const { return _pass == Loading; }
+  // Returns true while a resumable save is in progress: EEPROM holds new
+  // values of some entries only until it is done
+  inline bool saving() const { return _pass == Saving; }
+  // Progress of the pass in progress in percent, 100 when idle
+  inline uint8_t progress() const { return _pass == Idle ? 100 : (uint8_t)((unsigned long)_pass_done * 100 / (_pass_entries + 1)); }
 
   inline Access& access() { return _access; }
   inline const Access& access() const { return _access; }
 
   // Returns the amount of bytes issued to entries.
   inline size_t size() const { return _last_issue; }
+
+  // Returns true if any registered entry (any critical one with
+  // 'aCriticalOnly') changed since the last save or load
+  bool dirty(bool aCriticalOnly = false) const;
 };
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
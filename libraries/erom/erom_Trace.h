@@ -0,0 +1,202 @@
+#ifndef _ROBODEM_EROM_TRACE_H_
+#define _ROBODEM_EROM_TRACE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Define 'EROM_TRACE' to make 'Access' record every read, write and update
+// into a binary stream (see 'erom::Trace'), for 'extras/trace/replay.cpp' to
+// replay against a simulated EEPROM. Without it the instrumentation compiles
+// to nothing. Set through compiler flags, so the library and the sketch see
+// the same value.
+//
+// A record is, with 'varint' being 7 bits per byte, low first, the high bit
+// set on all bytes but the last:
+//   [kind << 6 | tag] [varint microseconds since the previous record]
+//   [varint address] [varint size]
+// followed, for writes and updates, by
+//   [varint bytes changed] [size bytes of data]
+// Kinds are 'Trace::Kind', tags the call site tag (0 .. 63, see
+// 'Trace::Tag'). Addresses are physical (base-adjusted), as in 'Stats'.
+// Updates are recorded as one record, not as the reads and writes they
+// are made of; estimates ('update_time()') record their reads only.
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Receives trace records, see 'TraceStream' and 'TraceRing'. A record comes
+// as its encoded head and the data bytes following it, if any
+class TraceOutput {
+public:
+  virtual ~TraceOutput() { /* Do Nothing */ }
+  virtual void record(const uint8_t *aHead, size_t aHeadSize, const uint8_t *aData, size_t aDataSize) = 0;
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Sends records as they come to 'Serial' or any other object with
+// Arduino-like 'write(const uint8_t*, size_t)'.
+// Example:
+//  erom::TraceStream<HardwareSerial> trace(Serial);
+//  erom::Trace::begin(trace);
+template<class S> class TraceStream : public TraceOutput {
+private:
+  S &_stream;
+
+public:
+  TraceStream(S &aStream) : _stream(aStream) { /* Do Nothing */ }
+
+  virtual void record(const uint8_t *aHead, size_t aHeadSize, const uint8_t *aData, size_t aDataSize) {
+    _stream.write(aHead, aHeadSize);
+    if (aDataSize) _stream.write(aData, aDataSize);
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Keeps the newest records in RAM: the oldest whole records make room for a
+// new one, a record larger than the ring is dropped. Every record takes 2
+// bytes of length besides its own. 'dump()' the stream later, e.g. after a
+// fault was detected.
+class TraceRingBase : public TraceOutput {
+private:
+  uint8_t *_data;
+  size_t _size;
+  size_t _tail, _used;      // Oldest record, bytes held
+  unsigned long _dropped;   // Records dropped or pushed out
+
+  inline uint8_t _at(size_t aOffset) const { return _data[(_tail + aOffset) % _size]; }
+  void _put(const uint8_t *aData, size_t aSize);
+
+protected:
+  TraceRingBase(uint8_t *aData, size_t aSize) : _data(aData), _size(aSize), _tail(0), _used(0), _dropped(0) { /* Do Nothing */ }
+
+public:
+  virtual void record(const uint8_t *aHead, size_t aHeadSize, const uint8_t *aData, size_t aDataSize);
+
+  // Writes the records held, oldest first, to 'aOut' (any object with
+  // Arduino-like 'write(uint8_t)'), in the stream format
+  template<class S> void dump(S &aOut) const {
+    for (size_t __offset = 0; __offset < _used; ) {
+      size_t __size = _at(__offset) | (size_t)_at(__offset + 1) << 8;
+      for (size_t __i = 0; __i < __size; __i++) aOut.write(_at(__offset + 2 + __i));
+      __offset += 2 + __size;
+    }
+  }
+
+  inline void clear() { _tail = _used = 0; }
+  // Bytes held, records lost since start
+  inline size_t used() const { return _used; }
+  inline unsigned long dropped() const { return _dropped; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'TraceRingBase' of 'Size' bytes.
+// Example:
+//  erom::TraceRing<256> trace;
+//  erom::Trace::begin(trace);
+//  ...
+//  if (fault) trace.dump(Serial);
+template<size_t Size> class TraceRing : public TraceRingBase {
+private:
+  typedef char _size_check[Size > 2 && Size <= 0xFFFF ? 1 : -1];
+
+  uint8_t _buffer[Size];
+
+public:
+  TraceRing() : TraceRingBase(_buffer, Size) { /* Do Nothing */ }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#ifdef EROM_TRACE
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Records the EEPROM traffic of all 'Access' objects into a 'TraceOutput'.
+// Nothing is recorded until 'begin()'. Tag call sites with 'Trace::Tag' to
+// tell apart the code paths writing in the replay report.
+// Example (build with -DEROM_TRACE):
+//  erom::TraceStream<HardwareSerial> trace(Serial);
+//  erom::Trace::begin(trace);
+//  ...
+//  { erom::Trace::Tag __tag(3); settings.save(); }  // Recorded with tag 3
+class Trace {
+public:
+  enum Kind { Read = 0, Write = 1, Update = 2 };
+  enum { max_tag = 63 };
+
+  // Sets the tag of records made during the lifetime of the object
+  class Tag {
+  private:
+    uint8_t _previous;
+  public:
+    Tag(uint8_t aTag) : _previous(Trace::_tag) { Trace::tag(aTag); }
+    ~Tag() { Trace::_tag = _previous; }
+  };
+
+  // Keeps 'read()'/'write()' from recording during the lifetime of the
+  // object, if 'aMute'
+  class Mute {
+  private:
+    bool _mute;
+  public:
+    Mute(bool aMute) : _mute(aMute) { if (_mute) Trace::_muted++; }
+    ~Mute() { if (_mute) Trace::_muted--; }
+  };
+
+private:
+  friend class Tag;
+  friend class Mute;
+
+  static TraceOutput *_output;
+  static uint8_t _tag, _muted;
+  static unsigned long _last;
+
+  static unsigned long clock();
+  static void _record(Kind aKind, size_t aAddress, size_t aSize, const void *aData, size_t aChanged);
+
+public:
+  static inline void begin(TraceOutput &aOutput) { _output = &aOutput, _last = clock(); }
+  static inline void end() { _output = NULL; }
+  static inline bool active() { return _output != NULL; }
+
+  // Tag of records made from now on
+  static inline uint8_t tag() { return _tag; }
+  static inline void tag(uint8_t aTag) { _tag = aTag <= max_tag ? aTag : (uint8_t)max_tag; }
+
+  // Recording hooks, called by 'Access'
+  static inline void read(size_t aAddress, size_t aSize) { if (_output && !_muted) _record(Read, aAddress, aSize, NULL, 0); }
+  static inline void write(size_t aAddress, const void *aData, size_t aSize) { if (_output && !_muted) _record(Write, aAddress, aSize, aData, aSize); }
+  static inline void update(size_t aAddress, const void *aData, size_t aSize, size_t aChanged) { if (_output) _record(Update, aAddress, aSize, aData, aChanged); }
+};
+
+#endif // EROM_TRACE
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+#ifdef EROM_TRACE
+
+#define EROM_TRACE_READ(aAddress, aSize)                    erom::Trace::read(aAddress, aSize)
+#define EROM_TRACE_WRITE(aAddress, aData, aSize)            erom::Trace::write(aAddress, aData, aSize)
+#define EROM_TRACE_UPDATE(aAddress, aData, aSize, aChanged) erom::Trace::update(aAddress, aData, aSize, aChanged)
+#define EROM_TRACE_MUTE(aMute)                              erom::Trace::Mute __trace_mute(aMute)
+#define EROM_TRACE_TAG(aTag)                                erom::Trace::Tag __trace_tag(aTag)
+
+#else // EROM_TRACE
+
+#define EROM_TRACE_READ(aAddress, aSize)
+#define EROM_TRACE_WRITE(aAddress, aData, aSize)
+#define EROM_TRACE_UPDATE(aAddress, aData, aSize, aChanged)
+#define EROM_TRACE_MUTE(aMute)
+#define EROM_TRACE_TAG(aTag)
+
+#endif // EROM_TRACE
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_TRACE_H_
@@ -5,40 +5,101 @@
 
 #include "erom_Access.h"
 #include "erom_Entry.h"
+#include "erom_Layout.h"
 #include "erom_Storage.h"
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 
 namespace erom {
 
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Converts an old field value into its new type by assignment: a grown
+// integer is sign or zero extended, an unchanged struct copied. Overload it
+// next to struct types that changed, e.g.
+//  inline void migrate_value(NameV2 &aTo, const NameV1 &aFrom) { memcpy(aTo.text, aFrom.text, sizeof(aFrom.text)); }
+template<typename T, typename O> inline void migrate_value(T &aTo, const O &aFrom) { aTo = aFrom; }
+
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 // EEPROM storage management, inherits the 'Storage' class and is used to
 // verify whether data currently stored in EEPROM is valid and can be used by
 // the running application/sketch.
+//
+// With 'aChecksum' the header also holds a CRC-16 of all entry values,
+// updated by every 'save()' from RAM values (no EEPROM reads). Use
+// 'load_verified()' at startup: it loads the header and all entries in a
+// single pass over EEPROM and checks the header and the CRC, so corrupt or
+// half-saved data is detected instead of being used silently.
+// NOTE: the checksum takes 2 more header bytes, so switching it on changes
+// the EEPROM layout; bump the version when doing so. As the checksum is
+// computed from RAM, all entries must be loaded or cleared before saving.
+//
+// Data of an older version of the same application is migrated instead of
+// cleared, if 'OnMigrate()' knows the version: entries get their 'OnClear()'
+// defaults, 'OnMigrate()' reads the old fields into them (declare each old
+// version as a 'Layout' starting after the header, i.e. at 8, or 10 with the
+// checksum), then all entries are saved, writing only bytes that differ.
+// Example:
+//  class Settings : public erom::VerifiedStorage {
+//  protected:
+//    virtual void OnClear() { VerifiedStorage::OnClear(); speed = 10; }
+//  public:
+//    erom::Entry<int> speed;
+//    Settings() : VerifiedStorage(0x0001, 0x0002, true) { issue(speed); }
+//  } settings;
+//
+//  settings.load_verified(true); // Load, or reinitialize if not valid
+//
+//  // Version 1 stored 'speed' as an 'int8_t' after a 'uint16_t' now gone
+//  typedef erom::Layout<8, uint16_t, int8_t> SettingsV1;
+//  virtual bool OnMigrate(uint16_t aVersion) {
+//    if (aVersion != 0x0001) return false;           // Clear other versions
+//    migrate<SettingsV1, 1>(speed);
+//    return true;
+//  }
 class VerifiedStorage : public Storage {
 public:
   static const uint32_t storage_header_value = 0xDEADBEEF;
 
 private:
   const uint16_t _app_id, _version;
+  const bool _checksum;
 
   Entry<uint32_t> _header;
   Entry<uint16_t> _stored_app_id, _stored_version;
+  Entry<uint16_t> _stored_crc;   // Issued with 'aChecksum' only
 
   inline void _load_header() { _header.load(); _stored_app_id.load(); _stored_version.load(); }
-  inline void _save_header() { _header.save(); _stored_app_id.save(); _stored_version.save(); }
   inline void _clear_header() { _header = storage_header_value; _stored_app_id  = app_id(); _stored_version = version(); }
 
+  // Migrates data stored by another version of the application, see
+  // 'OnMigrate()'. Returns false if there is none or it is not known
+  bool _migrate();
+
 protected:
   // Override to specify how to load your entries from EEPROM.
   // NOTE: when overridden, 'VerifiedStorage::OnLoad()' must be called by user
   // in order for 'VerifiedStorage' to work properly
-  virtual void OnLoad()  { Storage::OnLoad();   _load_header(); }
+  virtual void OnLoad()  { Storage::OnLoad(); }
 
-  // Override to specify how to save your entries to EEPROM.
+  // Override to specify how to save your entries to EEPROM. Updates the
+  // checksum last, if enabled.
   // NOTE: when overridden, 'VerifiedStorage::OnSave()' must be called by user
   // in order for 'VerifiedStorage' to work properly
-  virtual void OnSave()  { Storage::OnSave();   _save_header(); }
+  virtual void OnSave();
+
+  // Override to specify how to save your entries on a power loss. With the
+  // checksum enabled, it is updated last to match what EEPROM holds, entries
+  // left out included.
+  // NOTE: when overridden, 'VerifiedStorage::OnFlush()' must be called by
+  // user in order for 'VerifiedStorage' to work properly
+  virtual unsigned long OnFlush(unsigned long aBudget);
+
+  // Completes a resumable save ('begin_save()'). With the checksum enabled,
+  // it is updated last over what EEPROM holds, entries changed again during
+  // the save included.
+  // NOTE: when overridden, 'VerifiedStorage::OnEndSave()' must be called by
+  // user in order for 'VerifiedStorage' to work properly
+  virtual bool OnEndSave();
 
   // Override to specify how to clear/initialize RAM values with default data.
   // NOTE: when overridden, 'VerifiedStorage::OnClear()' must be called by user
@@ -51,18 +112,37 @@ protected:
   // in order for 'VerifiedStorage' to work properly
   virtual bool OnVerify(uint16_t aAppID, uint16_t aVersion) { return aAppID == app_id() && aVersion == version(); }
 
+  // Override to migrate EEPROM data of version 'aVersion' of the application
+  // instead of clearing it, when 'verify()' or 'load_verified()' are asked
+  // to clear invalid data. Called with RAM values cleared by 'OnClear()' and
+  // nothing written yet: read the old fields into entries (see 'migrate()'),
+  // convert values as needed, 'load()' entries that did not move. Return
+  // false if 'aVersion' is not known; the data is cleared then.
+  virtual bool OnMigrate(uint16_t /* aVersion */) { return false; }
+
+  // Reads field 'Index' of 'Schema' (the 'Layout' of an older version) into
+  // 'aEntry', converting it with 'migrate_value()'. Returns true upon success
+  template<class Schema, int Index, typename T, class C> bool migrate(Entry<T, C> &aEntry) {
+    typename Schema::template field<Index>::type __old;
+    if (!access().read_block(Schema::template field<Index>::address, __old)) return false;
+    migrate_value(aEntry.value, __old);
+    aEntry.touch();
+    return true;
+  }
+
 public:
   // Create 'VerifiedStorage' with specified Application ID and Version Number
-  // for use with default access.
-  VerifiedStorage(uint16_t aAppID, uint16_t aVersion);
+  // for use with default access. 'aChecksum' adds a CRC of entry values.
+  VerifiedStorage(uint16_t aAppID, uint16_t aVersion, bool aChecksum = false);
 
   // Create 'VerifiedStorage' with specified Application ID and Version Number
-  // for use with user-defined access.
-  VerifiedStorage(Access &aAccess, uint16_t aTargetAppID, uint16_t aTargetVersion);
+  // for use with user-defined access. 'aChecksum' adds a CRC of entry values.
+  VerifiedStorage(Access &aAccess, uint16_t aTargetAppID, uint16_t aTargetVersion, bool aChecksum = false);
 
   // Verify storage version (AppID and VersionNo). If 'aAutoClear', 'verify'
   // will call 'clear' method, in order to reinitialize variables in RAM and
-  // stored cleared RAM values to EEPROM.
+  // stored cleared RAM values to EEPROM (or migrate data of an older
+  // version, see 'OnMigrate()').
   // Returns true, if EEPROM data header suits currently running
   // application/sketch verification rules.
   // To define verification rules, one must override the 'OnVerify()' method.
@@ -71,6 +151,15 @@ public:
   //          Mind calling 'load()' upon successful verification.
   bool verify(bool aAutoClear = false);
 
+  // Load all entries (header included) and verify them in a single pass over
+  // EEPROM: header rules as for 'verify()', plus the stored checksum if
+  // enabled. If 'aAutoClear', invalid data is cleared and stored.
+  // Returns true, if loaded data is valid.
+  bool load_verified(bool aAutoClear = false);
+
+  // Returns true if entry values are protected by a checksum
+  inline bool checksum() const { return _checksum; }
+
   // Currently running application/sketch AppID and VersionNo
   inline uint16_t app_id()  const { return _app_id;  }
   inline uint16_t version() const { return _version; }
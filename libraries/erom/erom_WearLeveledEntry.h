@@ -0,0 +1,146 @@
+#ifndef _ROBODEM_EROM_WEAR_LEVELED_ENTRY_H_
+#define _ROBODEM_EROM_WEAR_LEVELED_ENTRY_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <string.h>
+#include "erom_Access.h"
+#include "erom_Entry.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// An 'Entry' for frequently saved values (counters, uptime, etc.). Every save
+// goes to the next of 'Slots' copies, so each EEPROM cell is written 'Slots'
+// times less often than with a plain 'Entry'.
+//
+// EEPROM layout: 'Slots' status bytes followed by 'Slots' values.
+//   [status 0 .. status N-1][value 0 .. value N-1]
+// A save writes the value into the slot following the newest one and only
+// then increments the status byte of that slot, so a power loss in the middle
+// of a save leaves the previous value intact. The newest slot is the one
+// whose successor's status does not follow it in sequence; it is found with
+// a single scan of the status bytes at 'load()' time.
+// Example:
+//  erom::WearLeveledEntry<long, 8> uptime(0); // Takes 8 * (4 + 1) = 40 bytes
+//  uptime += 15000;
+//  uptime.save();                             // Writes 5 bytes of the 40
+template<typename T, size_t Slots> class WearLeveledEntry : public Entry<T, RawCodec<T> > {
+friend class Storage;
+
+public:
+  typedef T type;
+  enum { slots = Slots, size = Slots * (sizeof(type) + 1) };
+
+private:
+  // Slots must fit the status byte sequence
+  typedef char _slots_check[(Slots > 1 && Slots < 256) ? 1 : -1];
+
+  static const uint8_t unknown_slot = 0xFF;
+  uint8_t _slot;      // Newest slot, 'unknown_slot' if not scanned yet
+
+  inline size_t _status_address(uint8_t aSlot) const { return this->address() + aSlot; }
+  inline size_t _value_address(uint8_t aSlot) const { return this->address() + Slots + aSlot * sizeof(type); }
+
+  // Finds the newest slot
+  uint8_t _newest() const {
+    if (_slot != unknown_slot) return _slot;
+    uint8_t __slot, __status = this->get_access()->read_byte(_status_address(0));
+    for (__slot = 0; __slot < Slots - 1; __slot++) {
+      uint8_t __next = this->get_access()->read_byte(_status_address(__slot + 1));
+      if (__next != (uint8_t)(__status + 1)) break;
+      __status = __next;
+    }
+    return __slot;
+  }
+  inline void _scan() { _slot = unknown_slot; _slot = _newest(); }
+
+protected:
+  inline void set_address(size_t aAddress) { Entry<T, RawCodec<T> >::set_address(aAddress); _slot = unknown_slot; }
+
+public:
+  // Create a null referenced entry. It wont' be able to interact with EEPROM.
+  // Used in 'Storage'.
+  WearLeveledEntry() : Entry<T, RawCodec<T> >(), _slot(unknown_slot) { /* Do Nothing */ }
+  // Create a referenced entry with default access (Access::instance()) with
+  // manually defined address. Initializes RAM value with the newest one in EEPROM.
+  WearLeveledEntry(size_t aAddress) : Entry<T, RawCodec<T> >() { this->set_access(&Access::instance()); set_address(aAddress); load(); }
+  // Create a referenced entry with default access (Access::instance()) with
+  // manually defined address. Initialized RAM value with aValue.
+  WearLeveledEntry(size_t aAddress, const type &aValue) : Entry<T, RawCodec<T> >(aAddress, aValue), _slot(unknown_slot) { /* Do Nothing */ }
+  // Create a referenced entry with given access and manually defined address.
+  // Initializes RAM value with the newest one in EEPROM.
+  WearLeveledEntry(Access &aAccess, size_t aAddress) : Entry<T, RawCodec<T> >() { this->set_access(&aAccess); set_address(aAddress); load(); }
+  // Create a referenced entry with given access and manually defined address
+  // and initializes RAM value with with aValue.
+  WearLeveledEntry(Access &aAccess, size_t aAddress, const type &aValue) : Entry<T, RawCodec<T> >(aAccess, aAddress, aValue), _slot(unknown_slot) { /* Do Nothing */ }
+
+  inline WearLeveledEntry& operator=(const type &aValue) { this->value = aValue; this->touch(); return *this; }
+  inline WearLeveledEntry& assign(const type &aValue) { this->value = aValue; this->touch(); return *this; }
+
+  // Write RAM value into the next slot. Nothing is written if the value equals
+  // the newest stored one, unless aFullWrite is true. Stays dirty, the
+  // newest slot unchanged, if the write queue has no room for the slot and
+  // its status byte (see 'Access::queue_policy()').
+  // aFullWrite - if true, all data will be written, otherwise changes only
+  virtual void save(bool aFullWrite = false) {
+    if (!this->get_access()) return;
+    if (_slot == unknown_slot) _scan();
+
+    if (!aFullWrite) {
+      type __stored;
+      this->get_access()->read_block(_value_address(_slot), __stored);
+      if (!memcmp(&__stored, &this->value, sizeof(type))) { this->_dirty = false; return; }
+    }
+    if (!this->get_access()->fits(sizeof(type) + 1)) return;
+
+    uint8_t __status = this->get_access()->read_byte(_status_address(_slot));
+    uint8_t __next = (_slot + 1) % Slots;
+    if (aFullWrite) this->get_access()->write_block(_value_address(__next), this->value);
+    else this->get_access()->update_block(_value_address(__next), this->value);
+    this->get_access()->write_byte(_status_address(__next), __status + 1);
+    _slot = __next;
+    this->_dirty = false;
+  }
+
+  // Estimated microseconds 'save()' takes: the next slot and its status
+  // byte, unless the newest slot holds the RAM value already
+  virtual unsigned long save_time() const {
+    if (!this->get_access()) return 0;
+    uint8_t __slot = _newest();
+    if (!this->get_access()->update_time(_value_address(__slot), this->value)) return 0;
+    uint8_t __next = (__slot + 1) % Slots;
+    return this->get_access()->update_time(_value_address(__next), this->value) + this->get_access()->write_time(_status_address(__next), 1);
+  }
+
+  // Continue CRC-16 'aCrc' over the newest stored value
+  virtual uint16_t stored_crc16(uint16_t aCrc) const {
+    return this->get_access() ? this->get_access()->crc16(_value_address(_newest()), sizeof(type), aCrc) : aCrc;
+  }
+
+  // Load the newest value from EEPROM to RAM
+  virtual void load() {
+    if (!this->get_access()) return;
+    _scan();
+    this->get_access()->read_block(_value_address(_slot), this->value);
+    this->_dirty = false;
+  }
+
+  // Slots are not a flat copy of the value: always saved and loaded by
+  // 'save()' and 'load()'
+  virtual bool save_shadowed(uint8_t * /* aShadow */, size_t /* aSize */) { return false; }
+  virtual bool load_shadowed(const uint8_t * /* aShadow */, size_t /* aSize */) { return false; }
+
+  // Slot holding the newest value (valid after 'load()' or 'save()')
+  inline uint8_t slot() const { return _slot; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_WEAR_LEVELED_ENTRY_H_
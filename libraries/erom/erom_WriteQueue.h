@@ -0,0 +1,79 @@
+#ifndef _ROBODEM_EROM_WRITE_QUEUE_H_
+#define _ROBODEM_EROM_WRITE_QUEUE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <inttypes.h>
+#include <stddef.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Amount of bytes the asynchronous write queue can hold (up to 255). Every
+// pending byte takes 'sizeof(size_t) + 1' bytes of RAM. Override through
+// compiler flags, so the library and the sketch see the same value.
+#ifndef EROM_WRITE_QUEUE_SIZE
+#define EROM_WRITE_QUEUE_SIZE 32
+#endif
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+namespace erom {
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Bounded RAM ring buffer of bytes waiting to be programmed into EEPROM.
+// Used by 'Access' in asynchronous mode (see 'Access::async()'): writes are
+// queued and drained one byte at a time by the EE_READY interrupt, so the
+// caller does not busy-wait ~3.4 ms per byte.
+// There is a single queue, since there is a single EEPROM controller, and it
+// works with physical (base-adjusted) addresses.
+class WriteQueue {
+public:
+  // What to do when a byte must be queued but there is no free room
+  enum Policy {
+    WaitOnFull,   // Busy-wait until the interrupt drains a byte (default)
+    RejectOnFull  // Do not queue anything, make the write method fail
+  };
+
+  enum { capacity = EROM_WRITE_QUEUE_SIZE };
+
+private:
+  static volatile size_t  _address[capacity];
+  static volatile uint8_t _value[capacity];
+  static volatile uint8_t _head, _count;
+
+  static int  _find(size_t aAddress);
+  static bool _put(size_t aAddress, uint8_t aValue);
+  static void _drain();
+
+public:
+  // Queue 'aSize' bytes for writing at physical address 'aAddress'. Bytes
+  // already pending for the same address are overwritten in place, so
+  // repeated writes of the same cell cost a single programming cycle.
+  // Returns false if the data was not queued (full queue and 'RejectOnFull'
+  // policy; the whole block is rejected, nothing is queued)
+  static bool push(size_t aAddress, const void *aData, size_t aSize, Policy aPolicy = WaitOnFull);
+
+  // Reads 'aSize' bytes from physical address 'aAddress' with pending bytes
+  // overlaid, so reads stay coherent with queued writes. The interrupt is
+  // held off for the duration of the read, as the EEPROM cannot be read while
+  // a byte is being programmed.
+  static void read(size_t aAddress, void *aData, size_t aSize);
+
+  // Programs the oldest pending byte into EEPROM. Called by the EE_READY
+  // interrupt; must not be called while EEPROM is busy.
+  static void service();
+
+  // Blocks until every pending byte has been programmed into EEPROM
+  static void flush();
+
+  // Amount of bytes waiting to be written and amount of free room left
+  static size_t pending();
+  static inline size_t available() { return capacity - pending(); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+} // namespace erom
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_WRITE_QUEUE_H_
@@ -0,0 +1,107 @@
+#include <Arduino.h>
+#include <erom.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+const size_t eeprom_data_sz      = 21;
+byte eeprom_data[eeprom_data_sz] = { "Robodem EEPROM test." };
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void scramble_data() {
+  for (size_t __i = 0; __i < eeprom_data_sz - 1; __i++)
+    eeprom_data[__i] = random('!', '~');
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void write_eeprom(bool aAsync) {
+  scramble_data();
+  erom::access.async(aAsync);
+
+  unsigned long __start = micros();
+  erom::access.write_block(0, eeprom_data);
+  unsigned long __blocked = micros() - __start;
+
+  Serial.print(aAsync ? "Asynchronous" : "Synchronous");
+  Serial.print(" write of ");
+  Serial.print(eeprom_data_sz);
+  Serial.print(" bytes blocked for ");
+  Serial.print(__blocked);
+  Serial.print("us, bytes pending: ");
+  Serial.println(erom::access.pending());
+
+  __start = micros();
+  erom::access.flush();
+  Serial.print("Waited for the queue to drain: ");
+  Serial.print(micros() - __start);
+  Serial.println("us");
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void read_eeprom() {
+  Serial.print("EEPROM data is (");
+  Serial.print(eeprom_data_sz);
+  Serial.print(" bytes): ");
+
+  for (size_t __i = 0; __i < eeprom_data_sz; __i++) {
+    char __c = (char)erom::access.read_byte(__i);
+    Serial.print(__c < 32 ? '.' : __c);
+  }
+
+  Serial.println();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void print_help() {
+  Serial.println("Usage:");
+  Serial.println(" A - write random data asynchronously (queued)");
+  Serial.println(" R - read EEPROM memory");
+  Serial.println(" S - write random data synchronously");
+  Serial.println("\n\n");
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void show_help() {
+  static bool _do_show = true;
+  if (_do_show) print_help(), _do_show = false;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void serialEvent() {
+  if (Serial.available() > 0) {
+    char __c = toupper(Serial.read());
+    switch (__c) {
+      case 'A': write_eeprom(true);  break;
+      case 'R': read_eeprom();       break;
+      case 'S': write_eeprom(false); break;
+      default: show_help();
+    }
+
+    while (Serial.available() > 0) Serial.read();
+    delay(500);
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.print("EEPROM Size: "); Serial.println(erom::Access::device_memory_size());
+  Serial.print("Write queue size: "); Serial.println(erom::WriteQueue::capacity);
+  while (Serial.available() > 0) Serial.read();
+  randomSeed(analogRead(A0) * analogRead(A1) * analogRead(A2) * analogRead(A3));
+
+  print_help();
+  read_eeprom();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
@@ -0,0 +1,71 @@
+#include <Arduino.h>
+#include <erom.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Define a 'BankedStorage' class that will manage EEPROM related data.
+// Every save goes to the inactive one of two banks and is committed last, so
+// pulling the plug in the middle of 'save()' brings back the previous values
+// on the next start, never a mix of old and new ones.
+class Storage : public erom::BankedStorage {
+protected:
+  virtual void OnClear() { boots = 0; volume = 0.5f; brightness = 128; }
+
+public:
+  // Storage data/variables
+  erom::Entry<long>  boots;
+  erom::Entry<float> volume;
+  erom::Entry<short> brightness;
+
+  // Two banks of 16 bytes each, the entries take 10 of them
+  Storage() : BankedStorage(16) { issue(boots); issue(volume); issue(brightness); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Create 'storage' object for managing data
+Storage storage;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  // Initialize hardware
+  Serial.begin(115200);
+  pinMode(A0, INPUT);
+  pinMode(A1, INPUT);
+  delay(3000);
+
+  // Load the newest committed bank into RAM, initialize if there is none
+  storage.load();
+  if (!storage.valid()) {
+    Serial.println("No committed bank found, initializing...");
+    storage.clear(false);
+  }
+
+  // Print loaded data
+  Serial.print("Bank: ");
+  Serial.print(storage.active_bank());
+  Serial.print(", generation: ");
+  Serial.println(storage.generation());
+  Serial.print("Boots: ");
+  Serial.println(storage.boots);
+  Serial.print("Original volume: ");
+  Serial.println(storage.volume);
+  Serial.print("Original brightness: ");
+  Serial.println(storage.brightness);
+  Serial.println("-----------------------");
+
+  // Give storage data new values
+  ++storage.boots;
+  storage.volume = analogRead(A0) / 1024.f;
+  storage.brightness = map(analogRead(A1), 0, 1024, 0, 255);
+
+  // Store new data to the inactive bank and commit it
+  storage.save();
+  Serial.print("Saved to bank ");
+  Serial.print(storage.active_bank());
+  Serial.print(", generation: ");
+  Serial.println(storage.generation());
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { }
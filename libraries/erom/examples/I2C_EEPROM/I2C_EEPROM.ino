@@ -0,0 +1,61 @@
+#include <Arduino.h>
+#include <Wire.h>
+#include <erom.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// External 24LC256 (32 KB, 64 byte pages) at I2C address 0x50, and an access
+// engine working with it instead of the chip's own EEPROM
+erom::I2CDevice<TwoWire> chip(Wire, 0x50, 32768, 64);
+erom::Access external(chip);
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Storage kept in the external chip
+class Storage : public erom::Storage {
+protected:
+  virtual void OnClear() { boots = 0; for (int __i = 0; __i < 16; __i++) samples[__i] = 0; }
+
+public:
+  erom::Entry<long> boots;
+  erom::Entry<int>  samples[16];
+
+  Storage() : erom::Storage(external) {
+    issue(boots);
+    for (int __i = 0; __i < 16; __i++) issue(samples[__i]);
+  }
+};
+
+Storage storage;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  Serial.begin(115200);
+  Wire.begin();
+  chip.combine(true);   // Collect neighbouring entries into one burst
+  pinMode(A0, INPUT);
+  delay(1000);
+
+  storage.load();
+  Serial.print("Boots: ");
+  Serial.println(storage.boots);
+
+  // Entries are saved one by one; combined, neighbouring ones are programmed
+  // in a single write cycle, sent by 'flush()'
+  ++storage.boots;
+  for (int __i = 0; __i < 16; __i++) storage.samples[__i] = analogRead(A0);
+
+  unsigned long __cycles = chip.write_cycles();
+  unsigned long __time = micros();
+  storage.save();
+  external.flush();
+  Serial.print("Saved in ");
+  Serial.print(chip.write_cycles() - __cycles);
+  Serial.print(" write cycles, ");
+  Serial.print(micros() - __time);
+  Serial.println(" us");
+  if (chip.errors()) Serial.println("I2C errors occurred, check wiring!");
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { }
@@ -0,0 +1,64 @@
+#include <Arduino.h>
+#include <erom.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Configuration keys. New keys can be added and old ones dropped in later
+// firmware versions; values of the other keys are kept.
+enum {
+  KeyBoots,
+  KeyVolume,
+  KeyName,
+  KeyCount
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Create 'config' store for 'KeyCount' keys in EEPROM 0..255. Every change is
+// appended to a log, so writes move through all 256 bytes.
+erom::KVStore<KeyCount> config(0, 256);
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  // Initialize hardware
+  Serial.begin(115200);
+  pinMode(A0, INPUT);
+  delay(3000);
+
+  // Scan the log and index the keys, initialize if there is none
+  if (!config.load()) Serial.println("No log found, initializing...");
+
+  // Missing keys leave the defaults in place
+  long boots = 0;
+  float volume = 0.5f;
+  char name[16] = "erom";
+  config.get(KeyBoots, boots);
+  config.get(KeyVolume, volume);
+  config.read(KeyName, name, sizeof(name) - 1);
+
+  // Print loaded data
+  Serial.print("Boots: ");
+  Serial.println(boots);
+  Serial.print("Original volume: ");
+  Serial.println(volume);
+  Serial.print("Name: ");
+  Serial.println(name);
+  Serial.print("Log: ");
+  Serial.print(config.used());
+  Serial.print(" of ");
+  Serial.print(config.capacity());
+  Serial.print(" bytes, sequence ");
+  Serial.println(config.sequence());
+  Serial.println("-----------------------");
+
+  // Store new values; the name did not change, so it is not written again
+  config.put(KeyBoots, boots + 1);
+  config.put(KeyVolume, analogRead(A0) / 1024.f);
+  config.write(KeyName, name, strlen(name) + 1);
+  Serial.print("Saved, log: ");
+  Serial.print(config.used());
+  Serial.println(" bytes");
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { }
@@ -0,0 +1,49 @@
+#include <Arduino.h>
+#include <erom.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// EEPROM layout resolved at compile time: every address is a constant and
+// each entry takes no more RAM than its value. Compilation fails if the
+// layout does not fit the chip's EEPROM.
+typedef erom::Layout<0, uint16_t, long, erom::Aligned<float, 4> > Schema;
+
+erom::StaticEntry<Schema, 0> boots;
+erom::StaticEntry<Schema, 1> uptime;
+erom::StaticEntry<Schema, 2> temperature;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  Serial.begin(115200);
+  delay(1000);
+
+  Serial.print("Layout size: ");
+  Serial.print(Schema::size);
+  Serial.print(" bytes, RAM taken by entries: ");
+  Serial.println(sizeof(boots) + sizeof(uptime) + sizeof(temperature));
+
+  // Each load/save is a single block transfer from/to a constant address
+  boots.load(); uptime.load(); temperature.load();
+
+  Serial.print("Boots: ");
+  Serial.println(boots.value);
+  Serial.print("Uptime at last save: ");
+  Serial.println(uptime.value);
+  Serial.print("Temperature: ");
+  Serial.println(temperature.value);
+
+  ++boots;
+  boots.save();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() {
+  static unsigned long __save_time = 0;
+  if ((long)(millis() - __save_time) >= 0) {
+    uptime = millis();
+    temperature = analogRead(A0) * 0.1f;
+    uptime.save(); temperature.save();
+    __save_time = millis() + 60000;
+  }
+}
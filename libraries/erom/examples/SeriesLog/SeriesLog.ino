@@ -0,0 +1,69 @@
+#include <Arduino.h>
+#include <erom.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Create 'history' log of 'A0' samples in EEPROM 0..511: 16 blocks of 32
+// bytes, each holding about 20 samples of slowly changing values. Once all
+// blocks are used, the oldest one is overwritten.
+erom::SeriesLog<int> history(0, 512);
+unsigned long sample_time = 0;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void print_history() {
+  erom::SeriesLog<int>::Reader reader(history);
+  int sample;
+  unsigned long count = 0;
+
+  Serial.println("History (block time, sample index: value):");
+  while (reader.next(sample)) {
+    Serial.print(reader.time());
+    Serial.print(", ");
+    Serial.print(reader.index());
+    Serial.print(": ");
+    Serial.println(sample);
+    count++;
+  }
+  Serial.print(count);
+  Serial.println(" samples");
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void serialEvent() {
+  if (Serial.available() > 0) {
+    char __c = toupper(Serial.read());
+    switch (__c) {
+      case 'P': print_history(); break;
+      case 'F': history.flush(); Serial.println("Flushed."); break;
+      default:
+        Serial.println("Usage:");
+        Serial.println(" P - print history");
+        Serial.println(" F - flush samples not written to EEPROM yet");
+        break;
+    }
+    while (Serial.available() > 0) Serial.read();
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  Serial.begin(115200);
+  pinMode(A0, INPUT);
+  delay(1000);
+
+  // Find the newest block; new samples continue it
+  if (!history.load()) Serial.println("History is empty");
+  print_history();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() {
+  // A sample every second; full blocks are written to EEPROM in one go
+  if (millis() - sample_time >= 1000) {
+    sample_time += 1000;
+    history.append(analogRead(A0));
+  }
+}
@@ -3,13 +3,8 @@
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
 // Define a 'Storage' class that will manage EEPROM related data
+// Issued entries are loaded by 'load()' and, when changed, saved by 'save()'
 class Storage : public erom::Storage {
-protected:
-  // Define rules for loading storage into RAM
-  virtual void OnLoad() { volume.load(); brightness.load(); }
-  // Define rules for saving storage into EEPROM
-  virtual void OnSave() { volume.save(); brightness.save(); }
-
 public:
   // Storage data/variables
   erom::Entry<float> volume;
@@ -9,8 +9,7 @@ void show_data(const char *aTitle);
 
 class Storage : public erom::Storage {
 protected:
-  virtual void OnLoad() { A0.load(); A1.load(); }
-  virtual void OnSave() { show_data("Storing data to EEPROM"); A0.save(); A1.save(); }
+  virtual void OnSave() { show_data("Storing data to EEPROM"); erom::Storage::OnSave(); }
   virtual void OnClear() { A0 = 0; A1 = 0; }
 
 public:
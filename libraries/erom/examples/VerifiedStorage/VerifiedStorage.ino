@@ -5,10 +5,9 @@
 
 class Storage : public erom::VerifiedStorage {
 protected:
-  // 'VerifiedStorage::On???()' must be called for verification to work
+  // 'VerifiedStorage::On???()' must be called for verification to work.
+  // Issued entries are loaded and saved by 'VerifiedStorage' itself.
   virtual void OnClear() { VerifiedStorage::OnClear(); i = 12345; l = 1234567890; f = 3.14f; }
-  virtual void OnLoad()  { VerifiedStorage::OnLoad();  i.load();  l.load();       f.load();  }
-  virtual void OnSave()  { VerifiedStorage::OnSave();  i.save();  l.save();       f.save();  }
 
 public:
   erom::Entry<int>   i;
@@ -10,20 +10,14 @@ protected:
     uptime = 0; serial_bytes_in = 0;
   }
 
-  virtual void OnLoad() {
-    erom::VerifiedStorage::OnLoad();  // Must be called for verification to work
-    uptime.load(); serial_bytes_in.load();
-  }
-
   virtual void OnSave() {
-    erom::VerifiedStorage::OnSave();  // Must be called for verification to work
-
     Serial.println("Saving data to EEPROM...");
-    uptime.save(); serial_bytes_in.save();
+    erom::VerifiedStorage::OnSave();  // Saves changed entries
   }
 
 public:
-  erom::Entry<long> uptime;
+  // Saved every 15 seconds, so spread the writes over 8 slots
+  erom::WearLeveledEntry<long, 8> uptime;
   erom::Entry<long> serial_bytes_in;
 
   Storage() : VerifiedStorage(0xFFF1, 0x0001) { issue(uptime); issue(serial_bytes_in); }
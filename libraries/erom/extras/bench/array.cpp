@@ -0,0 +1,121 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark of a table of 256 'int16_t' (512 bytes of EEPROM) kept in
+// a whole 'Entry' (of a struct holding 'int16_t[256]', as 'Entry' cannot
+// take an array type), an 'EntryArray<int16_t, 256>' and an
+// 'EntryArray<int16_t, 256, 16>' keeping 16 elements in RAM, on the
+// simulated EEPROM ('erom::ImageDevice::native()'). The same 1000 edits,
+// each followed by 'Storage::save()', are replayed on all three:
+//   scattered - 4 random elements get new values
+//   run       - 8 consecutive elements from a random one get new values
+// and the table is loaded and read whole once at the end. Prints one CSV
+// line per run:
+//   workload        - name, 'array.<entry|array|window>.<scattered|run>'
+//   elements        - elements of the table
+//   ram_bytes       - 'sizeof' of the table object on the host
+//   saves           - edits saved
+//   bytes_read      - EEPROM bytes read by the saves
+//   bytes_written   - EEPROM bytes programmed by the saves
+//   programming_us  - modelled EEPROM programming time
+//   load_read_bytes - EEPROM bytes read to load and read the whole table
+//   cpu_ns_per_save - host CPU time per edit and save
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/array.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o array
+//   ./array > array.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static erom::ImageDevice &image = erom::ImageDevice::native();
+
+enum { elements = 256 };
+static const unsigned long saves = 1000;
+
+struct Values { int16_t v[elements]; };
+typedef erom::Entry<Values> WholeTable;
+typedef erom::EntryArray<int16_t, elements> ArrayTable;
+typedef erom::EntryArray<int16_t, elements, 16> WindowTable;
+
+// Element access of either kind of table
+static inline int16_t get(WholeTable &aTable, size_t aIndex) { return aTable.value.v[aIndex]; }
+static inline void set(WholeTable &aTable, size_t aIndex, int16_t aValue) { aTable.value.v[aIndex] = aValue; aTable.touch(); }
+template<size_t Window> static inline int16_t get(erom::EntryArray<int16_t, elements, Window> &aTable, size_t aIndex) { return aTable[aIndex]; }
+template<size_t Window> static inline void set(erom::EntryArray<int16_t, elements, Window> &aTable, size_t aIndex, int16_t aValue) { aTable.set(aIndex, aValue); }
+
+template<class Table> class Config : public erom::Storage {
+public:
+  Table table;
+  Config() { issue(table); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static double cpu() {
+  struct timespec __ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &__ts);
+  return __ts.tv_sec * 1e9 + __ts.tv_nsec;
+}
+
+template<class Table> static void edit(Table &aTable, bool aRun) {
+  if (aRun) {
+    size_t __first = random(elements - 8);
+    for (size_t __i = __first; __i < __first + 8; __i++) set(aTable, __i, random(-30000, 30000));
+  } else
+    for (int __n = 0; __n < 4; __n++) set(aTable, random(elements), random(-30000, 30000));
+}
+
+// Saves the first table on erased EEPROM, then replays the edits, keeping
+// a copy in 'reference'. Exits if the reloaded table differs
+template<class Table> static void run(const char *aName, bool aRun) {
+  int16_t __reference[elements];
+  memset(image.image(), 0xFF, image.size());
+  randomSeed(1);
+  Config<Table> __config;
+  for (size_t __i = 0; __i < elements; __i++) set(__config.table, __i, __i);
+  __config.save();
+  __config.load();
+  image.reset_stats();
+
+  double __cpu = cpu();
+  for (unsigned long __n = 0; __n < saves; __n++) edit(__config.table, aRun), __config.save();
+  __cpu = cpu() - __cpu;
+  unsigned long __read = image.bytes_read(), __written = image.bytes_written(), __programming = image.programming_time();
+  for (size_t __i = 0; __i < elements; __i++) __reference[__i] = get(__config.table, __i);
+
+  Config<Table> __loaded;
+  image.reset_stats();
+  __loaded.load();
+  for (size_t __i = 0; __i < elements; __i++)
+    if (get(__loaded.table, __i) != __reference[__i]) {
+      printf("%s: reloaded table differs\n", aName);
+      exit(1);
+    }
+  unsigned long __load_read = image.bytes_read();
+
+  printf("array.%s.%s,%d,%lu,%lu,%lu,%lu,%lu,%lu,%.0f\n", aName, aRun ? "run" : "scattered", elements,
+    (unsigned long)sizeof(Table), saves, __read, __written, __programming, __load_read, __cpu / saves);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("workload,elements,ram_bytes,saves,bytes_read,bytes_written,programming_us,load_read_bytes,cpu_ns_per_save\n");
+  for (int __run = 0; __run < 2; __run++) {
+    run<WholeTable>("entry", __run);
+    run<ArrayTable>("array", __run);
+    run<WindowTable>("window", __run);
+  }
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
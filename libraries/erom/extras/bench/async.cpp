@@ -0,0 +1,165 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host measurement of how long 'Storage::save()' blocks the sketch with
+// synchronous writes and with the asynchronous write queue
+// ('Access::async()'), on the simulated native EEPROM
+// ('erom::ImageDevice::native()') in realtime mode: every byte really takes
+// its 3.4 ms programming time. A storage of 16 'int32_t' entries gets 1, 4,
+// 8 or 16 of them changed in all bytes, then is saved. With the queue the
+// EE_READY interrupt is simulated by servicing the queue whenever the
+// device is ready, after 'save()' returned. Prints one CSV line per save:
+//   mode              - 'sync' or 'async'
+//   bytes             - bytes the save programs
+//   blocked_us        - time 'save()' took
+//   blocked_us_per_byte - the same per byte: the programming time when
+//                       synchronous, the cost to queue a byte when
+//                       asynchronous, as long as the queue
+//                       ('EROM_WRITE_QUEUE_SIZE' bytes) has room
+//   done_us           - time until every byte was programmed
+//
+// Then checks 'RejectOnFull' with a queue 2 bytes short of full: saving an
+// 8 byte entry, a wear-leveled entry and a counter rollover, and committing
+// a batch must queue nothing and leave the entries dirty, then succeed once
+// the queue drained.
+//
+// Exits with 1 if EEPROM does not hold the saved values in the end, or if
+// a rejected save or batch queued any byte or cleared the dirty flag.
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/async.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o async
+//   ./async > async.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static erom::ImageDevice &image = erom::ImageDevice::native();
+
+enum { entries = 16 };
+static const int changes[] = { 1, 4, 8, 16 };
+
+class CounterStorage : public erom::Storage {
+public:
+  erom::Entry<int32_t> counters[entries];
+  CounterStorage() { for (int __i = 0; __i < entries; __i++) issue(counters[__i]); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static double now() {
+  struct timespec __ts;
+  clock_gettime(CLOCK_MONOTONIC, &__ts);
+  return __ts.tv_sec * 1e6 + __ts.tv_nsec / 1e3;
+}
+
+static void drain() {
+  while (erom::WriteQueue::pending()) if (erom::NativeDevice::is_ready()) erom::WriteQueue::service();
+}
+
+static void run(bool aAsync, int aChanges) {
+  memset(image.image(), 0, image.size());
+  CounterStorage __storage;
+  __storage.load();
+  for (int __i = 0; __i < aChanges; __i++) __storage.counters[__i] = (int32_t)0x5A5A5A5AL + __i;
+
+  erom::access.async(aAsync);
+  double __start = now();
+  __storage.save();
+  double __blocked = now() - __start;
+  drain();
+  while (!erom::NativeDevice::is_ready());
+  double __done = now() - __start;
+  erom::access.async(false);
+
+  for (int __i = 0; __i < entries; __i++) {
+    int32_t __stored;
+    memcpy(&__stored, image.image() + __i * sizeof(int32_t), sizeof(__stored));
+    if (__stored != __storage.counters[__i].value) {
+      printf("%s: entry %d not saved\n", aAsync ? "async" : "sync", __i);
+      exit(1);
+    }
+  }
+  int __bytes = aChanges * sizeof(int32_t);
+  printf("%s,%d,%.1f,%.2f,%.0f\n", aAsync ? "async" : "sync", __bytes, __blocked, __blocked / __bytes, __done);
+}
+
+static void reject_check(const char *aWhat, bool aStored) {
+  if (aStored) return;
+  printf("reject: %s\n", aWhat);
+  exit(1);
+}
+
+// Saves and a batch against a queue with room for 2 bytes only
+static void reject() {
+  static const size_t fill = erom::WriteQueue::capacity - 2;
+  static const uint8_t filler[fill] = { 0 };
+  uint64_t __zero = 0, __stored;
+  memset(image.image(), 0, image.size());
+  image.realtime(false);
+
+  erom::Entry<uint64_t> __entry(128, 0xFFFFFFFFFFFF0708ULL);
+  erom::WearLeveledEntry<uint32_t, 4> __wear(160, 0);
+  erom::MonotonicCounter<4> __counter(192, 0);
+  __wear.save(true);
+  __counter.save(true);
+  erom::Batch<2> __batch;
+  uint32_t __low = 0x01020304UL, __high = 0x05060708UL;
+  __batch.update(136, __low);
+  __batch.update(140, __high);
+
+  erom::access.async(true);
+  erom::access.queue_policy(erom::WriteQueue::RejectOnFull);
+  reject_check("filler not queued", erom::access.write_block(256, filler, fill) == fill);
+  __entry.save();
+  reject_check("save torn", !memcmp(image.image() + 128, &__zero, sizeof(__zero)) && erom::WriteQueue::pending() == fill);
+  reject_check("rejected save clean", __entry.dirty());
+  __wear = 0x11223344UL;
+  __wear.save();
+  reject_check("wear-leveled save torn", __wear.dirty() && erom::WriteQueue::pending() == fill);
+  __counter = 1000;
+  __counter.save();
+  reject_check("counter rollover torn", __counter.dirty() && erom::WriteQueue::pending() == fill);
+  reject_check("batch torn", !erom::access.commit(__batch) && erom::WriteQueue::pending() == fill);
+
+  drain();
+  __entry.save();
+  drain();
+  __wear.save();
+  drain();
+  __counter.save();
+  drain();
+  reject_check("saves left dirty", !__entry.dirty() && !__wear.dirty() && !__counter.dirty());
+  reject_check("batch rejected with room", erom::access.commit(__batch) == 8);
+  drain();
+  erom::access.queue_policy(erom::WriteQueue::WaitOnFull);
+  erom::access.async(false);
+
+  memcpy(&__stored, image.image() + 128, sizeof(__stored));
+  reject_check("save lost", __stored == __entry.value);
+  reject_check("wear-leveled save lost", erom::WearLeveledEntry<uint32_t, 4>(160).value == 0x11223344UL);
+  reject_check("counter rollover lost", erom::MonotonicCounter<4>(192).value == 1000);
+  reject_check("batch lost", !memcmp(image.image() + 136, &__low, sizeof(__low)) && !memcmp(image.image() + 140, &__high, sizeof(__high)));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  image.realtime(true);
+
+  printf("mode,bytes,blocked_us,blocked_us_per_byte,done_us\n");
+  for (int __async = 0; __async < 2; __async++)
+    for (size_t __i = 0; __i < sizeof(changes) / sizeof(changes[0]); __i++)
+      run(__async, changes[__i]);
+  reject();
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
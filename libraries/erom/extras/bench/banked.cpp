@@ -0,0 +1,174 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host power-cut sweep of 'BankedStorage' on a simulated EEPROM
+// ('erom::ImageDevice'). A storage of three entries (28 bytes) gets 200
+// saves of random changes. Every save is replayed from the image it started
+// from once per cell it programs, the supply cut before that cell is
+// programmed ('between') or while it is ('inside', the cell is left erased).
+// A fresh storage then loads the image, which must hold either the whole
+// previous snapshot or the whole new one: a mixed snapshot or no valid bank
+// stops the run with exit code 1. Saves run either by 'save()' or as a
+// resumable pass ('begin_save()' and 'tick()'). Prints one CSV line per run:
+//   mode     - '<save|tick>.<between|inside>'
+//   saves    - saves replayed
+//   cuts     - power cuts simulated
+//   old      - reloads which found the previous snapshot
+//   new      - reloads which found the new snapshot
+//   mixed    - reloads which found neither, always 0
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/banked.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o banked
+//   ./banked > banked.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image cutting the supply at the cell it is armed for: that cell is left
+// erased ('inside') or as it was ('between'), the cells after it are not
+// programmed. Counts the cells programmed since 'arm()'
+class CuttingImage : public erom::ImageDevice {
+private:
+  long _cut;        // Cells until the cut, negative when not armed
+  bool _inside;     // Cut while the cell is programmed
+  bool _off;        // Supply cut
+
+  // Returns true if the cell at 'aAddress' gets programmed
+  bool _cell(size_t aAddress) {
+    cells++;
+    if (_off) return false;
+    if (_cut < 0 || _cut--) return true;
+    _off = true;
+    if (_inside) image()[aAddress] = 0xFF;
+    return false;
+  }
+
+public:
+  unsigned long cells;
+
+  CuttingImage(size_t aSize) : ImageDevice(NULL, aSize), _cut(-1), _inside(false), _off(false), cells(0) { /* Do Nothing */ }
+
+  inline void arm(long aCut, bool aInside) { _cut = aCut, _inside = aInside, _off = false, cells = 0; }
+  inline void disarm() { _cut = -1, _off = false; }
+
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) {
+    for (size_t __i = 0; __i < aSize; __i++)
+      if (_cell(aAddress + __i)) ImageDevice::write(aAddress + __i, (const uint8_t*)aData + __i, 1);
+  }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode aMode) { if (_cell(aAddress)) ImageDevice::program(aAddress, aValue, aMode); }
+};
+
+// Larger than the banks: 'Access' keeps the last byte out of range
+static CuttingImage image(256);
+static erom::Access eeprom(image);
+
+static const unsigned long saves = 200;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+struct Name { uint8_t bytes[16]; };
+struct Limits { int32_t low, high; };
+
+struct Snapshot {
+  int32_t counter;
+  Name name;
+  Limits limits;
+};
+
+class Settings : public erom::BankedStorage {
+public:
+  erom::Entry<int32_t> counter;
+  erom::Entry<Name> name;
+  erom::Entry<Limits> limits;
+
+  Settings() : BankedStorage(eeprom, 32) { issue(counter); issue(name); issue(limits); }
+
+  void get(Snapshot &aSnapshot) const {
+    aSnapshot.counter = counter.value, aSnapshot.name = name.value, aSnapshot.limits = limits.value;
+  }
+
+  void set(const Snapshot &aSnapshot) {
+    counter = aSnapshot.counter, name = aSnapshot.name, limits = aSnapshot.limits;
+  }
+};
+
+// Changes a few bytes of the snapshot
+static void change(Snapshot &aSnapshot) {
+  uint8_t *__bytes = (uint8_t*)&aSnapshot;
+  for (long __n = random(1, 6); __n > 0; __n--) __bytes[random(sizeof(Snapshot))] = (uint8_t)random(256);
+}
+
+static void save(Settings &aSettings, bool aTick) {
+  if (!aTick) aSettings.save();
+  else for (aSettings.begin_save(); aSettings.busy(); ) aSettings.tick(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static void run(bool aTick, bool aInside) {
+  static uint8_t __before[256];
+  unsigned long __cuts = 0, __old = 0, __new = 0;
+  Snapshot __committed, __next;
+
+  memset(image.image(), 0xFF, image.size());
+  memset(&__committed, 0, sizeof(__committed));
+  randomSeed(1);
+  {
+    Settings __settings;
+    __settings.set(__committed);
+    save(__settings, aTick);
+  }
+
+  for (unsigned long __save = 0; __save < saves; __save++) {
+    __next = __committed;
+    change(__next);
+    memcpy(__before, image.image(), image.size());
+
+    for (long __cut = 0; ; __cut++) {
+      memcpy(image.image(), __before, image.size());
+      Settings __settings;
+      __settings.load();
+      __settings.set(__next);
+      image.arm(__cut, aInside);
+      save(__settings, aTick);
+      bool __cut_short = __cut < (long)image.cells;
+      image.disarm();
+      if (!__cut_short) break;
+
+      Settings __loaded;
+      __loaded.load();
+      Snapshot __now;
+      __loaded.get(__now);
+      __cuts++;
+      if (__loaded.valid() && !memcmp(&__now, &__committed, sizeof(Snapshot))) __old++;
+      else if (__loaded.valid() && !memcmp(&__now, &__next, sizeof(Snapshot))) __new++;
+      else {
+        printf("%s.%s: save %lu cut at cell %ld of %lu loads a mixed snapshot%s\n", aTick ? "tick" : "save", aInside ? "inside" : "between",
+          __save, __cut, image.cells, __loaded.valid() ? "" : " (no valid bank)");
+        exit(1);
+      }
+    }
+    __committed = __next;
+  }
+
+  printf("%s.%s,%lu,%lu,%lu,%lu,0\n", aTick ? "tick" : "save", aInside ? "inside" : "between", saves, __cuts, __old, __new);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("mode,saves,cuts,old,new,mixed\n");
+  for (int __tick = 0; __tick < 2; __tick++)
+    for (int __inside = 0; __inside < 2; __inside++)
+      run(__tick, __inside);
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
@@ -0,0 +1,175 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark of 'Access::commit()' against the same operations issued
+// as individual 'write_block()'/'update_block()' calls, on a simulated
+// EEPROM ('erom::ImageDevice') counting the device operations. 1000 rounds
+// of three workloads:
+//   entries   - 16 adjacent 'int32_t' entries updated one after another, as
+//               by 'Storage::save()', 2 of them to new values
+//   record    - 3 records of 8 bytes written to a ring, the 4 byte head
+//               index at address 0 updated after each
+//   scattered - 12 updates of 2 .. 8 bytes at random addresses of 1 KB,
+//               overlapping at times, a quarter of them with new bytes
+// Prints one CSV line per run:
+//   workload         - name, 'batch.<calls|commit>.<entries|record|scattered>'
+//   rounds           - rounds run
+//   read_ops         - device 'read()' calls
+//   bytes_read       - bytes read from the device
+//   bytes_written    - EEPROM bytes programmed
+//   programming_us   - modelled programming time
+//   bubbles          - programming cycles started right after reading the
+//                      byte they program: on the chip the device idles while
+//                      the bytes read are compared, instead of comparing
+//                      while the previous cycle runs
+//   cpu_ns_per_round - host CPU time per round
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/batch.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o batch
+//   ./batch > batch.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image counting the reads it gets and the pipeline bubbles
+class CountingImage : public erom::ImageDevice {
+private:
+  size_t _read_address, _read_size;   // Last operation if a read
+
+  void _programming(size_t aAddress) {
+    if (aAddress - _read_address < _read_size) bubbles++;
+    _read_size = 0;
+  }
+
+public:
+  unsigned long read_ops, bubbles;
+
+  CountingImage(size_t aSize) : ImageDevice(NULL, aSize), _read_address(0), _read_size(0), read_ops(0), bubbles(0) { /* Do Nothing */ }
+
+  virtual void read(size_t aAddress, void *aData, size_t aSize) {
+    read_ops++, _read_address = aAddress, _read_size = aSize;
+    ImageDevice::read(aAddress, aData, aSize);
+  }
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) { _programming(aAddress); ImageDevice::write(aAddress, aData, aSize); }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode aMode) { _programming(aAddress); ImageDevice::program(aAddress, aValue, aMode); }
+
+  void reset_counts() { read_ops = bubbles = 0, _read_size = 0; reset_stats(); }
+};
+
+// Larger than the workloads: 'Access' keeps the last byte out of range
+static CountingImage image(2048);
+static erom::Access eeprom(image);
+
+static const unsigned long rounds = 1000;
+enum { max_ops = 32 };
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Operations of a round, in the order issued
+
+struct Operation { size_t address, size; bool write; uint8_t data[8]; };
+
+static Operation ops[max_ops];
+static int op_count;
+static uint8_t model[1024];   // What EEPROM holds after the operations so far
+static int32_t values[16];    // Entries of 'entries', head index of 'record'
+static int32_t head;
+
+static void add(size_t aAddress, const void *aData, size_t aSize, bool aWrite) {
+  Operation &__op = ops[op_count++];
+  __op.address = aAddress, __op.size = aSize, __op.write = aWrite;
+  memcpy(__op.data, aData, aSize);
+  memcpy(model + aAddress, aData, aSize);
+}
+
+static void entries() {
+  for (int __n = 0; __n < 2; __n++) values[random(16)] = random(0x7FFFFFFFL);
+  for (int __i = 0; __i < 16; __i++) add(__i * sizeof(int32_t), &values[__i], sizeof(int32_t), false);
+}
+
+static void record() {
+  for (int __n = 0; __n < 3; __n++) {
+    uint8_t __record[8];
+    for (int __i = 0; __i < 8; __i++) __record[__i] = random(256);
+    add(16 + head * sizeof(__record), __record, sizeof(__record), true);
+    head = (head + 1) % 64;
+    add(0, &head, sizeof(head), false);
+  }
+}
+
+static void scattered() {
+  for (int __n = 0; __n < 12; __n++) {
+    size_t __address = random(1016), __size = random(2, 9);
+    uint8_t __data[8];
+    memcpy(__data, model + __address, __size);
+    if (random(4) == 0) for (size_t __i = 0; __i < __size; __i++) __data[__i] = random(256);
+    add(__address, __data, __size, false);
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static double cpu() {
+  struct timespec __ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &__ts);
+  return __ts.tv_sec * 1e9 + __ts.tv_nsec;
+}
+
+// Runs the rounds of 'aWorkload' from erased EEPROM. Exits if EEPROM does
+// not hold what the operations wrote
+static void run(const char *aName, void (*aWorkload)(), bool aCommit) {
+  memset(image.image(), 0xFF, image.size());
+  memset(model, 0xFF, sizeof(model));
+  memset(values, 0, sizeof(values)), head = 0;
+  randomSeed(1);
+  image.reset_counts();
+
+  double __cpu = 0;
+  for (unsigned long __n = 0; __n < rounds; __n++) {
+    op_count = 0;
+    aWorkload();
+    double __start = cpu();
+    if (aCommit) {
+      erom::Batch<max_ops> __batch;
+      for (int __i = 0; __i < op_count; __i++)
+        __batch.add(ops[__i].address, ops[__i].data, ops[__i].size, ops[__i].write ? erom::BatchBase::Write : erom::BatchBase::Update);
+      eeprom.commit(__batch);
+    }
+    else
+      for (int __i = 0; __i < op_count; __i++) {
+        if (ops[__i].write) eeprom.write_block(ops[__i].address, ops[__i].data, ops[__i].size);
+        else eeprom.update_block(ops[__i].address, ops[__i].data, ops[__i].size);
+      }
+    __cpu += cpu() - __start;
+  }
+
+  if (memcmp(image.image(), model, sizeof(model))) {
+    printf("%s: EEPROM differs\n", aCommit ? "commit" : "calls");
+    exit(1);
+  }
+  printf("batch.%s.%s,%lu,%lu,%lu,%lu,%lu,%lu,%.0f\n", aCommit ? "commit" : "calls", aName, rounds, image.read_ops,
+    image.bytes_read(), image.bytes_written(), image.programming_time(), image.bubbles, __cpu / rounds);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  static const char *__names[] = { "entries", "record", "scattered" };
+  static void (*__workloads[])() = { entries, record, scattered };
+
+  printf("workload,rounds,read_ops,bytes_read,bytes_written,programming_us,bubbles,cpu_ns_per_round\n");
+  for (int __w = 0; __w < 3; __w++) {
+    run(__names[__w], __workloads[__w], false);
+    run(__names[__w], __workloads[__w], true);
+  }
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
@@ -0,0 +1,609 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark replaying the access patterns of the bundled examples
+// against the simulated EEPROM ('erom::ImageDevice::native()'), a simulated
+// 24LC256 on the host 'Wire' bus for 'i2c.*' workloads, or a simulated NOR
+// flash ('erom::ImageFlash') for 'flash.*' workloads. Prints one CSV line per
+// workload:
+//   workload     - name, '<example>.<action>'
+//   iterations   - 'loop()' iterations (or example actions) replayed
+//   ops          - library calls made (reads, writes, saves, ticks), or
+//                  'loop()' iterations for the '.loop' workloads
+//   bytes_read, bytes_written - EEPROM traffic
+//   payload_bytes  - value bytes handed to store calls, 0 where not counted;
+//                    'bytes_written / payload_bytes' is the write amplification
+//   programming_us - modelled EEPROM programming time
+//   max_wear       - most programming cycles taken by a single cell (for
+//                    'flash.*' erases of the most erased sector)
+//   worst_block_us - worst modelled programming time of a single iteration,
+//                    i.e. how long 'loop()' could block at most (for 'i2c.*'
+//                    and 'flash.*' time spent in the iteration, waiting for
+//                    the part included)
+//   bus_transactions - I2C transfers (reads and writes, not ACK polls) on the
+//                    host 'Wire' bus for 'i2c.*' and 'cache.*', 0 otherwise
+//   cpu_ns_per_op  - host CPU time per library call
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/bench.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o bench
+//   ./bench > bench.csv
+// Set 'EROM_BENCH' to a workload name prefix to run matching ones only.
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <erom.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static erom::ImageDevice &image = erom::ImageDevice::native();
+static HostI2CEeprom i2c_part(0x50, 32768, 64);  // 24LC256
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Collects the figures of a single workload, from the native image, the
+// simulated I2C part 'aPart' or the simulated flash 'aFlash'
+class Bench {
+private:
+  const char *_name;
+  HostI2CEeprom *_part;
+  erom::ImageFlash *_flash;
+  unsigned long _iterations, _ops, _payload, _worst, _iteration_start;
+  double _cpu_start;
+
+  static double _cpu() {
+    timespec __ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &__ts);
+    return __ts.tv_sec * 1e9 + __ts.tv_nsec;
+  }
+
+  inline unsigned long _blocked() const { return _part || _flash ? micros() : image.programming_time(); }
+
+public:
+  Bench(const char *aName, HostI2CEeprom *aPart = NULL) : _name(aName), _part(aPart), _flash(NULL), _iterations(0), _ops(0), _payload(0), _worst(0), _iteration_start(0) {
+    if (_part) _part->reset_stats(), Wire.reset_stats();
+    else image.reset_stats();
+    _cpu_start = _cpu();
+  }
+  Bench(const char *aName, erom::ImageFlash *aFlash) : _name(aName), _part(NULL), _flash(aFlash), _iterations(0), _ops(0), _payload(0), _worst(0), _iteration_start(0) {
+    _flash->reset_stats();
+    _cpu_start = _cpu();
+  }
+
+  inline void begin() { _iteration_start = _blocked(); }
+  inline void end() {
+    unsigned long __blocked = _blocked() - _iteration_start;
+    if (__blocked > _worst) _worst = __blocked;
+    _iterations++;
+  }
+  inline void op(unsigned long aCount = 1) { _ops += aCount; }
+  inline void payload(unsigned long aBytes) { _payload += aBytes; }
+
+  void report() {
+    double __cpu = _cpu() - _cpu_start;
+    if (_flash) {
+      printf("%s,%lu,%lu,0,%lu,%lu,%lu,%lu,%lu,0,%.1f\n", _name, _iterations, _ops,
+        _flash->bytes_programmed(), _payload, _flash->programming_time(), _flash->max_erases(), _worst,
+        _ops ? __cpu / _ops : 0.);
+      return;
+    }
+    printf("%s,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.1f\n", _name, _iterations, _ops,
+      _part ? _part->bytes_read() : image.bytes_read(),
+      _part ? _part->bytes_written() : image.bytes_written(), _payload,
+      _part ? _part->write_cycles() * _part->write_time() : image.programming_time(),
+      _part ? _part->max_wear() : image.max_wear(), _worst,
+      _part ? Wire.transactions() : 0,
+      _ops ? __cpu / _ops : 0.);
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static void erase() { memset(image.image(), 0xFF, image.size()); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'Access' example: 21 bytes written, updated and read one at a time, every
+// fifth byte changed between iterations ('trash_eeprom()')
+static const size_t access_data_sz = 21;
+static byte access_data[access_data_sz] = { "Robodem EEPROM test." };
+
+static void trash(byte *aData) {
+  for (size_t __i = 0; __i < access_data_sz; __i++)
+    aData[__i] = random(5) ? access_data[__i] : random('!', '~');
+}
+
+static void access_write() {
+  Bench __bench("access.write");
+  byte __data[access_data_sz];
+  for (int __n = 0; __n < 200; __n++) {
+    trash(__data);
+    __bench.begin();
+    for (size_t __i = 0; __i < access_data_sz; __i++) erom::access.write_char(__i, __data[__i]), __bench.op();
+    __bench.payload(access_data_sz);
+    __bench.end();
+  }
+  __bench.report();
+}
+
+static void access_update() {
+  Bench __bench("access.update");
+  byte __data[access_data_sz];
+  for (int __n = 0; __n < 200; __n++) {
+    trash(__data);
+    __bench.begin();
+    for (size_t __i = 0; __i < access_data_sz; __i++) erom::access.update_char(__i, __data[__i]), __bench.op();
+    __bench.payload(access_data_sz);
+    __bench.end();
+  }
+  __bench.report();
+}
+
+static void access_update_block() {
+  Bench __bench("access.update_block");
+  byte __data[access_data_sz];
+  for (int __n = 0; __n < 200; __n++) {
+    trash(__data);
+    __bench.begin();
+    erom::access.update_block(0, __data), __bench.op();
+    __bench.payload(access_data_sz);
+    __bench.end();
+  }
+  __bench.report();
+}
+
+static void access_read() {
+  Bench __bench("access.read");
+  volatile byte __sink = 0;
+  for (int __n = 0; __n < 1000; __n++) {
+    __bench.begin();
+    for (size_t __i = 0; __i < access_data_sz; __i++) __sink ^= erom::access.read_byte(__i), __bench.op();
+    __bench.end();
+  }
+  __bench.report();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'Entry' example: three entries written in full, updated and restored
+
+static void entry_workloads() {
+  erom::Entry<int>   __ei(0, 0);
+  erom::Entry<long>  __el(__ei.size, 0);
+  erom::Entry<float> __ef(__ei.size + __el.size, 0.f);
+
+  {
+    Bench __bench("entry.save_full");
+    for (int __n = 0; __n < 200; __n++) {
+      __ei = 12345 + __n; __el = 1234567890L + __n; __ef = 3.1415f * __n;
+      __bench.begin();
+      __ei.save(true); __el.save(true); __ef.save(true); __bench.op(3);
+      __bench.payload(__ei.size + __el.size + __ef.size);
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("entry.save");
+    for (int __n = 0; __n < 200; __n++) {
+      __ei = 12345 + __n; __el = 1234567890L + __n; __ef = 3.1415f * __n;
+      __bench.begin();
+      __ei.save(); __el.save(); __ef.save(); __bench.op(3);
+      __bench.payload(__ei.size + __el.size + __ef.size);
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("entry.load");
+    for (int __n = 0; __n < 1000; __n++) {
+      __bench.begin();
+      __ei.load(); __el.load(); __ef.load(); __bench.op(3);
+      __bench.end();
+    }
+    __bench.report();
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'Storage_Postpone_Save' example: 10 minutes of recording two analog values
+// every millisecond, saved by 'tick()' every 30 seconds
+
+class PostponeStorage : public erom::Storage {
+public:
+  erom::Entry<int> A0, A1;
+  PostponeStorage() { issue(A0); issue(A1); }
+};
+
+static void storage_postpone_save() {
+  PostponeStorage __storage;
+  __storage.load();
+
+  Bench __bench("storage_postpone_save.loop");
+  for (unsigned long __n = 0; __n < 600000UL; __n++) {
+    __bench.begin();
+    __storage.A0 = analogRead(A0);
+    __storage.A1 = analogRead(A1);
+    __storage.postpone_save(30000);
+    __storage.tick(); __bench.op();
+    __bench.end();
+    host_advance_clock(1000);
+  }
+  __bench.report();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'VerifiedStorage_Uptime' example: an hour of uptime saved every 15 seconds
+// into a wear leveled entry, 'loop()' running every millisecond
+
+class UptimeStorage : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() { erom::VerifiedStorage::OnClear(); uptime = 0; serial_bytes_in = 0; }
+
+public:
+  erom::WearLeveledEntry<long, 8> uptime;
+  erom::Entry<long> serial_bytes_in;
+  UptimeStorage() : VerifiedStorage(0xFFF1, 0x0001) { issue(uptime); issue(serial_bytes_in); }
+};
+
+static void verified_storage_uptime() {
+  UptimeStorage __storage;
+  __storage.verify(true);
+  __storage.load();
+
+  Bench __bench("verified_storage_uptime.loop");
+  unsigned long __update_time = 0, __last_time = 0;
+  for (unsigned long __n = 0; __n < 3600000UL; __n++) {
+    __bench.begin();
+    unsigned long __millis = millis();
+    if (__millis >= __update_time) {
+      __storage.uptime += __millis - __last_time;
+      __storage.save();
+      __last_time = __millis;
+      __update_time = __millis + 15000;
+    }
+    __bench.op();
+    __bench.end();
+    host_advance_clock(1000);
+  }
+  __bench.report();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'KVStore' example: 16 configuration values of 4 bytes in the whole image,
+// one of them changed at a time. 'kv.storage_save' stores the same changes through a fixed-offset
+// 'Storage' for comparison. 'kv.load' is the boot scan of the resulting log,
+// 'kv.get' a lookup
+
+class ConfigStorage : public erom::Storage {
+public:
+  erom::Entry<int32_t> values[16];
+  ConfigStorage() { for (int __i = 0; __i < 16; __i++) issue(values[__i]); }
+};
+
+static void kv_workloads() {
+  static const unsigned long writes = 2000;
+  int32_t __value = 0;
+
+  {
+    ConfigStorage __storage;
+    __storage.load();
+    Bench __bench("kv.storage_save");
+    for (unsigned long __n = 0; __n < writes; __n++) {
+      __bench.begin();
+      __storage.values[random(16)] = ++__value;
+      __storage.save(); __bench.op(); __bench.payload(sizeof(__value));
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  erase();
+  erom::KVStore<16> __kv(0, image.size());
+  __kv.load();
+  {
+    Bench __bench("kv.put");
+    for (unsigned long __n = 0; __n < writes; __n++) {
+      __bench.begin();
+      __kv.put(random(16), ++__value); __bench.op(); __bench.payload(sizeof(__value));
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("kv.load");
+    for (int __n = 0; __n < 1000; __n++) {
+      __bench.begin();
+      __kv.load(); __bench.op();
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("kv.get");
+    volatile int32_t __sink = 0;
+    for (int __n = 0; __n < 10000; __n++) {
+      __bench.begin();
+      int32_t __v = 0;
+      __kv.get(__n % 16, __v); __bench.op();
+      __sink ^= __v;
+      __bench.end();
+    }
+    __bench.report();
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'SeriesLog' example: 10000 10-bit ADC samples of a synthetic trace logged
+// into the whole image, then read back. On '.read' rows 'ops' is the amount
+// of samples the image holds at the end, so the compression ratio against
+// raw 'int16_t' samples is 'ops * 2 / image size'. Blocks are 32 bytes, 64
+// on '.b64' rows; '.flush' rows flush every 10 samples instead of every full
+// block.
+
+static int16_t adc(long aValue) { return aValue < 0 ? 0 : aValue > 1023 ? 1023 : aValue; }
+
+static int16_t trace_sine(long aSample, int16_t)     { return adc(512 + 300 * sin(aSample / 200.) + random(-2, 3)); }
+static int16_t trace_walk(long, int16_t aLast)       { return adc(aLast + random(-8, 9)); }
+static int16_t trace_noise(long, int16_t)            { return adc(700 + random(-1, 2)); }
+static int16_t trace_steps(long aSample, int16_t)    { return adc((aSample / 500 % 4) * 250 + random(-3, 4)); }
+
+template<uint8_t BlockSize> static void series(const char *aName, const char *aReadName, int16_t (*aTrace)(long, int16_t), int aFlushEvery) {
+  static const long samples = 10000;
+  erom::SeriesLog<int16_t, BlockSize> __log(0, image.size());
+  __log.load();
+
+  {
+    Bench __bench(aName);
+    int16_t __value = 512;
+    for (long __n = 0; __n < samples; __n++) {
+      __value = aTrace(__n, __value);
+      __bench.begin();
+      __log.append(__value, __n); __bench.op(); __bench.payload(sizeof(__value));
+      if (aFlushEvery && __n % aFlushEvery == aFlushEvery - 1) __log.flush();
+      __bench.end();
+    }
+    __log.flush();
+    __bench.report();
+  }
+
+  if (!aReadName) return;
+  Bench __bench(aReadName);
+  typename erom::SeriesLog<int16_t, BlockSize>::Reader __reader(__log);
+  volatile int16_t __sink = 0;
+  int16_t __value;
+  __bench.begin();
+  while (__reader.next(__value)) __sink ^= __value, __bench.op();
+  __bench.end();
+  __bench.report();
+}
+
+static void series_workloads() {
+  series<32>("series.sine",  "series.sine.read",  trace_sine,  0);  erase();
+  series<32>("series.walk",  "series.walk.read",  trace_walk,  0);  erase();
+  series<32>("series.noise", "series.noise.read", trace_noise, 0);  erase();
+  series<32>("series.steps", "series.steps.read", trace_steps, 0);  erase();
+  series<64>("series.sine.b64", "series.sine.b64.read", trace_sine, 0);  erase();
+  series<32>("series.sine.flush", NULL, trace_sine, 10);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// External 24LC256 ('I2CDevice'): 256 bytes written and updated byte by byte
+// as well as in blocks, every fifth byte changed between iterations, and
+// read back the same ways. 'programming_us' is write cycles times 5 ms
+
+static void i2c_workloads() {
+  static erom::I2CDevice<TwoWire> __chip(Wire, 0x50, 32768, 64);
+  erom::Access __access(__chip);
+  byte __data[256];
+  for (size_t __i = 0; __i < sizeof(__data); __i++) __data[__i] = __i;
+
+  {
+    Bench __bench("i2c.write_byte", &i2c_part);
+    for (int __n = 0; __n < 4; __n++) {
+      __bench.begin();
+      for (size_t __i = 0; __i < sizeof(__data); __i++) __access.write_byte(__i, __data[__i]), __bench.op();
+      __bench.payload(sizeof(__data));
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("i2c.write_block", &i2c_part);
+    for (int __n = 0; __n < 4; __n++) {
+      __bench.begin();
+      __access.write_block(0, __data), __bench.op(), __bench.payload(sizeof(__data));
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("i2c.update_byte", &i2c_part);
+    for (int __n = 0; __n < 4; __n++) {
+      for (size_t __i = 0; __i < sizeof(__data); __i += 5) __data[__i]++;
+      __bench.begin();
+      for (size_t __i = 0; __i < sizeof(__data); __i++) __access.update_byte(__i, __data[__i]), __bench.op();
+      __bench.payload(sizeof(__data));
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("i2c.update_block", &i2c_part);
+    for (int __n = 0; __n < 4; __n++) {
+      for (size_t __i = 0; __i < sizeof(__data); __i += 5) __data[__i]++;
+      __bench.begin();
+      __access.update_block(0, __data), __bench.op(), __bench.payload(sizeof(__data));
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("i2c.read_byte", &i2c_part);
+    volatile byte __sink = 0;
+    for (int __n = 0; __n < 100; __n++) {
+      __bench.begin();
+      for (size_t __i = 0; __i < sizeof(__data); __i++) __sink ^= __access.read_byte(__i), __bench.op();
+      __bench.end();
+    }
+    __bench.report();
+  }
+
+  {
+    Bench __bench("i2c.read_block", &i2c_part);
+    for (int __n = 0; __n < 100; __n++) {
+      __bench.begin();
+      __access.read_block(0, __data), __bench.op();
+      __bench.end();
+    }
+    __bench.report();
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'Storage' of 16 longs on the external 24LC256, 3 of which change before
+// each of 200 saves, with no cache, a 'CacheDevice<8, 16>' writing through
+// and the same writing back (flushed after every save). 'ops' is saves,
+// 'bus_transactions / ops' the I2C transfers per save
+
+class CacheStorage : public erom::Storage {
+public:
+  erom::Entry<long> values[16];
+  CacheStorage(erom::Access &aAccess) : Storage(aAccess) { for (int __i = 0; __i < 16; __i++) issue(values[__i]); }
+};
+
+static void cache_save(const char *aName, erom::Device &aDevice, bool aFlush) {
+  erom::Access __access(aDevice);
+  CacheStorage __storage(__access);
+  __storage.save();
+  __access.flush();
+
+  Bench __bench(aName, &i2c_part);
+  randomSeed(1);                                // Same changes for every variant
+  for (int __n = 0; __n < 200; __n++) {
+    for (int __i = 0; __i < 3; __i++) __storage.values[random(16)] = random(100000);
+    __bench.begin();
+    __storage.save(), __bench.op(), __bench.payload(3 * sizeof(long));
+    if (aFlush) __access.flush();
+    __bench.end();
+  }
+  __bench.report();
+}
+
+static void cache_workloads() {
+  static erom::I2CDevice<TwoWire> __chip(Wire, 0x50, 32768, 64);
+  erom::CacheDevice<8, 16> __through(__chip), __back(__chip, erom::CacheDeviceBase::WriteBack);
+  cache_save("cache.save.uncached", __chip, false);
+  cache_save("cache.save.write_through", __through, false);
+  cache_save("cache.save.write_back", __back, true);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Emulated EEPROM ('FlashDevice<256>' in two 2 KB sectors of NOR flash with
+// 32-bit programming, 20 ms sector erase, erasing in the background): a
+// 'VerifiedStorage' with the uptime and 8 samples, one of which changes,
+// saved every second for an hour with 'loop()' running every millisecond.
+// 'flash.uptime.inline' only saves, so full logs are collected by the save
+// itself; 'flash.uptime.tick' calls 'tick()' every 'loop()'. 'bytes_written'
+// is flash bytes programmed, 'max_wear' erases of the most erased sector
+
+class FlashStorage : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() { erom::VerifiedStorage::OnClear(); uptime = 0; for (int __i = 0; __i < 8; __i++) samples[__i] = 0; }
+
+public:
+  erom::Entry<long> uptime;
+  erom::Entry<int>  samples[8];
+  FlashStorage(erom::Access &aAccess) : VerifiedStorage(aAccess, 0xFFF2, 0x0001) {
+    issue(uptime);
+    for (int __i = 0; __i < 8; __i++) issue(samples[__i]);
+  }
+};
+
+static void flash_uptime(const char *aName, bool aTick) {
+  erom::ImageFlash __flash(2048, 2, 4);
+  erom::FlashDevice<256> __device(__flash, 0, 2);
+  erom::Access __access(__device);
+  __flash.realtime(true);
+  __device.load();
+
+  FlashStorage __storage(__access);
+  __storage.verify(true);
+  __storage.load();
+
+  Bench __bench(aName, &__flash);
+  unsigned long __update_time = 0, __last_time = 0;
+  for (unsigned long __n = 0; __n < 3600000UL; __n++) {
+    __bench.begin();
+    unsigned long __millis = millis();
+    if (__millis >= __update_time) {
+      __storage.uptime += __millis - __last_time;
+      __storage.samples[random(8)] = analogRead(A0);
+      __storage.save(), __bench.op(), __bench.payload(sizeof(long) + sizeof(int));
+      __last_time = __millis;
+      __update_time = __millis + 1000;
+    }
+    if (aTick) __storage.tick(), __bench.op();
+    __bench.end();
+    host_advance_clock(1000);
+  }
+  __bench.report();
+}
+
+static void flash_workloads() {
+  flash_uptime("flash.uptime.inline", false);
+  flash_uptime("flash.uptime.tick", true);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+struct Workload {
+  const char *name;
+  void (*run)();
+};
+
+static const Workload workloads[] = {
+  { "access.write",                 access_write },
+  { "access.update",                access_update },
+  { "access.update_block",          access_update_block },
+  { "access.read",                  access_read },
+  { "entry",                        entry_workloads },
+  { "storage_postpone_save.loop",   storage_postpone_save },
+  { "verified_storage_uptime.loop", verified_storage_uptime },
+  { "kv",                           kv_workloads },
+  { "series",                       series_workloads },
+  { "i2c",                          i2c_workloads },
+  { "cache",                        cache_workloads },
+  { "flash",                        flash_workloads }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  const char *__only = getenv("EROM_BENCH");
+  host_advance_clock(0);  // Sketch time only moves when told so
+  Wire.attach(i2c_part);
+  Wire.begin();
+  randomSeed(1);
+
+  printf("workload,iterations,ops,bytes_read,bytes_written,payload_bytes,programming_us,max_wear,worst_block_us,bus_transactions,cpu_ns_per_op\n");
+  for (size_t __i = 0; __i < sizeof(workloads) / sizeof(workloads[0]); __i++) {
+    if (__only && strncmp(workloads[__i].name, __only, strlen(__only))) continue;
+    erase();
+    workloads[__i].run();
+  }
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
@@ -0,0 +1,113 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark of the boot of a 'VerifiedStorage' with checksum, either
+// by 'load_verified()' or by 'verify()' followed by 'load()' (the way the
+// VerifiedStorage example boots), on a simulated EEPROM ('erom::ImageDevice')
+// counting the device reads. Storages of 4, 16 and 64 'int32_t'
+// entries boot once from a valid image, then once after one entry byte was
+// corrupted. Prints one CSV line per boot:
+//   workload      - 'boot.<load_verified|verify_load>'
+//   entries       - entries of the storage
+//   read_ops      - device 'read()' calls
+//   bytes_read    - bytes read from EEPROM
+//   valid         - 1 if the boot accepted the valid image
+//   detects_corruption - 1 if the boot rejected the corrupted image
+//
+// Exits with 1 if a boot rejects the valid image or loads wrong values.
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/boot.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o boot
+//   ./boot > boot.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image counting the reads it gets
+class CountingImage : public erom::ImageDevice {
+public:
+  unsigned long read_ops;
+
+  CountingImage(size_t aSize) : ImageDevice(NULL, aSize), read_ops(0) { /* Do Nothing */ }
+
+  virtual void read(size_t aAddress, void *aData, size_t aSize) { read_ops++; ImageDevice::read(aAddress, aData, aSize); }
+
+  void reset_counts() { read_ops = 0; reset_stats(); }
+};
+
+// Larger than the storages: 'Access' keeps the last byte out of range
+static CountingImage image(1024);
+static erom::Access eeprom(image);
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+template<size_t Entries> class Config : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() {
+    erom::VerifiedStorage::OnClear();
+    for (size_t __i = 0; __i < Entries; __i++) values[__i] = (int32_t)(__i * 7919);
+  }
+
+public:
+  erom::Entry<int32_t> values[Entries];
+  Config() : VerifiedStorage(eeprom, 0xB007, 0x0001, true) { for (size_t __i = 0; __i < Entries; __i++) issue(values[__i]); }
+
+  bool boot(bool aLoadVerified) {
+    if (aLoadVerified) return load_verified();
+    if (!verify()) return false;
+    load();
+    return true;
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+template<size_t Entries> static void run(bool aLoadVerified) {
+  const char *__name = aLoadVerified ? "load_verified" : "verify_load";
+  memset(image.image(), 0xFF, image.size());
+  {
+    Config<Entries> __config;
+    __config.clear();
+  }
+
+  Config<Entries> __config;
+  image.reset_counts();
+  bool __valid = __config.boot(aLoadVerified);
+  unsigned long __read_ops = image.read_ops, __bytes_read = image.bytes_read();
+  for (size_t __i = 0; __i < Entries; __i++)
+    if (!__valid || __config.values[__i].value != (int32_t)(__i * 7919)) {
+      printf("%s.%lu: valid image not loaded\n", __name, (unsigned long)Entries);
+      exit(1);
+    }
+
+  // A bit of the last entry flipped, as by a save cut short
+  image.image()[__config.values[Entries - 1].address() + 1] ^= 0x10;
+  Config<Entries> __corrupted;
+  bool __detected = !__corrupted.boot(aLoadVerified);
+
+  printf("boot.%s,%lu,%lu,%lu,%d,%d\n", __name, (unsigned long)Entries, __read_ops, __bytes_read, __valid, __detected);
+}
+
+template<size_t Entries> static void layout() {
+  run<Entries>(true);
+  run<Entries>(false);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("workload,entries,read_ops,bytes_read,valid,detects_corruption\n");
+  layout<4>();
+  layout<16>();
+  layout<64>();
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
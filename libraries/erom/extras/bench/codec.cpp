@@ -0,0 +1,156 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark of entry codecs on the simulated EEPROM
+// ('erom::ImageDevice::native()'): a device configuration (baud rate,
+// timeout, retries, setpoint, gain, offset and a few flags) kept in raw
+// entries and in encoded ones ('VarintCodec', 'FixedPointCodec',
+// 'BitfieldCodec'). The same 1000 random edits, each followed by
+// 'Storage::save()', are replayed on both. Fields are 'int32_t' and 'float'
+// so sizes are those of AVR 'long' and 'double'. Prints one CSV line per
+// configuration:
+//   workload        - name, 'codec.<raw|encoded>'
+//   saves           - edits saved
+//   eeprom_bytes    - EEPROM bytes issued to the configuration
+//   bytes_written   - EEPROM bytes programmed
+//   programming_us  - modelled EEPROM programming time
+//   us_per_save     - the same per save
+//   cpu_ns_per_save - host CPU time per edit and save
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/codec.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o codec
+//   ./codec > codec.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static erom::ImageDevice &image = erom::ImageDevice::native();
+
+static const unsigned long saves = 1000;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Flags: 5 bytes raw, 15 bits packed
+
+struct Flags {
+  uint8_t mode;       // 0 .. 7
+  uint8_t channel;    // 0 .. 15
+  bool enabled, inverted;
+  int8_t trim;        // -32 .. 31
+
+  void pack(erom::BitWriter &aBits) const {
+    aBits.write(mode, 3); aBits.write(channel, 4); aBits.write(enabled, 1); aBits.write(inverted, 1); aBits.write(trim, 6);
+  }
+  void unpack(erom::BitReader &aBits) {
+    mode = aBits.read(3); channel = aBits.read(4); enabled = aBits.read(1); inverted = aBits.read(1); trim = aBits.read_signed(6);
+  }
+  bool operator==(const Flags &O) const {
+    return mode == O.mode && channel == O.channel && enabled == O.enabled && inverted == O.inverted && trim == O.trim;
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// The configuration with raw entries, 29 bytes
+
+class RawConfig : public erom::Storage {
+public:
+  erom::Entry<int32_t> baud, timeout, retries;
+  erom::Entry<float> setpoint, gain, offset;
+  erom::Entry<Flags> flags;
+
+  RawConfig() { issue(baud); issue(timeout); issue(retries); issue(setpoint); issue(gain); issue(offset); issue(flags); }
+};
+
+// The same with encoded entries, 14 bytes
+class EncodedConfig : public erom::Storage {
+public:
+  erom::Entry<int32_t, erom::VarintCodec<int32_t, 3> > baud;      // Up to 1048575
+  erom::Entry<int32_t, erom::VarintCodec<int32_t, 2> > timeout;   // Up to 8191 ms
+  erom::Entry<int32_t, erom::VarintCodec<int32_t, 1> > retries;   // Up to 63
+  erom::Entry<float, erom::FixedPointCodec<float, 100> > setpoint, offset;
+  erom::Entry<float, erom::FixedPointCodec<float, 1000> > gain;   // Up to 32.767
+  erom::Entry<Flags, erom::BitfieldCodec<Flags, 2> > flags;
+
+  EncodedConfig() { issue(baud); issue(timeout); issue(retries); issue(setpoint); issue(gain); issue(offset); issue(flags); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static double cpu() {
+  struct timespec __ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &__ts);
+  return __ts.tv_sec * 1e9 + __ts.tv_nsec;
+}
+
+// A setting changed from the UI: one field gets a new value on the grid the
+// encoded configuration stores exactly
+template<class Config> static void edit(Config &aConfig) {
+  static const int32_t __bauds[] = { 9600, 19200, 57600, 115200 };
+  switch (random(7)) {
+    case 0: aConfig.baud = __bauds[random(4)]; break;
+    case 1: aConfig.timeout = random(50, 2001); break;
+    case 2: aConfig.retries = random(6); break;
+    case 3: aConfig.setpoint = random(1500, 3001) / 100.f; break;
+    case 4: aConfig.gain = random(500, 2001) / 1000.f; break;
+    case 5: aConfig.offset = random(-200, 201) / 100.f; break;
+    default: {
+      Flags __flags = aConfig.flags;
+      __flags.mode = random(8), __flags.channel = random(16), __flags.trim = random(-32, 32);
+      __flags.enabled = random(2), __flags.inverted = random(2);
+      aConfig.flags = __flags;
+    }
+  }
+}
+
+template<class Config> static void defaults(Config &aConfig) {
+  Flags __flags = { 1, 3, true, false, 0 };
+  aConfig.baud = 115200, aConfig.timeout = 250, aConfig.retries = 3;
+  aConfig.setpoint = 21.5f, aConfig.gain = 1.f, aConfig.offset = 0.f, aConfig.flags = __flags;
+}
+
+// Saves the defaults on erased EEPROM, then replays the edits. Exits if the
+// reloaded configuration differs
+template<class Config> static void run(const char *aName) {
+  memset(image.image(), 0xFF, image.size());
+  randomSeed(1);
+  Config __config;
+  defaults(__config);
+  __config.save();
+  image.reset_stats();
+
+  double __cpu = cpu();
+  for (unsigned long __n = 0; __n < saves; __n++) edit(__config), __config.save();
+  __cpu = cpu() - __cpu;
+
+  Config __loaded;
+  __loaded.load();
+  if (__loaded.baud.value != __config.baud.value || __loaded.timeout.value != __config.timeout.value
+    || __loaded.retries.value != __config.retries.value || fabs(__loaded.setpoint.value - __config.setpoint.value) > 1e-4
+    || fabs(__loaded.gain.value - __config.gain.value) > 1e-4 || fabs(__loaded.offset.value - __config.offset.value) > 1e-4
+    || !(__loaded.flags.value == __config.flags.value)) {
+    printf("%s: reloaded configuration differs\n", aName);
+    exit(1);
+  }
+
+  printf("%s,%lu,%lu,%lu,%lu,%.1f,%.0f\n", aName, saves, (unsigned long)__config.size(), image.bytes_written(),
+    image.programming_time(), (double)image.programming_time() / saves, __cpu / saves);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("workload,saves,eeprom_bytes,bytes_written,programming_us,us_per_save,cpu_ns_per_save\n");
+  run<RawConfig>("codec.raw");
+  run<EncodedConfig>("codec.encoded");
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
@@ -0,0 +1,71 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark of event counters on the simulated EEPROM
+// ('erom::ImageDevice::native()'): a counter incremented and saved 100000
+// times as an 'Entry<uint32_t>', a 'WearLeveledEntry<uint32_t, 8>' and
+// 'MonotonicCounter's of several sizes. Prints one CSV line per counter:
+//   workload        - name, 'counter.<type>'
+//   increments      - increments saved
+//   eeprom_bytes    - EEPROM bytes the counter takes
+//   bytes_written   - EEPROM bytes programmed
+//   programming_us  - modelled EEPROM programming time
+//   us_per_increment - the same per increment
+//   max_wear        - most programming cycles taken by a single cell
+//   max_erases      - most erase cycles taken by a single cell
+//   lifetime_increments - increments until the most erased cell reaches
+//                    100000 erase cycles
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/counter.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o counter
+//   ./counter > counter.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static erom::ImageDevice &image = erom::ImageDevice::native();
+
+static const unsigned long increments = 100000;
+static const unsigned long endurance  = 100000;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Starts every counter from 0 on erased EEPROM, then counts. Exits if the
+// reloaded count is wrong
+
+template<class Counter> static void count(const char *aName, size_t aSize) {
+  memset(image.image(), 0xFF, image.size());
+  Counter __counter(0, 0);
+  __counter.save();
+  image.reset_stats();
+
+  for (unsigned long __n = 0; __n < increments; __n++) ++__counter, __counter.save();
+
+  Counter __loaded(0);
+  if (__loaded.value != increments) { printf("%s: loaded %lu\n", aName, (unsigned long)__loaded.value); exit(1); }
+
+  unsigned long __erases = image.max_erases();
+  printf("%s,%lu,%lu,%lu,%lu,%.1f,%lu,%lu,%.0f\n", aName, increments, (unsigned long)aSize,
+    image.bytes_written(), image.programming_time(), (double)image.programming_time() / increments,
+    image.max_wear(), __erases, __erases ? (double)endurance * increments / __erases : 0.);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("workload,increments,eeprom_bytes,bytes_written,programming_us,us_per_increment,max_wear,max_erases,lifetime_increments\n");
+  count<erom::Entry<uint32_t> >("counter.entry", sizeof(uint32_t));
+  count<erom::WearLeveledEntry<uint32_t, 8> >("counter.wear_leveled_8", erom::WearLeveledEntry<uint32_t, 8>::size);
+  count<erom::MonotonicCounter<4> >("counter.monotonic_4", erom::MonotonicCounter<4>::size);
+  count<erom::MonotonicCounter<16> >("counter.monotonic_16", erom::MonotonicCounter<16>::size);
+  count<erom::MonotonicCounter<64> >("counter.monotonic_64", erom::MonotonicCounter<64>::size);
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
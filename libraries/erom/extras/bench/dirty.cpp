@@ -0,0 +1,116 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark of the dirty tracking of 'Storage::save()', on a simulated
+// EEPROM ('erom::ImageDevice') counting the device operations 'Access'
+// issues. Storages of 1, 10 and 100 'int32_t' entries get 10000 saves,
+// each entry given a new value before a save with a chance of 1%. Saved
+// either by the default 'save()', which skips entries that did not change,
+// or comparing every entry against EEPROM ('save_entries(false)', what
+// 'save()' did before entries tracked their changes). The same edits are
+// replayed on both. Prints one CSV line per run:
+//   workload        - 'dirty.<tracked|compared>.<entries>'
+//   entries         - entries of the storage
+//   saves           - saves run
+//   changed         - entries changed over all saves
+//   reads_per_save  - device 'read()' calls per save
+//   bytes_read_per_save - bytes read per save
+//   writes_per_save - device 'write()' and 'program()' calls per save
+//   bytes_written   - EEPROM bytes programmed
+//
+// Exits with 1 if a reloaded value differs.
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/dirty.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o dirty
+//   ./dirty > dirty.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image counting the operations it gets
+class CountingImage : public erom::ImageDevice {
+public:
+  unsigned long read_ops, write_ops;
+
+  CountingImage(size_t aSize) : ImageDevice(NULL, aSize), read_ops(0), write_ops(0) { /* Do Nothing */ }
+
+  virtual void read(size_t aAddress, void *aData, size_t aSize) { read_ops++; ImageDevice::read(aAddress, aData, aSize); }
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) { write_ops++; ImageDevice::write(aAddress, aData, aSize); }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode aMode) { write_ops++; ImageDevice::program(aAddress, aValue, aMode); }
+
+  void reset_counts() { read_ops = write_ops = 0; reset_stats(); }
+};
+
+// Larger than the storages: 'Access' keeps the last byte out of range
+static CountingImage image(1024);
+static erom::Access eeprom(image);
+
+static const unsigned long saves = 10000;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+template<size_t Entries> class Config : public erom::Storage {
+private:
+  bool _compare;
+
+protected:
+  virtual void OnSave() { save_entries(!_compare); }
+
+public:
+  erom::Entry<int32_t> values[Entries];
+  Config(bool aCompare = false) : Storage(eeprom), _compare(aCompare) { for (size_t __i = 0; __i < Entries; __i++) issue(values[__i]); }
+};
+
+// Saves the first image on erased EEPROM and loads it back, then replays
+// the edits
+template<size_t Entries> static void run(bool aCompare) {
+  memset(image.image(), 0xFF, image.size());
+  randomSeed(1);
+  Config<Entries> __config(aCompare);
+  for (size_t __i = 0; __i < Entries; __i++) __config.values[__i] = (int32_t)__i;
+  __config.save();
+  __config.load();
+  image.reset_counts();
+
+  unsigned long __changed = 0;
+  for (unsigned long __n = 0; __n < saves; __n++) {
+    for (size_t __i = 0; __i < Entries; __i++)
+      if (random(100) == 0) __config.values[__i] = random(0x7FFFFFFFL), __changed++;
+    __config.save();
+  }
+
+  printf("dirty.%s.%lu,%lu,%lu,%lu,%.2f,%.2f,%.4f,%lu\n", aCompare ? "compared" : "tracked", (unsigned long)Entries, (unsigned long)Entries,
+    saves, __changed, (double)image.read_ops / saves, (double)image.bytes_read() / saves, (double)image.write_ops / saves, image.bytes_written());
+
+  Config<Entries> __loaded;
+  __loaded.load();
+  for (size_t __i = 0; __i < Entries; __i++)
+    if (__loaded.values[__i].value != __config.values[__i].value) {
+      printf("%s.%lu: reloaded value differs\n", aCompare ? "compared" : "tracked", (unsigned long)Entries);
+      exit(1);
+    }
+}
+
+template<size_t Entries> static void layout() {
+  run<Entries>(false);
+  run<Entries>(true);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("workload,entries,saves,changed,reads_per_save,bytes_read_per_save,writes_per_save,bytes_written\n");
+  layout<1>();
+  layout<10>();
+  layout<100>();
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
@@ -0,0 +1,178 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host power-cut sweep of 'KVStore' on a simulated EEPROM
+// ('erom::ImageDevice'). A store of 6 keys in 160 bytes (a 76 byte log per
+// half, compacted every few writes) gets 400 writes of random values of 1
+// to 6 bytes, one in 8 of them a removal. Every write is replayed from the
+// image it started from once per cell it programs, the supply cut before
+// that cell is programmed ('between') or while it is ('inside', the cell is
+// left erased). A fresh store then loads the image: the written key must
+// hold its previous or its new value, every other key its previous one,
+// otherwise the run stops with exit code 1. Prints one CSV line per run:
+//   mode             - 'between' or 'inside'
+//   writes           - writes replayed
+//   compactions      - writes which compacted the log
+//   cuts             - power cuts simulated
+//   compaction_cuts  - cuts during a compaction
+//   old              - reloads which found the previous value
+//   new              - reloads which found the new value
+//   broken           - reloads which found neither, always 0
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/kv.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o kv
+//   ./kv > kv.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image cutting the supply at the cell it is armed for: that cell is left
+// erased ('inside') or as it was ('between'), the cells after it are not
+// programmed. Counts the cells programmed since 'arm()'
+class CuttingImage : public erom::ImageDevice {
+private:
+  long _cut;        // Cells until the cut, negative when not armed
+  bool _inside;     // Cut while the cell is programmed
+  bool _off;        // Supply cut
+
+  // Returns true if the cell at 'aAddress' gets programmed
+  bool _cell(size_t aAddress) {
+    cells++;
+    if (_off) return false;
+    if (_cut < 0 || _cut--) return true;
+    _off = true;
+    if (_inside) image()[aAddress] = 0xFF;
+    return false;
+  }
+
+public:
+  unsigned long cells;
+
+  CuttingImage(size_t aSize) : ImageDevice(NULL, aSize), _cut(-1), _inside(false), _off(false), cells(0) { /* Do Nothing */ }
+
+  inline void arm(long aCut, bool aInside) { _cut = aCut, _inside = aInside, _off = false, cells = 0; }
+  inline void disarm() { _cut = -1, _off = false; }
+
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) {
+    for (size_t __i = 0; __i < aSize; __i++)
+      if (_cell(aAddress + __i)) ImageDevice::write(aAddress + __i, (const uint8_t*)aData + __i, 1);
+  }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode aMode) { if (_cell(aAddress)) ImageDevice::program(aAddress, aValue, aMode); }
+};
+
+// Larger than the store: 'Access' keeps the last byte out of range
+static CuttingImage image(256);
+static erom::Access eeprom(image);
+
+enum { keys = 6, region = 160, max_length = 6 };
+static const unsigned long writes = 400;
+
+typedef erom::KVStore<keys> Store;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Value of a key, length 0 if missing
+struct Value {
+  uint8_t length;
+  uint8_t bytes[max_length];
+};
+
+static bool stored(const Store &aStore, uint8_t aKey, const Value &aValue) {
+  uint8_t __bytes[max_length];
+  if (aStore.length(aKey) != aValue.length) return false;
+  return aStore.read(aKey, __bytes, sizeof(__bytes)) == aValue.length && !memcmp(__bytes, aValue.bytes, aValue.length);
+}
+
+// Checks every key but 'aKey' kept its value. Returns 0 if 'aKey' holds
+// 'aOld', 1 if it holds 'aNew', -1 otherwise
+static int reload(const Value *aValues, uint8_t aKey, const Value &aOld, const Value &aNew) {
+  Store __store(eeprom, 0, region);
+  if (!__store.load()) return -1;
+  for (uint8_t __key = 0; __key < keys; __key++)
+    if (__key != aKey && !stored(__store, __key, aValues[__key])) return -1;
+  return stored(__store, aKey, aOld) ? 0 : stored(__store, aKey, aNew) ? 1 : -1;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static void run(bool aInside) {
+  static uint8_t __before[256];
+  unsigned long __compactions = 0, __cuts = 0, __compaction_cuts = 0, __old = 0, __new = 0;
+  Value __values[keys];
+
+  memset(image.image(), 0xFF, image.size());
+  memset(__values, 0, sizeof(__values));
+  randomSeed(1);
+  {
+    Store __store(eeprom, 0, region);
+    __store.load();
+  }
+
+  for (unsigned long __write = 0; __write < writes; __write++) {
+    uint8_t __key = random(keys);
+    Value __next;
+    __next.length = random(8) ? random(1, max_length + 1) : 0;
+    for (int __i = 0; __i < max_length; __i++) __next.bytes[__i] = __i < __next.length ? random(256) : 0;
+    memcpy(__before, image.image(), image.size());
+
+    // Cells the compaction of this write programs, if it needs one
+    long __compaction = 0;
+    {
+      Store __store(eeprom, 0, region);
+      __store.load();
+      bool __removes_missing = !__next.length && !__store.contains(__key);
+      if (!__removes_missing && __store.used() + Store::record_overhead + __next.length > __store.capacity()) {
+        image.arm(-1, false);
+        __store.compact();
+        __compaction = image.cells;
+        __compactions++;
+      }
+    }
+
+    for (long __cut = 0; ; __cut++) {
+      memcpy(image.image(), __before, image.size());
+      Store __store(eeprom, 0, region);
+      __store.load();
+      image.arm(__cut, aInside);
+      if (!__store.write(__key, __next.bytes, __next.length)) {
+        printf("%s: write %lu does not fit\n", aInside ? "inside" : "between", __write);
+        exit(1);
+      }
+      bool __cut_short = __cut < (long)image.cells;
+      image.disarm();
+      if (!__cut_short) break;
+
+      __cuts++;
+      if (__cut < __compaction) __compaction_cuts++;
+      int __found = reload(__values, __key, __values[__key], __next);
+      if (__found == 0) __old++;
+      else if (__found == 1) __new++;
+      else {
+        printf("%s: write %lu of key %u cut at cell %ld of %lu%s loads a broken store\n", aInside ? "inside" : "between",
+          __write, __key, __cut, image.cells, __cut < __compaction ? " (compacting)" : "");
+        exit(1);
+      }
+    }
+    __values[__key] = __next;
+  }
+
+  printf("%s,%lu,%lu,%lu,%lu,%lu,%lu,0\n", aInside ? "inside" : "between", writes, __compactions, __cuts, __compaction_cuts, __old, __new);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("mode,writes,compactions,cuts,compaction_cuts,old,new,broken\n");
+  run(false);
+  run(true);
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
@@ -0,0 +1,182 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host check and benchmark of the compile-time 'Layout' and 'StaticEntry'.
+// Checks the addresses of packed, aligned and chained layouts, that a
+// 'StaticEntry' takes the RAM of its value only, and that its values
+// persist. Then loads and saves the fields of the layout of the 'Layout'
+// example ('uint16_t', 'int32_t', 'float' aligned to 4) 1000 times, as
+// 'StaticEntry' and as 'Entry' of a 'Storage', on a simulated EEPROM
+// ('erom::ImageDevice') counting the device operations. Prints one CSV line
+// per run:
+//   workload        - 'layout.<static_entry|entry>'
+//   ram_bytes       - RAM taken by the three entries (and their storage)
+//   reads_per_load  - device 'read()' calls per load of the three fields
+//   writes_per_save - device 'write()' and 'program()' calls per save of
+//                     the three fields, every byte changed
+//
+// Exits with 1 if an address, a size or a reloaded value is wrong.
+//
+// Layouts which must not compile are built when asked, the build has to
+// fail for each of them:
+//   -DEROM_DEVICE_MEMORY_SIZE=64 -DLAYOUT_OVERSIZED  - layout past the EEPROM
+//   -DLAYOUT_BAD_INDEX                               - field out of range
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/layout.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o layout
+//   ./layout > layout.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image counting the operations it gets
+class CountingImage : public erom::ImageDevice {
+public:
+  unsigned long read_ops, write_ops;
+
+  CountingImage(size_t aSize) : ImageDevice(NULL, aSize), read_ops(0), write_ops(0) { /* Do Nothing */ }
+
+  virtual void read(size_t aAddress, void *aData, size_t aSize) { read_ops++; ImageDevice::read(aAddress, aData, aSize); }
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) { write_ops++; ImageDevice::write(aAddress, aData, aSize); }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode aMode) { write_ops++; ImageDevice::program(aAddress, aValue, aMode); }
+
+  void reset_counts() { read_ops = write_ops = 0; reset_stats(); }
+};
+
+// Larger than the layouts: 'Access' keeps the last byte out of range
+static CountingImage image(256);
+static erom::Access eeprom(image);
+
+static const unsigned long runs = 1000;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+struct Name { char text[16]; };
+
+typedef erom::Layout<0, uint16_t, int32_t, erom::Aligned<float, 4> > Schema;
+typedef erom::Layout<Schema::end, uint8_t, erom::Aligned<uint32_t, 8>, Name> Chained;
+typedef erom::Layout<3, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t> Full;
+
+#ifdef LAYOUT_OVERSIZED
+typedef erom::Layout<0, Name, Name, Name, Name, Name> Oversized;  // 80 bytes
+static Oversized::field<0>::type oversized;
+#endif
+#ifdef LAYOUT_BAD_INDEX
+static erom::StaticEntry<Schema, 3> bad_index;
+#endif
+
+class Config : public erom::Storage {
+public:
+  erom::Entry<uint16_t> boots;
+  erom::Entry<int32_t> uptime;
+  erom::Entry<float> temperature;
+  Config() : Storage(eeprom) { issue(boots); issue(uptime); issue(temperature); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static void check(const char *aWhat, unsigned long aValue, unsigned long aExpected) {
+  if (aValue == aExpected) return;
+  printf("%s: %lu, expected %lu\n", aWhat, aValue, aExpected);
+  exit(1);
+}
+
+static void addresses() {
+  check("Schema::field<0>::address", Schema::field<0>::address, 0);
+  check("Schema::field<1>::address", Schema::field<1>::address, 2);
+  check("Schema::field<2>::address", Schema::field<2>::address, 8);
+  check("Schema::end", Schema::end, 12);
+  check("Schema::fields", Schema::fields, 3);
+  check("Chained::field<0>::address", Chained::field<0>::address, 12);
+  check("Chained::field<1>::address", Chained::field<1>::address, 16);
+  check("Chained::field<2>::address", Chained::field<2>::address, 20);
+  check("Chained::size", Chained::size, 24);
+  check("Full::field<7>::address", Full::field<7>::address, 10);
+  check("Full::end", Full::end, 11);
+  check("sizeof(StaticEntry<Schema, 0>)", sizeof(erom::StaticEntry<Schema, 0>), sizeof(uint16_t));
+  check("sizeof(StaticEntry<Chained, 2>)", sizeof(erom::StaticEntry<Chained, 2>), sizeof(Name));
+}
+
+static void persistence() {
+  memset(image.image(), 0xFF, image.size());
+  {
+    erom::StaticEntry<Schema, 1> __uptime((int32_t)0x12345678L);
+    erom::StaticEntry<Chained, 2> __name;
+    strcpy(__name.value.text, "erom");
+    __uptime.save(false, eeprom);
+    __name.save(true, eeprom);
+  }
+  erom::StaticEntry<Schema, 1> __uptime;
+  erom::StaticEntry<Chained, 2> __name;
+  __uptime.load(eeprom);
+  __name.load(eeprom);
+  check("reloaded uptime", (unsigned long)__uptime.value, 0x12345678UL);
+  check("reloaded name", strcmp(__name.value.text, "erom"), 0);
+  int32_t __stored;
+  memcpy(&__stored, image.image() + Schema::field<1>::address, sizeof(__stored));
+  check("uptime in EEPROM", (unsigned long)__stored, 0x12345678UL);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static void static_entries() {
+  memset(image.image(), 0xFF, image.size());
+  erom::StaticEntry<Schema, 0> __boots;
+  erom::StaticEntry<Schema, 1> __uptime;
+  erom::StaticEntry<Schema, 2> __temperature;
+  unsigned long __reads = 0, __writes = 0;
+  for (unsigned long __n = 0; __n < runs; __n++) {
+    image.reset_counts();
+    __boots.load(eeprom); __uptime.load(eeprom); __temperature.load(eeprom);
+    __reads += image.read_ops;
+
+    __boots = (uint16_t)(__boots.value ^ 0xFFFF);
+    __uptime = (int32_t)(__uptime.value ^ 0x7FFFFFFFL);
+    __temperature = (float)__n + 0.5f;
+    image.reset_counts();
+    __boots.save(true, eeprom); __uptime.save(true, eeprom); __temperature.save(true, eeprom);
+    __writes += image.write_ops;
+  }
+  printf("layout.static_entry,%lu,%.2f,%.2f\n", (unsigned long)(sizeof(__boots) + sizeof(__uptime) + sizeof(__temperature)),
+    (double)__reads / runs, (double)__writes / runs);
+}
+
+static void entries() {
+  memset(image.image(), 0xFF, image.size());
+  Config __config;
+  unsigned long __reads = 0, __writes = 0;
+  for (unsigned long __n = 0; __n < runs; __n++) {
+    image.reset_counts();
+    __config.load();
+    __reads += image.read_ops;
+
+    __config.boots = (uint16_t)(__config.boots.value ^ 0xFFFF);
+    __config.uptime = (int32_t)(__config.uptime.value ^ 0x7FFFFFFFL);
+    __config.temperature = (float)__n + 0.5f;
+    image.reset_counts();
+    __config.boots.save(true); __config.uptime.save(true); __config.temperature.save(true);
+    __writes += image.write_ops;
+  }
+  printf("layout.entry,%lu,%.2f,%.2f\n", (unsigned long)sizeof(Config), (double)__reads / runs, (double)__writes / runs);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  addresses();
+  persistence();
+
+  printf("workload,ram_bytes,reads_per_load,writes_per_save\n");
+  static_entries();
+  entries();
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
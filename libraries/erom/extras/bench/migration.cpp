@@ -0,0 +1,276 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host test of 'VerifiedStorage' migrations on the simulated EEPROM
+// ('erom::ImageDevice::native()'): four firmware versions of the same
+// settings, upgraded one after another (fields grow, move over each other,
+// get added, and the checksum is switched on, which shifts everything by 2
+// bytes; the last one only appends a field) and from the first straight to
+// the last. Each upgrade runs from
+// the same random data 'trials' times, once migrated and once cleared as
+// before ('clear()', which also saves). Exits with an error if a migrated
+// value is wrong or does not load verified. Prints one CSV line per upgrade:
+//   upgrade         - versions, '<from>-<to>'
+//   trials          - upgrades simulated
+//   migrate_bytes, clear_bytes - EEPROM bytes programmed per upgrade
+//   migrate_us, clear_us       - modelled programming time per upgrade
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/migration.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o migration
+//   ./migration > migration.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static erom::ImageDevice &image = erom::ImageDevice::native();
+
+static const unsigned long trials = 200;
+static const uint16_t settings_app_id = 0x5E77;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Names, which grow in version 3
+
+struct Name8  { char text[8]; };
+struct Name12 { char text[12]; };
+
+inline void migrate_value(Name12 &aTo, const Name8 &aFrom) { memcpy(aTo.text, aFrom.text, sizeof(aFrom.text)); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Version 1: boot count, a 16-bit trim, an 8 char name and a total
+typedef erom::Layout<8, uint16_t, int16_t, Name8, long> LayoutV1;
+
+// Version 2: the trim grows to 32 bits, a gain is added after the name
+typedef erom::Layout<8, uint16_t, long, Name8, float, long> LayoutV2;
+
+class SettingsV2 : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() {
+    erom::VerifiedStorage::OnClear();
+    memset(&name.value, 0, sizeof(name.value)); strcpy(name.value.text, "unit"); name.touch();
+    boots = 0; trim = 0; gain = 1.f; total = 0;
+  }
+
+  virtual bool OnMigrate(uint16_t aVersion) {
+    if (aVersion != 1) return false;
+    migrate<LayoutV1, 0>(boots); migrate<LayoutV1, 1>(trim); migrate<LayoutV1, 2>(name); migrate<LayoutV1, 3>(total);
+    return true;
+  }
+
+public:
+  erom::Entry<uint16_t> boots;
+  erom::Entry<long> trim;
+  erom::Entry<Name8> name;
+  erom::Entry<float> gain;
+  erom::Entry<long> total;
+
+  SettingsV2() : VerifiedStorage(settings_app_id, 2) { issue(boots); issue(trim); issue(name); issue(gain); issue(total); }
+};
+
+// Version 3: the name grows to 12 chars and moves first, the boot count
+// grows to 32 bits
+typedef erom::Layout<8, Name12, uint32_t, long, float, long> LayoutV3;
+
+class SettingsV3 : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() {
+    erom::VerifiedStorage::OnClear();
+    memset(&name.value, 0, sizeof(name.value)); strcpy(name.value.text, "unit"); name.touch();
+    boots = 0; trim = 0; gain = 1.f; total = 0;
+  }
+
+  virtual bool OnMigrate(uint16_t aVersion) {
+    switch (aVersion) {
+      case 1: migrate<LayoutV1, 0>(boots); migrate<LayoutV1, 1>(trim); migrate<LayoutV1, 2>(name); migrate<LayoutV1, 3>(total); return true;
+      case 2: migrate<LayoutV2, 0>(boots); migrate<LayoutV2, 1>(trim); migrate<LayoutV2, 2>(name); migrate<LayoutV2, 3>(gain); migrate<LayoutV2, 4>(total); return true;
+      default: return false;
+    }
+  }
+
+public:
+  erom::Entry<Name12> name;
+  erom::Entry<uint32_t> boots;
+  erom::Entry<long> trim;
+  erom::Entry<float> gain;
+  erom::Entry<long> total;
+
+  SettingsV3() : VerifiedStorage(settings_app_id, 3) { issue(name); issue(boots); issue(trim); issue(gain); issue(total); }
+};
+
+// Version 4: checksum on (entries start at 10), a mode byte is added
+class SettingsV4 : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() {
+    erom::VerifiedStorage::OnClear();
+    memset(&name.value, 0, sizeof(name.value)); strcpy(name.value.text, "unit"); name.touch();
+    boots = 0; trim = 0; gain = 1.f; total = 0; mode = 3;
+  }
+
+  virtual bool OnMigrate(uint16_t aVersion) {
+    switch (aVersion) {
+      case 1: migrate<LayoutV1, 0>(boots); migrate<LayoutV1, 1>(trim); migrate<LayoutV1, 2>(name); migrate<LayoutV1, 3>(total); return true;
+      case 2: migrate<LayoutV2, 0>(boots); migrate<LayoutV2, 1>(trim); migrate<LayoutV2, 2>(name); migrate<LayoutV2, 3>(gain); migrate<LayoutV2, 4>(total); return true;
+      case 3: migrate<LayoutV3, 0>(name); migrate<LayoutV3, 1>(boots); migrate<LayoutV3, 2>(trim); migrate<LayoutV3, 3>(gain); migrate<LayoutV3, 4>(total); return true;
+      default: return false;
+    }
+  }
+
+public:
+  erom::Entry<Name12> name;
+  erom::Entry<uint32_t> boots;
+  erom::Entry<long> trim;
+  erom::Entry<float> gain;
+  erom::Entry<long> total;
+  erom::Entry<uint8_t> mode;
+
+  SettingsV4() : VerifiedStorage(settings_app_id, 4, true) { issue(name); issue(boots); issue(trim); issue(gain); issue(total); issue(mode); }
+};
+
+// Version 5: a limit is appended, nothing moves
+
+class SettingsV5 : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() {
+    erom::VerifiedStorage::OnClear();
+    memset(&name.value, 0, sizeof(name.value)); strcpy(name.value.text, "unit"); name.touch();
+    boots = 0; trim = 0; gain = 1.f; total = 0; mode = 3; limit = 1000;
+  }
+
+  virtual bool OnMigrate(uint16_t aVersion) {
+    switch (aVersion) {
+      case 1: migrate<LayoutV1, 0>(boots); migrate<LayoutV1, 1>(trim); migrate<LayoutV1, 2>(name); migrate<LayoutV1, 3>(total); return true;
+      case 2: migrate<LayoutV2, 0>(boots); migrate<LayoutV2, 1>(trim); migrate<LayoutV2, 2>(name); migrate<LayoutV2, 3>(gain); migrate<LayoutV2, 4>(total); return true;
+      case 3: migrate<LayoutV3, 0>(name); migrate<LayoutV3, 1>(boots); migrate<LayoutV3, 2>(trim); migrate<LayoutV3, 3>(gain); migrate<LayoutV3, 4>(total); return true;
+      case 4: name.load(); boots.load(); trim.load(); gain.load(); total.load(); mode.load(); return true;
+      default: return false;
+    }
+  }
+
+public:
+  erom::Entry<Name12> name;
+  erom::Entry<uint32_t> boots;
+  erom::Entry<long> trim;
+  erom::Entry<float> gain;
+  erom::Entry<long> total;
+  erom::Entry<uint8_t> mode;
+  erom::Entry<uint16_t> limit;
+
+  SettingsV5() : VerifiedStorage(settings_app_id, 5, true) { issue(name); issue(boots); issue(trim); issue(gain); issue(total); issue(mode); issue(limit); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Field data every version must keep
+
+struct Data {
+  uint16_t boots;
+  int16_t trim;
+  char name[8];
+  long total;
+  float gain;
+};
+
+static void fail(const char *aUpgrade, const char *aWhat) {
+  printf("%s: %s\n", aUpgrade, aWhat);
+  exit(1);
+}
+
+// Stores 'aData' as version 1
+static void store_v1(const Data &aData) {
+  erom::access.write_long(0, erom::VerifiedStorage::storage_header_value);
+  erom::access.write_int(4, settings_app_id), erom::access.write_int(6, 1);
+  erom::access.write_block(LayoutV1::field<0>::address, aData.boots);
+  erom::access.write_block(LayoutV1::field<1>::address, aData.trim);
+  erom::access.write_block(LayoutV1::field<2>::address, aData.name);
+  erom::access.write_block(LayoutV1::field<3>::address, aData.total);
+}
+
+// Checks the common fields of a loaded version
+template<class Settings> static void check(const char *aUpgrade, Settings &aSettings, const Data &aData, float aGain) {
+  if (aSettings.boots.value != aData.boots) fail(aUpgrade, "boots");
+  if (aSettings.trim.value != aData.trim) fail(aUpgrade, "trim");
+  if (strcmp(aSettings.name.value.text, aData.name)) fail(aUpgrade, "name");
+  if (aSettings.total.value != aData.total) fail(aUpgrade, "total");
+  if (aSettings.gain.value != aGain) fail(aUpgrade, "gain");
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Upgrades what EEPROM holds to 'To', migrated and cleared, and leaves the
+// migrated image
+
+struct Totals {
+  unsigned long migrate_bytes, clear_bytes, migrate_us, clear_us;
+};
+
+template<class To> static void upgrade(const char *aUpgrade, const Data &aData, float aGain, Totals &aTotals) {
+  static uint8_t __before[1024];
+  memcpy(__before, image.image(), image.size());
+
+  image.reset_stats();
+  { To __cleared; __cleared.clear(); }
+  aTotals.clear_bytes += image.bytes_written(), aTotals.clear_us += image.programming_time();
+
+  memcpy(image.image(), __before, image.size());
+  image.reset_stats();
+  To __migrated;
+  if (!__migrated.load_verified(true)) fail(aUpgrade, "not verified after migration");
+  aTotals.migrate_bytes += image.bytes_written(), aTotals.migrate_us += image.programming_time();
+  check(aUpgrade, __migrated, aData, aGain);
+
+  To __loaded;
+  if (!__loaded.load_verified()) fail(aUpgrade, "does not load verified");
+  check(aUpgrade, __loaded, aData, aGain);
+}
+
+static void report(const char *aUpgrade, const Totals &aTotals) {
+  printf("%s,%lu,%lu,%lu,%lu,%lu\n", aUpgrade, trials, aTotals.migrate_bytes / trials, aTotals.clear_bytes / trials,
+    aTotals.migrate_us / trials, aTotals.clear_us / trials);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  randomSeed(1);
+  image.reset_stats();
+  Totals __totals[5];
+  memset(__totals, 0, sizeof(__totals));
+
+  for (unsigned long __trial = 0; __trial < trials; __trial++) {
+    Data __data;
+    __data.boots = random(65536);
+    __data.trim = random(-32768, 32768);
+    memset(__data.name, 0, sizeof(__data.name));
+    for (long __i = random(1, 8); __i > 0; __i--) __data.name[__i - 1] = random('a', 'z' + 1);
+    __data.total = random(-2147483647L, 2147483647L);
+    __data.gain = 1.f;
+
+    memset(image.image(), 0xFF, image.size());
+    store_v1(__data);
+    upgrade<SettingsV2>("1-2", __data, 1.f, __totals[0]);
+
+    // The gain is set in version 2 and has to be kept from then on
+    { SettingsV2 __v2; __v2.load(); __v2.gain = 0.5f; __v2.save(); }
+    upgrade<SettingsV3>("2-3", __data, .5f, __totals[1]);
+    upgrade<SettingsV4>("3-4", __data, .5f, __totals[2]);
+    upgrade<SettingsV5>("4-5", __data, .5f, __totals[3]);
+
+    memset(image.image(), 0xFF, image.size());
+    store_v1(__data);
+    upgrade<SettingsV5>("1-5", __data, 1.f, __totals[4]);
+  }
+
+  printf("upgrade,trials,migrate_bytes,clear_bytes,migrate_us,clear_us\n");
+  report("1-2", __totals[0]);
+  report("2-3", __totals[1]);
+  report("3-4", __totals[2]);
+  report("4-5", __totals[3]);
+  report("1-5", __totals[4]);
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
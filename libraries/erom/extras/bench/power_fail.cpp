@@ -0,0 +1,187 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host simulation of a brown-out while saving: random changes to a storage
+// of four entries of different priority, then the supply of the simulated
+// EEPROM ('erom::ImageDevice') is cut after N microseconds of programming
+// while either 'save()' (entries in issue order, the most important last)
+// or 'flush(N)' (by priority within the hold-up time) runs, or 'save()' is
+// preempted a few cells in by the brown-out interrupt calling 'flush(N)'.
+// The interrupt then waits for the supply to die ('preempt') or it recovers
+// and the save resumes ('recover'). The storage is then reloaded and
+// checked. Prints one CSV line per run:
+//   policy       - 'save', 'flush', 'preempt' or 'recover', '+crc' with the
+//                  'VerifiedStorage' checksum enabled
+//   cutoff_us    - hold-up time, also the budget given to 'flush()'
+//   trials       - power losses simulated
+//   p3..p0_saved - percentage of changed entries of priority 3 (highest)
+//                  to 0 found with their new value after reload
+//   torn         - entries holding neither their old nor their new value
+//   valid_loads  - percentage of reloads 'load_verified()' accepted
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/power_fail.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o power_fail
+//   ./power_fail > power_fail.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image raising the brown-out interrupt before the cell it is armed for:
+// the supply is cut after the hold-up time and 'flush()' runs. Then the
+// interrupt waits for the supply to die, or it recovers
+class BrownOutImage : public erom::ImageDevice {
+private:
+  erom::Storage *_storage;
+  unsigned long _cells, _hold_up;   // Cells programmed until the interrupt
+  bool _recover;
+
+  void _interrupt() {
+    if (!_storage || _cells--) return;
+    erom::Storage *__storage = _storage;
+    _storage = NULL;
+    power_off(_hold_up);
+    __storage->flush(_hold_up);
+    if (_recover) power_on();
+    else power_off(0);
+  }
+
+public:
+  BrownOutImage(size_t aSize) : ImageDevice(NULL, aSize), _storage(NULL), _cells(0), _hold_up(0), _recover(false) { /* Do Nothing */ }
+
+  inline void arm(erom::Storage &aStorage, unsigned long aCells, unsigned long aHoldUp, bool aRecover) { _storage = &aStorage, _cells = aCells, _hold_up = aHoldUp, _recover = aRecover; }
+  inline void disarm() { _storage = NULL; }
+
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) {
+    for (size_t __i = 0; __i < aSize; __i++) _interrupt(), ImageDevice::write(aAddress + __i, (const uint8_t*)aData + __i, 1);
+  }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode aMode) { _interrupt(); ImageDevice::program(aAddress, aValue, aMode); }
+};
+
+// Larger than the storage: 'Access' keeps the last byte out of range
+static BrownOutImage image(2048);
+static erom::Access eeprom(image);
+
+static const unsigned long trials = 500;
+static const unsigned long cutoffs[] = { 5000, 10000, 20000, 40000, 80000 };
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Machine state: settings (priority 0), statistics (1), odometer (2) and the
+// position (3), issued in that order
+
+struct Settings { uint8_t bytes[16]; };
+struct Statistics { uint8_t bytes[24]; };
+
+class MachineStorage : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() {
+    erom::VerifiedStorage::OnClear();
+    memset(&settings.value, 0, sizeof(Settings)); settings.touch();
+    memset(&statistics.value, 0, sizeof(Statistics)); statistics.touch();
+    odometer = 0; position = 0;
+  }
+
+public:
+  erom::Entry<Settings> settings;
+  erom::Entry<Statistics> statistics;
+  erom::WearLeveledEntry<long, 4> odometer;
+  erom::Entry<long> position;
+
+  MachineStorage(bool aChecksum) : VerifiedStorage(eeprom, 0xB0D0, 0x0001, aChecksum) {
+    issue(settings); issue(statistics); issue(odometer); issue(position);
+    statistics.priority(1); odometer.priority(2); position.priority(3);
+  }
+
+  inline erom::EntryBase &entry(int aPriority) {
+    switch (aPriority) {
+      case 0:  return settings;
+      case 1:  return statistics;
+      case 2:  return odometer;
+      default: return position;
+    }
+  }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Raw RAM value of an entry, to compare entries of any type
+
+static const void *value_of(MachineStorage &aStorage, int aPriority, size_t &aSize) {
+  switch (aPriority) {
+    case 0:  aSize = sizeof(Settings);   return &aStorage.settings.value;
+    case 1:  aSize = sizeof(Statistics); return &aStorage.statistics.value;
+    case 2:  aSize = sizeof(long);       return &aStorage.odometer.value;
+    default: aSize = sizeof(long);       return &aStorage.position.value;
+  }
+}
+
+static void change(MachineStorage &aStorage, int aPriority) {
+  size_t __size;
+  uint8_t *__value = (uint8_t*)value_of(aStorage, aPriority, __size);
+  for (long __n = random(1, __size < 8 ? __size + 1 : 9); __n > 0; __n--) __value[random(__size)] ^= (uint8_t)random(1, 256);
+  aStorage.entry(aPriority).touch();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+enum Policy { Save, Flush, Preempt, Recover };
+
+static void run(Policy aPolicy, bool aChecksum, unsigned long aCutoff) {
+  unsigned long __changed[4] = { 0 }, __saved[4] = { 0 }, __torn = 0, __valid = 0;
+
+  for (unsigned long __trial = 0; __trial < trials; __trial++) {
+    memset(image.image(), 0xFF, image.size());
+    MachineStorage __storage(aChecksum);
+    __storage.clear();
+
+    // Old values are what the storage holds now, new ones what it is told
+    MachineStorage __old(aChecksum);
+    __old.load();
+    bool __dirty[4];
+    for (int __p = 0; __p < 4; __p++) {
+      __dirty[__p] = __p == 3 || random(2);
+      if (__dirty[__p]) change(__storage, __p), __changed[__p]++;
+    }
+
+    if (aPolicy == Flush) image.power_off(aCutoff), __storage.flush(aCutoff);
+    else if (aPolicy >= Preempt) image.arm(__storage, random(8), aCutoff, aPolicy == Recover), __storage.save();
+    else image.power_off(aCutoff), __storage.save();
+    image.disarm();
+    image.power_on();
+
+    MachineStorage __loaded(aChecksum);
+    if (__loaded.load_verified()) __valid++;
+    for (int __p = 0; __p < 4; __p++) {
+      size_t __size;
+      const void *__new = value_of(__storage, __p, __size), *__was = value_of(__old, __p, __size);
+      const void *__now = value_of(__loaded, __p, __size);
+      if (!memcmp(__now, __new, __size)) { if (__dirty[__p]) __saved[__p]++; }
+      else if (memcmp(__now, __was, __size)) __torn++;
+    }
+  }
+
+  static const char *__names[] = { "save", "flush", "preempt", "recover" };
+  printf("%s%s,%lu,%lu", __names[aPolicy], aChecksum ? "+crc" : "", aCutoff, trials);
+  for (int __p = 3; __p >= 0; __p--) printf(",%lu", __changed[__p] ? __saved[__p] * 100 / __changed[__p] : 100);
+  printf(",%lu,%lu\n", __torn, __valid * 100 / trials);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  randomSeed(1);
+
+  printf("policy,cutoff_us,trials,p3_saved,p2_saved,p1_saved,p0_saved,torn,valid_loads\n");
+  for (int __checksum = 0; __checksum < 2; __checksum++)
+    for (int __policy = Save; __policy <= Recover; __policy++)
+      for (size_t __i = 0; __i < sizeof(cutoffs) / sizeof(cutoffs[0]); __i++)
+        run((Policy)__policy, __checksum, cutoffs[__i]);
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
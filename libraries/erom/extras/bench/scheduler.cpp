@@ -0,0 +1,164 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host simulation of saving policies for the bundled examples: a day of
+// 'loop()' running every millisecond against the simulated EEPROM
+// ('erom::ImageDevice::native()'), saved either after a fixed delay (what
+// the examples do) or by an 'erom::SaveScheduler' budgeted for 10 years of
+// 100000 cycle cells. Prints one CSV line per run:
+//   workload       - name, '<example>.<policy>'
+//   saves          - saves that wrote something
+//   bytes_written  - EEPROM bytes written
+//   max_wear       - most programming cycles taken by a single cell
+//   lifetime_days  - days until the hottest cell reaches 100000 cycles at
+//                    the simulated wear rate
+//   max_window_s   - longest time a change waited to be saved, i.e. the data
+//                    lost at worst by a power loss
+//   critical_window_ms - same for the changes of a critical entry, 'NA'
+//                    where the workload has none
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/scheduler.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o scheduler
+//   ./scheduler > scheduler.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static erom::ImageDevice &image = erom::ImageDevice::native();
+
+static const unsigned long simulated_ms = 24UL * 3600 * 1000;
+static const unsigned long endurance    = erom::SaveScheduler::DefaultEndurance;
+static const unsigned int  years        = 10;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Tracks how long changes wait to be saved: 'change()' when the value
+// changes in RAM, 'saved()' after every save
+class Window {
+private:
+  unsigned long _since, _max;
+  bool _pending;
+
+public:
+  Window() : _since(0), _max(0), _pending(false) { /* Do Nothing */ }
+
+  inline void change() { if (!_pending) _since = millis(), _pending = true; }
+  inline void saved() { if (_pending && millis() - _since > _max) _max = millis() - _since; _pending = false; }
+  inline unsigned long max() const { return _max; }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static void report(const char *aName, unsigned long aSaves, const Window &aWindow, const Window *aCritical) {
+  unsigned long __wear = image.max_wear();
+  unsigned long __days = __wear ? endurance / __wear : 0xFFFFFFFFUL;
+  printf("%s,%lu,%lu,%lu,%lu,%lu,", aName, aSaves, image.bytes_written(), __wear, __days, aWindow.max() / 1000);
+  if (aCritical) printf("%lu\n", aCritical->max());
+  else printf("NA\n");
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static void erase() { memset(image.image(), 0xFF, image.size()); image.reset_stats(); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'Storage_Postpone_Save' example: two analog values recorded every
+// millisecond, plus an alarm flag raised or cleared every 2 hours that must
+// survive a power loss
+
+class PostponeStorage : public erom::Storage {
+protected:
+  virtual void OnSave() { saves++; erom::Storage::OnSave(); }
+
+public:
+  erom::Entry<int> A0, A1;
+  erom::Entry<uint8_t> alarm;
+  unsigned long saves;
+
+  PostponeStorage() : saves(0) { issue(A0); issue(A1); issue(alarm); alarm.critical(true); }
+};
+
+static void storage_postpone_save(const char *aName, bool aScheduled) {
+  PostponeStorage __storage;
+  erom::SaveScheduler __scheduler(__storage, years, endurance);
+  Window __window, __critical;
+  unsigned long __writes = 0;
+  __storage.load();
+  image.reset_stats();
+
+  for (unsigned long __n = 0; __n < simulated_ms; __n++) {
+    __storage.A0 = analogRead(A0);
+    __storage.A1 = analogRead(A1);
+    __window.change();
+    if (__n % 7200000UL == 0) __storage.alarm = !__storage.alarm.value, __critical.change();
+
+    unsigned long __written = image.bytes_written();
+    if (aScheduled) __scheduler.tick();
+    else __storage.postpone_save(30000), __storage.tick();
+    if (image.bytes_written() != __written) {
+      __writes++;
+      if (!__storage.dirty()) __window.saved(), __critical.saved();
+    }
+    host_advance_clock(1000);
+  }
+  report(aName, __writes, __window, &__critical);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// 'VerifiedStorage_Uptime' example: uptime counted every millisecond into a
+// wear leveled entry. The scheduler is given no leveling credit, as the
+// 'VerifiedStorage' checksum may change with every save
+
+class UptimeStorage : public erom::VerifiedStorage {
+protected:
+  virtual void OnClear() { erom::VerifiedStorage::OnClear(); uptime = 0; }
+
+public:
+  erom::WearLeveledEntry<long, 8> uptime;
+  UptimeStorage() : VerifiedStorage(0xFFF1, 0x0001) { issue(uptime); }
+};
+
+static void verified_storage_uptime(const char *aName, bool aScheduled) {
+  UptimeStorage __storage;
+  erom::SaveScheduler __scheduler(__storage, years, endurance);
+  Window __window;
+  unsigned long __writes = 0, __last_time = millis(), __update_time = millis();
+  __storage.verify(true);
+  __storage.load();
+  image.reset_stats();
+
+  for (unsigned long __n = 0; __n < simulated_ms; __n++) {
+    unsigned long __millis = millis(), __written = image.bytes_written();
+    __storage.uptime += __millis - __last_time;
+    __last_time = __millis;
+    __window.change();
+
+    if (aScheduled) __scheduler.tick();
+    else if ((long)(__millis - __update_time) >= 0) __storage.save(), __update_time = __millis + 15000;
+    if (image.bytes_written() != __written) __writes++, __window.saved();
+    host_advance_clock(1000);
+  }
+  report(aName, __writes, __window, NULL);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  host_advance_clock(0);  // Sketch time only moves when told so
+  randomSeed(1);
+
+  printf("workload,saves,bytes_written,max_wear,lifetime_days,max_window_s,critical_window_ms\n");
+  erase(); storage_postpone_save("storage_postpone_save.fixed_30s", false);
+  erase(); storage_postpone_save("storage_postpone_save.scheduler", true);
+  erase(); verified_storage_uptime("verified_storage_uptime.fixed_15s", false);
+  erase(); verified_storage_uptime("verified_storage_uptime.scheduler", true);
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
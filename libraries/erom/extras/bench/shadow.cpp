@@ -0,0 +1,140 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark of 'ShadowStorage' against a plain 'Storage' of the same
+// entries, on a simulated EEPROM ('erom::ImageDevice') counting the device
+// operations 'Access' issues. Layouts of 256 bytes (64 'int32_t' entries)
+// and 4 KB (1024 entries) get 1000 saves each of two workloads:
+//   sparse  - 8 random entries assigned new values before every save
+//   touched - every entry assigned, as from a settings struct kept
+//             elsewhere, 8 of them to new values
+// The same edits are replayed on both storages. Prints one CSV line per run:
+//   workload         - name, 'shadow.<storage|shadow>.<sparse|touched>'
+//   layout_bytes     - EEPROM bytes issued to the entries
+//   saves            - edits saved
+//   read_ops         - device 'read()' calls
+//   read_bytes       - bytes read from the device
+//   write_ops        - device 'write()' and 'program()' calls
+//   bytes_written    - EEPROM bytes programmed
+//   reads_per_save   - 'read_ops' per save
+//   writes_per_save  - 'write_ops' per save
+//   cpu_ns_per_save  - host CPU time per save
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/shadow.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o shadow
+//   ./shadow > shadow.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image counting the operations it gets
+class CountingImage : public erom::ImageDevice {
+public:
+  unsigned long read_ops, write_ops;
+
+  CountingImage(size_t aSize) : ImageDevice(NULL, aSize), read_ops(0), write_ops(0) { /* Do Nothing */ }
+
+  virtual void read(size_t aAddress, void *aData, size_t aSize) { read_ops++; ImageDevice::read(aAddress, aData, aSize); }
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) { write_ops++; ImageDevice::write(aAddress, aData, aSize); }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode aMode) { write_ops++; ImageDevice::program(aAddress, aValue, aMode); }
+
+  void reset_counts() { read_ops = write_ops = 0; reset_stats(); }
+};
+
+// Larger than the 4 KB layout: 'Access' keeps the last byte out of range
+static CountingImage image(8192);
+static erom::Access eeprom(image);
+
+static const unsigned long saves = 1000;
+enum { edits = 8 };
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+template<size_t Entries> class PlainConfig : public erom::Storage {
+public:
+  enum { entries = Entries };
+  erom::Entry<int32_t> values[Entries];
+  PlainConfig() : Storage(eeprom) { for (size_t __i = 0; __i < Entries; __i++) issue(values[__i]); }
+};
+
+template<size_t Entries> class ShadowConfig : public erom::ShadowStorage<Entries * sizeof(int32_t)> {
+public:
+  enum { entries = Entries };
+  erom::Entry<int32_t> values[Entries];
+  ShadowConfig() : erom::ShadowStorage<Entries * sizeof(int32_t)>(eeprom) { for (size_t __i = 0; __i < Entries; __i++) this->issue(values[__i]); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static double cpu() {
+  struct timespec __ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &__ts);
+  return __ts.tv_sec * 1e9 + __ts.tv_nsec;
+}
+
+template<class Config> static void edit(Config &aConfig, bool aTouchAll) {
+  if (aTouchAll)
+    for (int __i = 0; __i < Config::entries; __i++) aConfig.values[__i] = aConfig.values[__i].value;
+  for (int __n = 0; __n < edits; __n++) aConfig.values[random(Config::entries)] = random(0x7FFFFFFFL);
+}
+
+// Saves the first image on erased EEPROM and loads it back, then replays
+// the edits. Exits if a reloaded value differs
+template<class Config> static void run(const char *aName, const char *aWorkload) {
+  memset(image.image(), 0xFF, image.size());
+  randomSeed(1);
+  Config __config;
+  for (int __i = 0; __i < Config::entries; __i++) __config.values[__i] = __i;
+  __config.save();
+  __config.load();
+  image.reset_counts();
+
+  bool __touch_all = !strcmp(aWorkload, "touched");
+  double __cpu = 0;
+  for (unsigned long __n = 0; __n < saves; __n++) {
+    edit(__config, __touch_all);
+    double __start = cpu();
+    __config.save();
+    __cpu += cpu() - __start;
+  }
+
+  printf("shadow.%s.%s,%lu,%lu,%lu,%lu,%lu,%lu,%.2f,%.2f,%.0f\n", aName, aWorkload, (unsigned long)__config.size(), saves,
+    image.read_ops, image.bytes_read(), image.write_ops, image.bytes_written(),
+    (double)image.read_ops / saves, (double)image.write_ops / saves, __cpu / saves);
+
+  PlainConfig<Config::entries> *__loaded = new PlainConfig<Config::entries>();
+  __loaded->load();
+  for (int __i = 0; __i < Config::entries; __i++)
+    if (__loaded->values[__i].value != __config.values[__i].value) {
+      printf("%s: reloaded value differs\n", aName);
+      exit(1);
+    }
+  delete __loaded;
+}
+
+template<size_t Entries> static void layout() {
+  static const char *__workloads[] = { "sparse", "touched" };
+  for (int __w = 0; __w < 2; __w++) {
+    run<PlainConfig<Entries> >("storage", __workloads[__w]);
+    run<ShadowConfig<Entries> >("shadow", __workloads[__w]);
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("workload,layout_bytes,saves,read_ops,read_bytes,write_ops,bytes_written,reads_per_save,writes_per_save,cpu_ns_per_save\n");
+  layout<64>();
+  layout<1024>();
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
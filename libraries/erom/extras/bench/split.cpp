@@ -0,0 +1,126 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host benchmark of split-phase programming: a byte whose new value only
+// clears bits is written without erasing (write-only, ~1.8 ms), one set to
+// 0xFF is erased without writing (erase-only, ~1.8 ms), any other one takes
+// the atomic erase and write (~3.4 ms). 500 updates of a 48 byte record
+// ('Access::update_block()') on a simulated EEPROM, of two workloads:
+//   random - every byte of the record given a random value
+//   flags  - a bitmap of 384 flags: 1 .. 8 random flags cleared per update,
+//            all of them set again (bytes back to 0xFF) every 32 updates
+// Each runs through every path which picks the programming mode:
+//   device.erase_write - 'erom::ImageDevice' forcing the atomic cycle for
+//                        every byte, the cost before split-phase programming
+//   device             - 'erom::ImageDevice' given the mode by 'Access'
+//   native             - the native EEPROM ('NativeDevice::program()')
+//   native.queue       - the native EEPROM through the asynchronous write
+//                        queue, the mode picked by 'WriteQueue::service()'
+// Prints one CSV line per run:
+//   workload        - '<random|flags>.<path>'
+//   updates         - record updates
+//   bytes_written   - EEPROM bytes programmed
+//   split_cycles    - erase-only and write-only cycles
+//   programming_us  - modelled programming time
+//   us_per_update   - the same per update
+//   saved_pct       - programming time saved against atomic cycles only
+//
+// Exits with 1 if EEPROM does not hold the last record, or if the paths
+// given the mode disagree on the programming time.
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/split.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o split
+//   ./split > split.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Image ignoring the mode it is given, as before split-phase programming
+class EraseWriteImage : public erom::ImageDevice {
+public:
+  EraseWriteImage(size_t aSize) : ImageDevice(NULL, aSize) { /* Do Nothing */ }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode /* aMode */) { ImageDevice::program(aAddress, aValue, erom::EraseWrite); }
+};
+
+// Larger than the record: 'Access' keeps the last byte out of range
+static EraseWriteImage erase_write_image(256);
+static erom::ImageDevice device_image(NULL, 256);
+static erom::Access erase_write_eeprom(erase_write_image);
+static erom::Access device_eeprom(device_image);
+
+static erom::ImageDevice &native_image = erom::ImageDevice::native();
+
+static const unsigned long updates = 500;
+enum { record_size = 48 };
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static void random_record(uint8_t *aRecord, unsigned long /* aUpdate */) {
+  for (int __i = 0; __i < record_size; __i++) aRecord[__i] = random(256);
+}
+
+static void flags_record(uint8_t *aRecord, unsigned long aUpdate) {
+  if (aUpdate % 32 == 0) memset(aRecord, 0xFF, record_size);
+  else for (long __n = random(1, 9); __n > 0; __n--) aRecord[random(record_size)] &= ~(1 << random(8));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+// Replays the updates of 'aWorkload' from erased EEPROM. Returns the
+// modelled programming time
+static unsigned long run(const char *aName, const char *aPath, void (*aWorkload)(uint8_t*, unsigned long), erom::Access &aAccess, erom::ImageDevice &aImage, bool aQueue) {
+  uint8_t __record[record_size];
+  memset(aImage.image(), 0xFF, aImage.size());
+  memset(__record, 0xFF, sizeof(__record));
+  aImage.reset_stats();
+  randomSeed(1);
+
+  aAccess.async(aQueue);
+  for (unsigned long __n = 0; __n < updates; __n++) {
+    aWorkload(__record, __n);
+    aAccess.update_block(0, __record, record_size);
+    aAccess.flush();
+  }
+  aAccess.async(false);
+
+  if (memcmp(aImage.image(), __record, record_size)) {
+    printf("%s.%s: EEPROM differs\n", aName, aPath);
+    exit(1);
+  }
+
+  // Every split cycle took 'phase_latency()' instead of 'write_latency()'
+  unsigned long __atomic = aImage.bytes_written() * aImage.write_latency();
+  unsigned long __split = (__atomic - aImage.programming_time()) / (aImage.write_latency() - aImage.phase_latency());
+  printf("%s.%s,%lu,%lu,%lu,%lu,%.0f,%.1f\n", aName, aPath, updates, aImage.bytes_written(), __split, aImage.programming_time(),
+    (double)aImage.programming_time() / updates, __atomic ? 100. - 100. * aImage.programming_time() / __atomic : 0.);
+  return aImage.programming_time();
+}
+
+static void workload(const char *aName, void (*aWorkload)(uint8_t*, unsigned long)) {
+  run(aName, "device.erase_write", aWorkload, erase_write_eeprom, erase_write_image, false);
+  unsigned long __device = run(aName, "device", aWorkload, device_eeprom, device_image, false);
+  unsigned long __native = run(aName, "native", aWorkload, erom::access, native_image, false);
+  unsigned long __queue  = run(aName, "native.queue", aWorkload, erom::access, native_image, true);
+  if (__native != __device || __queue != __device) {
+    printf("%s: programming modes differ between paths\n", aName);
+    exit(1);
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("workload,updates,bytes_written,split_cycles,programming_us,us_per_update,saved_pct\n");
+  workload("random", random_record);
+  workload("flags", flags_record);
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
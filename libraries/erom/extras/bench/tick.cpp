@@ -0,0 +1,178 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host measurement of how long 'Storage::tick(aBudget)' holds up the sketch
+// while it loads and saves in slices, against a simulated 4 KB EEPROM
+// ('erom::ImageDevice', as on a Mega). Sketch time ('micros()') only moves
+// by the modelled programming time of every write, as if each one blocked
+// for its ATmega cycle times, and by 23 us per byte read, as from an
+// external EEPROM on 400 kHz I2C; CPU time is left out, so results do not
+// depend on the host. A storage of 128 'int32_t' entries gets 32 of them changed,
+// then is saved and loaded once synchronously ('save()'/'load()') and once
+// as a resumable pass ('begin_save()'/'begin_load()') ticked with each
+// budget, 200 us of control loop work between ticks. Runs on 'Storage',
+// 'VerifiedStorage' with checksum and 'BankedStorage'. Prints one CSV line
+// per pass:
+//   workload      - name, 'tick.<storage|verified|banked>.<save|load>'
+//   entries       - entries of the storage
+//   budget_us     - budget given to every 'tick()', 0 for a synchronous call
+//   ticks         - calls it took to finish the pass
+//   worst_tick_us - longest single call
+//   mean_tick_us  - average call
+//   max_step_us   - longest single step: saving an entry all bytes of which
+//                   change (read to estimate its time, read to compare and
+//                   programmed), or loading one. A save call may take that
+//                   long when it exceeds the budget, a load call may run
+//                   over the budget by that much
+//   pass_ms       - time from the start of the pass to its end
+//
+// Exits with 1 if a call takes longer than that.
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/bench/tick.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o tick
+//   ./tick > tick.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static const unsigned long read_us = 23;
+
+// Image whose accesses take their time of sketch time
+class ClockedImage : public erom::ImageDevice {
+public:
+  ClockedImage(size_t aSize) : ImageDevice(NULL, aSize) { /* Do Nothing */ }
+
+  virtual void read(size_t aAddress, void *aData, size_t aSize) {
+    ImageDevice::read(aAddress, aData, aSize);
+    host_advance_clock(aSize * read_us);
+  }
+
+  virtual void write(size_t aAddress, const void *aData, size_t aSize) {
+    unsigned long __time = programming_time();
+    ImageDevice::write(aAddress, aData, aSize);
+    host_advance_clock(programming_time() - __time);
+  }
+  virtual void program(size_t aAddress, uint8_t aValue, erom::ProgramMode aMode) {
+    unsigned long __time = programming_time();
+    ImageDevice::program(aAddress, aValue, aMode);
+    host_advance_clock(programming_time() - __time);
+  }
+};
+
+static ClockedImage image(4096);
+static erom::Access eeprom(image);
+
+enum { entries = 128, edits = 32 };
+
+static const unsigned long budgets[] = { 5000, 20000 };
+static const unsigned long control_us = 200;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+class PlainConfig : public erom::Storage {
+public:
+  erom::Entry<int32_t> values[entries];
+  PlainConfig() : Storage(eeprom) { for (int __i = 0; __i < entries; __i++) issue(values[__i]); }
+};
+
+class VerifiedConfig : public erom::VerifiedStorage {
+public:
+  erom::Entry<int32_t> values[entries];
+  VerifiedConfig() : VerifiedStorage(eeprom, 0x7101, 1, true) { for (int __i = 0; __i < entries; __i++) issue(values[__i]); }
+};
+
+class BankedConfig : public erom::BankedStorage {
+public:
+  erom::Entry<int32_t> values[entries];
+  BankedConfig() : BankedStorage(eeprom, entries * sizeof(int32_t)) { for (int __i = 0; __i < entries; __i++) issue(values[__i]); }
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static bool over_budget = false;
+
+template<class Config> static void edit(Config &aConfig) {
+  for (int __n = 0; __n < edits; __n++) aConfig.values[random(entries)] = random(0x7FFFFFFFL);
+}
+
+static unsigned long max_step(bool aSave) { return sizeof(int32_t) * (aSave ? image.write_latency() + 2 * read_us : read_us); }
+
+static void report(const char *aName, const char *aPass, unsigned long aBudget, unsigned long aTicks,
+                   unsigned long aWorst, unsigned long aTotal, unsigned long aStep, unsigned long aPass_us) {
+  printf("tick.%s.%s,%d,%lu,%lu,%lu,%lu,%lu,%.1f\n", aName, aPass, entries, aBudget, aTicks, aWorst,
+    aTicks ? aTotal / aTicks : 0, aStep, aPass_us / 1000.0);
+  unsigned long __limit = strcmp(aPass, "save") ? aBudget + aStep : aBudget > aStep ? aBudget : aStep;
+  if (aBudget && aWorst > __limit) over_budget = true;
+}
+
+// Starts a pass, ticks it to its end and reports it
+template<class Config> static void tick(Config &aConfig, const char *aName, bool aSave, unsigned long aBudget) {
+  unsigned long __start = micros();
+  if (aSave) aConfig.begin_save();
+  else aConfig.begin_load();
+
+  unsigned long __step = max_step(aSave);
+  unsigned long __ticks = 0, __worst = 0, __total = 0;
+  while (aConfig.busy()) {
+    unsigned long __time = micros();
+    aConfig.tick(aBudget);
+    __time = micros() - __time;
+    __ticks++, __total += __time;
+    if (__time > __worst) __worst = __time;
+    delayMicroseconds(control_us);
+  }
+  report(aName, aSave ? "save" : "load", aBudget, __ticks, __worst, __total, __step, micros() - __start);
+}
+
+// Stores the first image, then measures synchronous and sliced saves and
+// loads of the same amount of changes. Exits if a reloaded value differs
+template<class Config> static void run(const char *aName) {
+  memset(image.image(), 0xFF, image.size());
+  randomSeed(1);
+  Config __config;
+  for (int __i = 0; __i < entries; __i++) __config.values[__i] = __i;
+  __config.save();
+
+  edit(__config);
+  unsigned long __time = micros();
+  __config.save();
+  __time = micros() - __time;
+  report(aName, "save", 0, 1, __time, __time, 0, __time);
+
+  Config __loaded;
+  __time = micros();
+  __loaded.load();
+  __time = micros() - __time;
+  report(aName, "load", 0, 1, __time, __time, 0, __time);
+
+  for (size_t __b = 0; __b < sizeof(budgets) / sizeof(budgets[0]); __b++) {
+    edit(__config);
+    tick(__config, aName, true, budgets[__b]);
+    tick(__loaded, aName, false, budgets[__b]);
+    for (int __i = 0; __i < entries; __i++)
+      if (__loaded.values[__i].value != __config.values[__i].value) {
+        printf("%s: reloaded value differs\n", aName);
+        exit(1);
+      }
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  host_advance_clock(0);  // Sketch time only moves when told so
+  printf("workload,entries,budget_us,ticks,worst_tick_us,mean_tick_us,max_step_us,pass_ms\n");
+  run<PlainConfig>("storage");
+  run<VerifiedConfig>("verified");
+  run<BankedConfig>("banked");
+  exit(over_budget ? 1 : 0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
@@ -0,0 +1,87 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Host replay of a year of saves of an uptime counter, counting the
+// programming cycles of every EEPROM cell through the 'erom::Stats' per-cell
+// histogram. The counter ('int32_t' minutes) is incremented and saved once
+// a minute, 525600 saves, stored in a plain 'Entry' or in a
+// 'WearLeveledEntry' of 4, 8 or 32 slots, on the simulated native EEPROM
+// ('erom::ImageDevice::native()'). Prints one CSV line per run:
+//   workload         - 'entry' or 'wear_leveled.<slots>'
+//   footprint_bytes  - EEPROM bytes taken by the entry
+//   saves            - saves replayed
+//   bytes_written    - EEPROM bytes programmed
+//   max_cell_writes  - programming cycles of the hottest cell
+//   lifetime_years   - years until the hottest cell reaches 100000 cycles
+//
+// Exits with 1 if the histogram disagrees with the wear the image counted,
+// or the counter does not reload.
+//
+// Needs the per-cell histogram, so it is built with 'EROM_STATS' and a
+// bucket size of 1 byte. Build and run from the library folder:
+//   g++ -O2 -DEROM_STATS -DEROM_STATS_BUCKETS=1024 -DEROM_STATS_BUCKET_SIZE=1
+//       -I extras/host -I . extras/bench/wear.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o wear
+//   ./wear > wear.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#if !defined(EROM_STATS) || EROM_STATS_BUCKET_SIZE != 1
+#error "Build with -DEROM_STATS -DEROM_STATS_BUCKETS=1024 -DEROM_STATS_BUCKET_SIZE=1"
+#endif
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static erom::ImageDevice &image = erom::ImageDevice::native();
+
+static const unsigned long saves     = 365UL * 24 * 60;
+static const unsigned long endurance = erom::SaveScheduler::DefaultEndurance;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+template<class E> static void run(const char *aName) {
+  memset(image.image(), 0xFF, image.size());
+  image.reset_stats();
+  erom::Stats::reset();
+
+  erom::Storage __storage;
+  E __uptime;
+  __storage.issue(__uptime);
+  __uptime = 0;
+  __uptime.save(true);
+  erom::Stats::reset(), image.reset_stats();
+
+  for (unsigned long __n = 1; __n <= saves; __n++) {
+    __uptime = (int32_t)__n;
+    __storage.save();
+  }
+
+  uint32_t __max = erom::Stats::bucket_writes(erom::Stats::hottest_bucket());
+  E __loaded;
+  erom::Storage __reloaded;
+  __reloaded.issue(__loaded);
+  __loaded.load();
+  if (__max != image.max_wear() || __loaded.value != (int32_t)saves) {
+    printf("%s: %lu cell writes counted, %lu by the image, %ld reloaded\n", aName, (unsigned long)__max, image.max_wear(), (long)__loaded.value);
+    exit(1);
+  }
+  printf("%s,%lu,%lu,%lu,%lu,%.1f\n", aName, (unsigned long)__storage.size(), saves, erom::Stats::bytes_written(), (unsigned long)__max, (double)endurance / __max);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  printf("workload,footprint_bytes,saves,bytes_written,max_cell_writes,lifetime_years\n");
+  run<erom::Entry<int32_t> >("entry");
+  run<erom::WearLeveledEntry<int32_t, 4> >("wear_leveled.4");
+  run<erom::WearLeveledEntry<int32_t, 8> >("wear_leveled.8");
+  run<erom::WearLeveledEntry<int32_t, 32> >("wear_leveled.32");
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }
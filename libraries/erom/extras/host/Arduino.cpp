@@ -0,0 +1,101 @@
+#include "Arduino.h"
+
+#include <poll.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+HostSerial Serial;
+
+// Optional sketch callback, called when there is input on stdin
+void serialEvent() __attribute__((weak));
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static unsigned long long _host_clock() {
+  timespec __ts;
+  clock_gettime(CLOCK_MONOTONIC, &__ts);
+  return __ts.tv_sec * 1000000ULL + __ts.tv_nsec / 1000;
+}
+
+static const unsigned long long _host_start = _host_clock();
+
+// Manual clock, see 'host_advance_clock()'
+static bool _host_manual = false;
+static unsigned long long _host_manual_time = 0;
+
+static unsigned long long _host_time() { return _host_manual ? _host_manual_time : _host_clock() - _host_start; }
+
+void host_advance_clock(unsigned long aMicroseconds) {
+  if (!_host_manual) _host_manual_time = _host_time(), _host_manual = true;
+  _host_manual_time += aMicroseconds;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long micros() { return (unsigned long)_host_time(); }
+unsigned long millis() { return (unsigned long)(_host_time() / 1000); }
+void delay(unsigned long aMilliseconds) { if (_host_manual) host_advance_clock(aMilliseconds * 1000); else usleep(aMilliseconds * 1000); }
+void delayMicroseconds(unsigned int aMicroseconds) { if (_host_manual) host_advance_clock(aMicroseconds); else usleep(aMicroseconds); }
+
+void pinMode(uint8_t, uint8_t) { /* Do Nothing */ }
+int  analogRead(uint8_t) { return rand() % 1024; }
+void digitalWrite(uint8_t, uint8_t) { /* Do Nothing */ }
+int  digitalRead(uint8_t) { return LOW; }
+
+long random(long aMax) { return aMax > 0 ? rand() % aMax : 0; }
+long random(long aMin, long aMax) { return aMin >= aMax ? aMin : aMin + random(aMax - aMin); }
+void randomSeed(unsigned long aSeed) { srand(aSeed); }
+long map(long aValue, long aFromLow, long aFromHigh, long aToLow, long aToHigh) {
+  return (aValue - aFromLow) * (aToHigh - aToLow) / (aFromHigh - aFromLow) + aToLow;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void HostSerial::begin(unsigned long) { setvbuf(stdout, NULL, _IOLBF, 0); }
+
+// One byte look-ahead, so that end of input reads as "nothing available"
+static int _serial_peek = -1;
+
+int HostSerial::available() {
+  if (_serial_peek < 0) {
+    pollfd __fd = { STDIN_FILENO, POLLIN, 0 };
+    unsigned char __c;
+    if (poll(&__fd, 1, 0) > 0 && (__fd.revents & POLLIN) && ::read(STDIN_FILENO, &__c, 1) == 1) _serial_peek = __c;
+  }
+  return _serial_peek < 0 ? 0 : 1;
+}
+
+int HostSerial::read() {
+  int __c = available() ? _serial_peek : -1;
+  _serial_peek = -1;
+  return __c;
+}
+
+size_t HostSerial::print(const char *aValue)    { return printf("%s", aValue); }
+size_t HostSerial::print(char aValue)           { return printf("%c", aValue); }
+size_t HostSerial::print(int aValue)            { return printf("%d", aValue); }
+size_t HostSerial::print(unsigned int aValue)   { return printf("%u", aValue); }
+size_t HostSerial::print(long aValue)           { return printf("%ld", aValue); }
+size_t HostSerial::print(unsigned long aValue)  { return printf("%lu", aValue); }
+size_t HostSerial::print(double aValue, int aDigits) { return printf("%.*f", aDigits, aValue); }
+size_t HostSerial::println()                    { return printf("\r\n"); }
+size_t HostSerial::write(uint8_t aValue)        { return fwrite(&aValue, 1, 1, stdout); }
+size_t HostSerial::write(const uint8_t *aData, size_t aSize) { return fwrite(aData, 1, aSize, stdout); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+int main() {
+  const char *__loops = getenv("EROM_HOST_LOOPS");
+  unsigned long __left = __loops ? strtoul(__loops, NULL, 0) : 0;
+
+  setup();
+  for (;;) {
+    loop();
+    if (serialEvent && Serial.available()) serialEvent();
+    if (__loops && !--__left) break;
+  }
+  return 0;
+}
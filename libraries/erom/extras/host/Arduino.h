@@ -0,0 +1,103 @@
+#ifndef _ROBODEM_EROM_HOST_ARDUINO_H_
+#define _ROBODEM_EROM_HOST_ARDUINO_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Minimal Arduino core for building 'erom' and its examples natively on a
+// Linux host. EEPROM is backed by 'erom::ImageDevice::native()', i.e. by the
+// file named in the 'EROM_IMAGE' environment variable (anonymous memory if
+// not set) of 'EROM_IMAGE_SIZE' bytes. 'Serial' is stdin/stdout.
+//
+// Build and run an example from the library folder:
+//   g++ -O2 -I extras/host -I . -x c++ examples/Storage/Storage.ino
+//       -x none erom.cpp extras/host/Arduino.cpp -o storage
+//   EROM_IMAGE=eeprom.bin ./storage
+// Set 'EROM_HOST_LOOPS' to stop after that many 'loop()' calls and
+// 'EROM_REALTIME' to make EEPROM writes take their real programming time.
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <ctype.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#define ARDUINO 10800
+#define EROM_HOST     // Host build, see 'erom::ImageDevice'
+
+#define INPUT  0x0
+#define OUTPUT 0x1
+#define LOW    0x0
+#define HIGH   0x1
+
+enum { A0 = 14, A1, A2, A3, A4, A5 };
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long aMilliseconds);
+void delayMicroseconds(unsigned int aMicroseconds);
+
+void pinMode(uint8_t aPin, uint8_t aMode);
+int  analogRead(uint8_t aPin);
+void digitalWrite(uint8_t aPin, uint8_t aValue);
+int  digitalRead(uint8_t aPin);
+
+long random(long aMax);
+long random(long aMin, long aMax);
+void randomSeed(unsigned long aSeed);
+long map(long aValue, long aFromLow, long aFromHigh, long aToLow, long aToHigh);
+
+// Host only: stops the real clock and moves 'millis()'/'micros()' forward by
+// 'aMicroseconds'; 'delay()' then advances the clock instead of sleeping.
+// Lets benchmarks and tests run hours of sketch time in no time.
+void host_advance_clock(unsigned long aMicroseconds);
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Serial port over stdin/stdout
+class HostSerial {
+public:
+  void begin(unsigned long aBaud);
+  int  available();
+  int  read();
+
+  size_t print(const char *aValue);
+  size_t print(char aValue);
+  size_t print(int aValue);
+  size_t print(unsigned int aValue);
+  size_t print(long aValue);
+  size_t print(unsigned long aValue);
+  size_t print(double aValue, int aDigits = 2);
+
+  // Raw bytes, e.g. for 'erom::TraceStream'
+  size_t write(uint8_t aValue);
+  size_t write(const uint8_t *aData, size_t aSize);
+
+  size_t println();
+  size_t println(const char *aValue)        { return print(aValue) + println(); }
+  size_t println(char aValue)               { return print(aValue) + println(); }
+  size_t println(int aValue)                { return print(aValue) + println(); }
+  size_t println(unsigned int aValue)       { return print(aValue) + println(); }
+  size_t println(long aValue)               { return print(aValue) + println(); }
+  size_t println(unsigned long aValue)      { return print(aValue) + println(); }
+  size_t println(double aValue, int aDigits = 2) { return print(aValue, aDigits) + println(); }
+
+  operator bool() const { return true; }
+};
+
+extern HostSerial Serial;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Sketch entry points
+void setup();
+void loop();
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_HOST_ARDUINO_H_
@@ -0,0 +1,157 @@
+#include "Wire.h"
+
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+TwoWire Wire;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+HostI2CEeprom::HostI2CEeprom(uint8_t aAddress, size_t aSize, size_t aPageSize, uint8_t aAddressBytes, unsigned long aWriteTime) :
+  _address(aAddress), _address_bytes(aAddressBytes), _size(aSize), _page_size(aPageSize), _write_time(aWriteTime),
+  _image(static_cast<uint8_t*>(malloc(aSize))), _wear(static_cast<uint32_t*>(calloc(aSize, sizeof(uint32_t)))),
+  _pointer(0), _busy_until(0), _busy(false)
+{
+  memset(_image, 0xFF, _size);
+  reset_stats();
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+HostI2CEeprom::~HostI2CEeprom() { free(_image); free(_wear); }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+bool HostI2CEeprom::acknowledge(uint8_t aAddress) {
+  // Parts with one address byte take the upper address bits as block bits
+  uint8_t __blocks = _address_bytes > 1 ? 1 : (_size + 255) >> 8;
+  if ((aAddress & 0x7F & ~(__blocks - 1)) != _address) return false;
+
+  if (_busy && (long)(micros() - _busy_until) >= 0) _busy = false;
+  if (_busy) _nacks++;
+  return !_busy;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void HostI2CEeprom::receive(uint8_t aAddress, const uint8_t *aData, size_t aSize) {
+  if (aSize < _address_bytes) return;
+
+  // Address pointer: address bytes, plus block bits of the device address
+  _pointer = _address_bytes > 1 ? (aData[0] << 8 | aData[1]) : ((aAddress & 0x07) << 8 | aData[0]);
+  _pointer %= _size;
+  aData += _address_bytes, aSize -= _address_bytes;
+  if (!aSize) return;  // Address only, a read follows
+
+  // Data wraps around within the page
+  size_t __page = _pointer - _pointer % _page_size;
+  for (size_t __i = 0; __i < aSize; __i++) {
+    size_t __cell = __page + (_pointer - __page + __i) % _page_size;
+    _image[__cell] = aData[__i];
+    _wear[__cell]++;
+  }
+  _bytes_written += aSize;
+  _write_cycles++;
+  _busy = true, _busy_until = micros() + _write_time;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void HostI2CEeprom::transmit(uint8_t *aData, size_t aSize) {
+  for (size_t __i = 0; __i < aSize; __i++) aData[__i] = _image[_pointer], _pointer = (_pointer + 1) % _size;
+  _bytes_read += aSize;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+unsigned long HostI2CEeprom::max_wear() const {
+  unsigned long __max = 0;
+  for (size_t __i = 0; __i < _size; __i++) if (_wear[__i] > __max) __max = _wear[__i];
+  return __max;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void HostI2CEeprom::reset_stats() {
+  _write_cycles = _bytes_read = _bytes_written = _nacks = 0;
+  memset(_wear, 0, _size * sizeof(uint32_t));
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+TwoWire::TwoWire() : _tx_address(0), _tx_size(0), _rx_size(0), _rx_position(0), _transactions(0) {
+  for (int __i = 0; __i < max_parts; __i++) _parts[__i] = NULL;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void TwoWire::attach(HostI2CEeprom &aPart) {
+  for (int __i = 0; __i < max_parts; __i++)
+    if (!_parts[__i]) { _parts[__i] = &aPart; return; }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void TwoWire::begin() {
+  static HostI2CEeprom __default(0x50, 32768, 64);
+  if (!_parts[0]) attach(__default);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+HostI2CEeprom *TwoWire::_find(uint8_t aAddress) {
+  for (int __i = 0; __i < max_parts; __i++)
+    if (_parts[__i] && _parts[__i]->acknowledge(aAddress)) return _parts[__i];
+  return NULL;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void TwoWire::beginTransmission(uint8_t aAddress) { _tx_address = aAddress, _tx_size = 0; }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint8_t TwoWire::endTransmission(uint8_t) {
+  if (_tx_size) _transactions++;  // Not an ACK poll
+  HostI2CEeprom *__part = _find(_tx_address);
+  if (!__part) return 2;
+  __part->receive(_tx_address, _tx_buffer, _tx_size);
+  return 0;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t TwoWire::write(uint8_t aValue) {
+  if (_tx_size >= BUFFER_LENGTH) return 0;
+  _tx_buffer[_tx_size++] = aValue;
+  return 1;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+size_t TwoWire::write(const uint8_t *aData, size_t aSize) {
+  size_t __written = 0;
+  while (__written < aSize && write(aData[__written])) __written++;
+  return __written;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+uint8_t TwoWire::requestFrom(uint8_t aAddress, uint8_t aQuantity, uint8_t) {
+  _transactions++;
+  HostI2CEeprom *__part = _find(aAddress);
+  if (aQuantity > BUFFER_LENGTH) aQuantity = BUFFER_LENGTH;
+  _rx_position = 0;
+  _rx_size = __part ? aQuantity : 0;
+  if (__part) __part->transmit(_rx_buffer, _rx_size);
+  return _rx_size;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+int TwoWire::available() { return _rx_size - _rx_position; }
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+int TwoWire::read() { return _rx_position < _rx_size ? _rx_buffer[_rx_position++] : -1; }
@@ -0,0 +1,109 @@
+#ifndef _ROBODEM_EROM_HOST_WIRE_H_
+#define _ROBODEM_EROM_HOST_WIRE_H_
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Minimal Arduino 'Wire' library for host builds, with simulated I2C serial
+// EEPROMs ('HostI2CEeprom') attached to the bus instead of real parts.
+//
+// Build sketches using it with 'extras/host/Wire.cpp' added:
+//   g++ -O2 -I extras/host -I . -x c++ examples/I2C_EEPROM/I2C_EEPROM.ino
+//       -x none erom.cpp extras/host/Arduino.cpp extras/host/Wire.cpp
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include "Arduino.h"
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#define BUFFER_LENGTH 32
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Model of a 24LCxx serial EEPROM, enforcing the parts' behavior:
+// - a write cycle starts at the stop condition of a write with data bytes
+//   and takes 'write_time()' microseconds of 'micros()' time; meanwhile the
+//   part does not acknowledge its address (so ACK polling works)
+// - data bytes wrap around within the page of the first one, overwriting
+//   its start instead of continuing into the next page
+// - sequential reads continue from the address pointer, wrapping around at
+//   the end of memory
+// Parts with one address byte ('aAddressBytes' = 1) take address bits 8..10
+// from the device address. Counts traffic, write cycles and per-cell wear.
+class HostI2CEeprom {
+private:
+  uint8_t _address, _address_bytes;
+  size_t _size, _page_size;
+  unsigned long _write_time;
+  uint8_t *_image;
+  uint32_t *_wear;
+  size_t _pointer;
+  unsigned long _busy_until;
+  bool _busy;
+  unsigned long _write_cycles, _bytes_read, _bytes_written, _nacks;
+
+public:
+  static const unsigned long DefaultWriteTime = 5000;
+
+  HostI2CEeprom(uint8_t aAddress, size_t aSize, size_t aPageSize, uint8_t aAddressBytes = 2, unsigned long aWriteTime = DefaultWriteTime);
+  ~HostI2CEeprom();
+
+  // Bus side, called by 'TwoWire'. 'acknowledge()' returns false if the part
+  // does not answer to 'aAddress' now
+  bool acknowledge(uint8_t aAddress);
+  void receive(uint8_t aAddress, const uint8_t *aData, size_t aSize);
+  void transmit(uint8_t *aData, size_t aSize);
+
+  inline size_t size() const { return _size; }
+  inline size_t page_size() const { return _page_size; }
+  inline unsigned long write_time() const { return _write_time; }
+  inline uint8_t *image() { return _image; }
+
+  // Statistics since creation or the last 'reset_stats()'
+  inline unsigned long write_cycles() const { return _write_cycles; }
+  inline unsigned long bytes_read() const { return _bytes_read; }
+  inline unsigned long bytes_written() const { return _bytes_written; }
+  inline unsigned long nacks() const { return _nacks; }
+  unsigned long max_wear() const;
+  void reset_stats();
+};
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// I2C master, Arduino 'TwoWire' API. 'endTransmission()' returns 2 if no
+// attached part acknowledges the address. 'begin()' attaches a 24LC256 at
+// 0x50 if no part was attached before.
+class TwoWire {
+private:
+  enum { max_parts = 8 };
+  HostI2CEeprom *_parts[max_parts];
+  uint8_t _tx_address, _tx_buffer[BUFFER_LENGTH], _tx_size;
+  uint8_t _rx_buffer[BUFFER_LENGTH], _rx_size, _rx_position;
+  unsigned long _transactions;
+
+  HostI2CEeprom *_find(uint8_t aAddress);
+
+public:
+  TwoWire();
+
+  // Host only: connect a simulated part to the bus
+  void attach(HostI2CEeprom &aPart);
+  // Host only: bus transactions (writes and reads, ACK polls not counted)
+  // since start or the last 'reset_stats()'
+  inline unsigned long transactions() const { return _transactions; }
+  inline void reset_stats() { _transactions = 0; }
+
+  void begin();
+  void setClock(uint32_t) { /* Do Nothing */ }
+
+  void beginTransmission(uint8_t aAddress);
+  uint8_t endTransmission(uint8_t aSendStop = true);
+  size_t write(uint8_t aValue);
+  size_t write(const uint8_t *aData, size_t aSize);
+
+  uint8_t requestFrom(uint8_t aAddress, uint8_t aQuantity, uint8_t aSendStop = true);
+  int available();
+  int read();
+};
+
+extern TwoWire Wire;
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#endif // _ROBODEM_EROM_HOST_WIRE_H_
@@ -0,0 +1,223 @@
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Replays an EEPROM access trace (see 'erom_Trace.h'), as recorded by a
+// sketch built with -DEROM_TRACE, against a simulated EEPROM
+// ('erom::ImageDevice') through 'erom::Access' of the library it is built
+// with, and reports where the writes went. Nothing depends on the host or
+// the clock: the same trace and library give the same report, so building
+// the tool against two versions of the library and replaying a recorded
+// production trace on both compares their EEPROM traffic.
+//
+// Reads the trace from stdin. Settings from the environment:
+//   EROM_REPLAY_SIZE      - EEPROM bytes (4096)
+//   EROM_REPLAY_IMAGE     - file holding the EEPROM contents the trace
+//                           started from (erased otherwise); it is not changed
+//   EROM_REPLAY_ENDURANCE - erase cycles a cell lasts (100000)
+//   EROM_REPLAY_TOP       - hot addresses listed (10)
+//
+// Prints three CSV tables separated by empty lines:
+//   totals - records, reads, writes, updates (records of each kind),
+//            bytes_read, bytes_requested (written or updated), bytes_changed
+//            (of those, which differed from the image), bytes_programmed,
+//            diverged (records whose changed bytes differ from the recorded
+//            ones: the image does not match the unit's), duration_s (trace
+//            time), hottest_address, hottest_erases and days_to_endurance
+//            of the hottest cell at the trace's rate
+//   tags   - the same per call site tag ('erom::Trace::Tag'), amplification
+//            being bytes programmed per byte that changed
+//   hot    - addresses erased most often, their writes, erases and days
+//            to endurance
+// Exits with 2 if the trace is cut short or cannot be read.
+//
+// Build and run from the library folder:
+//   g++ -O2 -I extras/host -I . extras/trace/replay.cpp erom.cpp
+//       extras/host/Arduino.cpp extras/host/Wire.cpp -o replay
+//   ./replay < trace.bin > report.csv
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+#include <Arduino.h>
+#include <erom.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+enum { tags = 64, read_kind = 0, write_kind = 1, update_kind = 2 };
+
+struct Totals {
+  unsigned long records, reads, writes, updates, diverged;
+  unsigned long bytes_read, bytes_requested, bytes_changed, bytes_programmed;
+};
+
+static Totals totals, by_tag[tags];
+
+static unsigned long setting(const char *aName, unsigned long aDefault) {
+  const char *__value = getenv(aName);
+  return __value ? strtoul(__value, NULL, 0) : aDefault;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+// Trace input
+
+static uint8_t *trace = NULL;
+static size_t trace_size = 0, trace_offset = 0;
+
+static void fail(const char *aWhat) {
+  fprintf(stderr, "replay: %s at offset %lu\n", aWhat, (unsigned long)trace_offset);
+  exit(2);
+}
+
+static void read_trace() {
+  size_t __capacity = 0;
+  for (;;) {
+    if (trace_size == __capacity) {
+      __capacity = __capacity ? __capacity * 2 : 65536;
+      trace = (uint8_t*)realloc(trace, __capacity);
+      if (!trace) fail("out of memory");
+    }
+    size_t __read = fread(trace + trace_size, 1, __capacity - trace_size, stdin);
+    if (!__read) break;
+    trace_size += __read;
+  }
+}
+
+static unsigned long varint() {
+  unsigned long __value = 0;
+  for (int __shift = 0; ; __shift += 7) {
+    if (trace_offset >= trace_size) fail("record cut short");
+    if (__shift > 28) fail("bad varint");
+    uint8_t __byte = trace[trace_offset++];
+    __value |= (unsigned long)(__byte & 0x7F) << __shift;
+    if (!(__byte & 0x80)) return __value;
+  }
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+static double days(unsigned long aErases, unsigned long aEndurance, double aSeconds) {
+  return aErases && aSeconds > 0 ? aEndurance * aSeconds / aErases / 86400. : -1;
+}
+
+static void print_days(double aDays) {
+  if (aDays < 0) printf("inf");
+  else printf("%.1f", aDays);
+}
+
+static void add(Totals &aTotals, int aKind, size_t aSize, unsigned long aChanged, unsigned long aProgrammed, bool aDiverged) {
+  aTotals.records++;
+  if (aKind == read_kind) aTotals.reads++, aTotals.bytes_read += aSize;
+  else {
+    if (aKind == write_kind) aTotals.writes++;
+    else aTotals.updates++;
+    aTotals.bytes_requested += aSize, aTotals.bytes_changed += aChanged, aTotals.bytes_programmed += aProgrammed;
+    if (aDiverged) aTotals.diverged++;
+  }
+}
+
+static erom::ImageDevice *image = NULL;
+
+// Orders addresses by erases of 'image', most first
+static int hotter(const void *aLeft, const void *aRight) {
+  size_t __left = *(const size_t*)aLeft, __right = *(const size_t*)aRight;
+  if (image->erases(__left) != image->erases(__right)) return image->erases(__left) > image->erases(__right) ? -1 : 1;
+  return __left < __right ? -1 : __left > __right;
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void setup() {
+  size_t __size = setting("EROM_REPLAY_SIZE", 4096);
+  unsigned long __endurance = setting("EROM_REPLAY_ENDURANCE", 100000);
+  size_t __top = setting("EROM_REPLAY_TOP", 10);
+
+  erom::ImageDevice __image(NULL, __size);
+  memset(__image.image(), 0xFF, __size);
+  const char *__initial = getenv("EROM_REPLAY_IMAGE");
+  if (__initial) {
+    FILE *__file = fopen(__initial, "rb");
+    if (!__file) { fprintf(stderr, "replay: cannot open %s\n", __initial); exit(2); }
+    if (fread(__image.image(), 1, __size, __file) != __size) fprintf(stderr, "replay: %s is shorter than the EEPROM\n", __initial);
+    fclose(__file);
+  }
+  erom::Access __access(__image);
+  uint8_t *__scratch = (uint8_t*)malloc(__size);
+
+  read_trace();
+  double __seconds = 0;
+  for (bool __first = true; trace_offset < trace_size; __first = false) {
+    uint8_t __head = trace[trace_offset++];
+    int __kind = __head >> 6, __tag = __head & 0x3F;
+    unsigned long __delta = varint();
+    size_t __address = varint(), __length = varint();
+    if (!__first) __seconds += __delta / 1e6;
+    if (__kind > update_kind) fail("bad record kind");
+
+    if (__kind == read_kind) {
+      if (__address + __length <= __size) __access.read_block(__address, __scratch, __length);
+      add(totals, __kind, __length, 0, 0, false);
+      add(by_tag[__tag], __kind, __length, 0, 0, false);
+      continue;
+    }
+
+    unsigned long __recorded = varint();
+    if (trace_offset + __length > trace_size) fail("record cut short");
+    const uint8_t *__data = trace + trace_offset;
+    trace_offset += __length;
+    if (__address + __length > __size) continue;
+
+    unsigned long __changed = 0;
+    for (size_t __i = 0; __i < __length; __i++) if (__image.image()[__address + __i] != __data[__i]) __changed++;
+    unsigned long __programmed = __image.bytes_written();
+    if (__kind == write_kind) __access.write_block(__address, __data, __length);
+    else __access.update_block(__address, __data, __length);
+    __programmed = __image.bytes_written() - __programmed;
+
+    // Plain writes record all their bytes as changed
+    bool __diverged = __kind == update_kind && __recorded != __changed;
+    add(totals, __kind, __length, __changed, __programmed, __diverged);
+    add(by_tag[__tag], __kind, __length, __changed, __programmed, __diverged);
+  }
+
+  size_t __hottest = 0;
+  for (size_t __address = 1; __address < __size; __address++)
+    if (__image.erases(__address) > __image.erases(__hottest)) __hottest = __address;
+
+  printf("records,reads,writes,updates,bytes_read,bytes_requested,bytes_changed,bytes_programmed,diverged,duration_s,hottest_address,hottest_erases,days_to_endurance\n");
+  printf("%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.3f,%lu,%lu,", totals.records, totals.reads, totals.writes, totals.updates,
+    totals.bytes_read, totals.bytes_requested, totals.bytes_changed, totals.bytes_programmed, totals.diverged, __seconds,
+    (unsigned long)__hottest, __image.erases(__hottest));
+  print_days(days(__image.erases(__hottest), __endurance, __seconds));
+  printf("\n\n");
+
+  printf("tag,records,reads,writes,updates,bytes_read,bytes_requested,bytes_changed,bytes_programmed,diverged,amplification\n");
+  for (int __tag = 0; __tag < tags; __tag++) {
+    const Totals &__t = by_tag[__tag];
+    if (!__t.records) continue;
+    printf("%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%.2f\n", __tag, __t.records, __t.reads, __t.writes, __t.updates, __t.bytes_read,
+      __t.bytes_requested, __t.bytes_changed, __t.bytes_programmed, __t.diverged,
+      __t.bytes_changed ? (double)__t.bytes_programmed / __t.bytes_changed : 0.);
+  }
+  printf("\n");
+
+  // Hottest first, lower addresses first among equals
+  printf("address,writes,erases,days_to_endurance\n");
+  size_t *__hot = (size_t*)malloc(__size * sizeof(size_t)), __count = 0;
+  for (size_t __address = 0; __address < __size; __address++) if (__image.erases(__address)) __hot[__count++] = __address;
+  image = &__image;
+  qsort(__hot, __count, sizeof(size_t), hotter);
+  for (size_t __i = 0; __i < __count && __i < __top; __i++) {
+    printf("%lu,%lu,%lu,", (unsigned long)__hot[__i], __image.wear(__hot[__i]), __image.erases(__hot[__i]));
+    print_days(days(__image.erases(__hot[__i]), __endurance, __seconds));
+    printf("\n");
+  }
+
+  free(__hot);
+  free(__scratch);
+  free(trace);
+  exit(0);
+}
+
+// -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=- //
+
+void loop() { /* Do Nothing */ }